@@ -0,0 +1,844 @@
+#include "pch.h"
+
+#include "bulk-channel.h"
+#include "clock-sync.h"
+#include "logger.h"
+#include "lz4-block.h"
+
+namespace zen::mirror {
+
+namespace {
+
+/* The largest an LZ4 block of `size` bytes may be, LZ4_COMPRESSBOUND */
+inline uint64_t
+Lz4CompressBound(uint64_t size)
+{
+  return size + size / 255 + 16;
+}
+
+}  // namespace
+
+BulkChannel::~BulkChannel()
+{
+  Disconnect();
+
+  if (listen_fd_ != -1) {
+    loop_->RemoveFd(&listen_source_);
+    close(listen_fd_);
+  }
+
+  if (shared_->event_fd != -1) loop_->RemoveFd(&event_source_);
+
+  if (timer_fd_ != -1) {
+    loop_->RemoveFd(&timer_source_);
+    close(timer_fd_);
+  }
+}
+
+BulkChannel::Shared::~Shared()
+{
+  if (event_fd != -1) close(event_fd);
+}
+
+bool
+BulkChannel::Init(uint16_t port)
+{
+  shared_->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (shared_->event_fd == -1) {
+    LOG_ERROR("Failed to create the bulk channel event: %s", strerror(errno));
+    return false;
+  }
+
+  event_source_.fd = shared_->event_fd;
+  event_source_.mask = remote::FdSource::kReadable;
+  event_source_.callback = [this](int /*fd*/, uint32_t /*mask*/) {
+    FinishPrepared();
+  };
+  loop_->AddFd(&event_source_);
+
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd_ == -1) {
+    LOG_ERROR("Failed to create the clock sync timer: %s", strerror(errno));
+    return false;
+  }
+
+  timer_source_.fd = timer_fd_;
+  timer_source_.mask = remote::FdSource::kReadable;
+  timer_source_.callback = [this](int /*fd*/, uint32_t /*mask*/) {
+    uint64_t expirations;
+    read(timer_fd_, &expirations, sizeof(expirations));
+    SendClockSyncRequest();
+  };
+  loop_->AddFd(&timer_source_);
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ == -1) {
+    LOG_ERROR("Failed to create the bulk channel socket: %s", strerror(errno));
+    return false;
+  }
+
+  int reuse = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  // Local only, as nothing authenticates the server; it comes in through
+  // adb forward
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+          sizeof(address)) == -1 ||
+      listen(listen_fd_, 1) == -1) {
+    LOG_ERROR("Failed to listen on the bulk channel port %u: %s", port,
+        strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  socklen_t address_length = sizeof(address);
+  getsockname(
+      listen_fd_, reinterpret_cast<sockaddr *>(&address), &address_length);
+  port_ = ntohs(address.sin_port);
+
+  listen_source_.fd = listen_fd_;
+  listen_source_.mask = remote::FdSource::kReadable;
+  listen_source_.callback = [this](int /*fd*/, uint32_t /*mask*/) {
+    Accept();
+  };
+  loop_->AddFd(&listen_source_);
+
+  LOG_INFO("Bulk channel listening on port %u", port_);
+
+  return true;
+}
+
+void
+BulkChannel::Accept()
+{
+  int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd == -1) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+      LOG_WARN("Failed to accept a bulk channel connection: %s",
+          strerror(errno));
+    }
+    return;
+  }
+
+  if (connection_fd_ != -1) {
+    LOG_WARN("Bulk channel is already connected; refusing another one");
+    close(fd);
+    return;
+  }
+
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &kReceiveBufferSize, sizeof(int));
+
+  // Fits in the empty send buffer of the new connection
+  Hello hello{kMagic, kVersion, 1u << (uint32_t)Codec::kLz4, 0,
+      compression_threshold_};
+  if (write(fd, &hello, sizeof(hello)) != sizeof(hello)) {
+    LOG_WARN("Failed to greet the bulk channel connection: %s",
+        strerror(errno));
+    close(fd);
+    return;
+  }
+
+  connection_fd_ = fd;
+  header_received_ = 0;
+  stats_begin_ = std::chrono::steady_clock::now();
+  stats_bytes_ = 0;
+  stats_raw_bytes_ = 0;
+  stats_blobs_ = 0;
+  stats_decompress_time_ = std::chrono::nanoseconds::zero();
+  connection_begin_ = stats_begin_;
+  connection_bytes_ = 0;
+  connection_cached_bytes_ = 0;
+  connection_cache_hits_ = 0;
+  connection_cache_misses_ = 0;
+
+  connection_source_.fd = connection_fd_;
+  connection_source_.mask = remote::FdSource::kReadable |
+                            remote::FdSource::kHangup |
+                            remote::FdSource::kError;
+  connection_source_.callback = [this](int /*fd*/, uint32_t mask) {
+    if (mask & remote::FdSource::kWritable) Flush();
+    if (connection_fd_ != -1 && (mask & ~remote::FdSource::kWritable)) Read();
+  };
+  loop_->AddFd(&connection_source_);
+
+  LOG_INFO("Bulk channel connected");
+
+  ArmClockSyncTimer(true);
+  SendInventory();
+  SendClockSyncRequest();
+}
+
+void
+BulkChannel::Read()
+{
+  size_t read_bytes = 0;
+
+  while (read_bytes < kMaxReadPerCallback) {
+    ssize_t result;
+
+    if (header_received_ < sizeof(Header)) {
+      result = read(connection_fd_,
+          reinterpret_cast<uint8_t *>(&header_) + header_received_,
+          sizeof(Header) - header_received_);
+      if (result > 0) {
+        header_received_ += result;
+        read_bytes += result;
+        if (header_received_ == sizeof(Header)) BeginBlob();
+        if (connection_fd_ == -1) return;
+        continue;
+      }
+    } else {
+      const uint64_t remaining = header_.size - payload_received_;
+      if (destination_) {
+        result = read(connection_fd_, destination_ + payload_received_,
+            std::min<uint64_t>(remaining, kMaxReadPerCallback - read_bytes));
+      } else {
+        result = read(connection_fd_, discard_buffer_.data(),
+            std::min<uint64_t>(remaining, discard_buffer_.size()));
+      }
+      if (result > 0) {
+        payload_received_ += result;
+        read_bytes += result;
+        stats_bytes_ += result;
+        connection_bytes_ += result;
+        if (payload_received_ == header_.size) EndBlob();
+        continue;
+      }
+    }
+
+    if (result == 0) {
+      LOG_INFO("Bulk channel disconnected");
+      Disconnect();
+      return;
+    }
+
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+    LOG_ERROR("Failed to read the bulk channel: %s", strerror(errno));
+    Disconnect();
+    return;
+  }
+}
+
+void
+BulkChannel::Disconnect()
+{
+  if (connection_fd_ == -1) return;
+
+  LogConnectionStats();
+
+  if (header_received_ == sizeof(Header) && blob_destination_ &&
+      !is_cache_only_) {
+    if (auto sink = sink_.lock()) sink->AbortBlob(header_.id);
+  }
+  blob_destination_ = nullptr;
+  destination_ = nullptr;
+  header_received_ = 0;
+
+  loop_->RemoveFd(&connection_source_);
+  close(connection_fd_);
+  connection_fd_ = -1;
+  outgoing_.clear();
+  is_writable_watched_ = false;
+  is_lod_selection_pending_ = false;
+
+  ArmClockSyncTimer(false);
+}
+
+void
+BulkChannel::BeginBlob()
+{
+  payload_received_ = 0;
+  blob_destination_ = nullptr;
+  destination_ = nullptr;
+
+  if ((FrameType)header_.type == FrameType::kClockSync) {
+    if (header_.size == sizeof(ClockSyncResponse)) {
+      destination_ = reinterpret_cast<uint8_t *>(&clock_sync_response_);
+    } else {
+      LOG_WARN("Dropping a clock sync response of %" PRIu64 " bytes",
+          header_.size);
+      discard_buffer_.resize(kDiscardBufferSize);
+    }
+    if (header_.size == 0) EndBlob();
+    return;
+  }
+
+  const auto type = (FrameType)header_.type;
+  if (type == FrameType::kSceneBounds || type == FrameType::kTransforms ||
+      type == FrameType::kShaderSources || type == FrameType::kMesh) {
+    const size_t record_size = type == FrameType::kSceneBounds
+                                   ? sizeof(BoundsRecord)
+                               : type == FrameType::kTransforms
+                                   ? sizeof(TransformRecord)
+                               : type == FrameType::kMesh ? sizeof(uint32_t)
+                                                          : 1;
+    // Meshes are as large as blobs
+    const uint64_t max_size =
+        type == FrameType::kMesh ? max_blob_size_ : kMaxSceneDataSize;
+    if ((Codec)header_.codec == Codec::kNone &&
+        header_.size == header_.raw_size &&
+        header_.size % record_size == 0 && header_.size <= max_size) {
+      scene_data_.resize(header_.size);
+      destination_ = scene_data_.data();
+    } else {
+      LOG_WARN("Dropping a scene frame of type %u of %" PRIu64 " bytes",
+          header_.type, header_.size);
+      discard_buffer_.resize(kDiscardBufferSize);
+    }
+    if (header_.size == 0) EndBlob();
+    return;
+  }
+
+  if ((FrameType)header_.type == FrameType::kCachedBlob) {
+    if (header_.size != 0) {
+      LOG_WARN("Dropping a cached blob frame with %" PRIu64 " bytes of data",
+          header_.size);
+      discard_buffer_.resize(kDiscardBufferSize);
+      return;
+    }
+    ServeCachedBlob();
+    EndBlob();
+    return;
+  }
+
+  // Sizes come from the peer; never allocate or wait for more than allowed
+  const bool is_too_large = header_.raw_size > max_blob_size_ ||
+                            header_.size > max_blob_size_ ||
+                            header_.size > Lz4CompressBound(header_.raw_size);
+  if (is_too_large) {
+    LOG_ERROR("Bulk blob %" PRIu64 " of %" PRIu64 " bytes (%" PRIu64
+              " on the wire) is out of the limits; disconnecting",
+        header_.id, header_.raw_size, header_.size);
+    Disconnect();
+    return;
+  }
+
+  const auto codec = (Codec)header_.codec;
+  const bool is_valid = codec == Codec::kNone
+                            ? header_.size == header_.raw_size
+                            : codec == Codec::kLz4;
+
+  if (!is_valid) {
+    LOG_WARN("Dropping the bulk blob %" PRIu64 " with codec %u", header_.id,
+        header_.codec);
+  } else if (auto sink = sink_.lock()) {
+    blob_destination_ =
+        static_cast<uint8_t *>(sink->BeginBlob(header_.id, header_.raw_size));
+  }
+
+  // Received for the cache alone, for later connections to reuse
+  is_cache_only_ = false;
+  if (is_valid && blob_destination_ == nullptr &&
+      (FrameType)header_.type == FrameType::kCacheableBlob &&
+      !content_cache_.expired()) {
+    cache_only_blob_.resize(header_.raw_size);
+    blob_destination_ = cache_only_blob_.data();
+    is_cache_only_ = true;
+  }
+
+  if (blob_destination_ == nullptr) {
+    dropped_blobs_++;
+    discard_buffer_.resize(kDiscardBufferSize);
+  } else if (codec == Codec::kNone) {
+    destination_ = blob_destination_;
+  } else {
+    compressed_.resize(header_.size);
+    destination_ = compressed_.data();
+  }
+
+  if (header_.size == 0) EndBlob();
+}
+
+void
+BulkChannel::EndBlob()
+{
+  header_received_ = 0;
+
+  auto latency_sink = latency_sink_.lock();
+
+  if ((FrameType)header_.type == FrameType::kClockSync) {
+    if (latency_sink && destination_) {
+      latency_sink->AddClockSyncSample(clock_sync_response_.t0,
+          clock_sync_response_.t1, clock_sync_response_.t2, ClockSync::Now());
+    }
+    destination_ = nullptr;
+    return;
+  }
+
+  if ((FrameType)header_.type == FrameType::kSceneBounds) {
+    if (destination_) ApplySceneBounds();
+    destination_ = nullptr;
+    return;
+  }
+
+  if ((FrameType)header_.type == FrameType::kTransforms) {
+    if (destination_) ApplyTransforms();
+    destination_ = nullptr;
+    return;
+  }
+
+  if ((FrameType)header_.type == FrameType::kShaderSources) {
+    if (destination_) ApplyShaderSources();
+    destination_ = nullptr;
+    return;
+  }
+
+  if ((FrameType)header_.type == FrameType::kMesh) {
+    if (destination_) ApplyMesh();
+    destination_ = nullptr;
+    return;
+  }
+
+  if (latency_sink) {
+    latency_sink->OnReceived(header_.send_time, ClockSync::Now());
+  }
+
+  stats_blobs_++;
+
+  std::weak_ptr<ContentCache> content_cache;
+  if ((FrameType)header_.type == FrameType::kCacheableBlob) {
+    content_cache = content_cache_;
+  }
+
+  if (blob_destination_ && (Codec)header_.codec == Codec::kNone) {
+    auto cache = content_cache.lock();
+    if (cache && is_cache_only_) {
+      worker_pool_->Post([content_cache, id = header_.id,
+                             data = std::move(cache_only_blob_)] {
+        if (auto cache = content_cache.lock()) {
+          cache->Put(id, data.data(), data.size());
+        }
+      });
+      stats_raw_bytes_ += header_.raw_size;
+    } else if (cache) {
+      // Cached straight from the sink's memory, which it owns once it ends
+      worker_pool_->Post([shared = shared_, content_cache, id = header_.id,
+                             data = blob_destination_,
+                             size = header_.raw_size] {
+        if (auto cache = content_cache.lock()) cache->Put(id, data, size);
+
+        {
+          std::lock_guard<std::mutex> lock(shared->mutex);
+          shared->prepared.push_back(
+              Prepared{id, true, false, size, std::chrono::nanoseconds(0)});
+        }
+
+        uint64_t count = 1;
+        write(shared->event_fd, &count, sizeof(count));
+      });
+    } else {
+      stats_raw_bytes_ += header_.raw_size;
+      if (auto sink = sink_.lock(); sink && !is_cache_only_) {
+        sink->EndBlob(header_.id);
+      }
+    }
+  } else if (blob_destination_) {
+    worker_pool_->Post([shared = shared_, content_cache, id = header_.id,
+                           compressed = std::move(compressed_),
+                           is_cache_only = is_cache_only_,
+                           cache_only_blob = std::move(cache_only_blob_),
+                           out = blob_destination_,
+                           size = header_.raw_size]() mutable {
+      // Owned by the task when there is no sink to write to
+      if (is_cache_only) out = cache_only_blob.data();
+
+      auto begin = std::chrono::steady_clock::now();
+      bool is_succeeded =
+          lz4::DecompressBlock(compressed.data(), compressed.size(), out, size);
+      auto decompress_time = std::chrono::steady_clock::now() - begin;
+
+      if (auto cache = content_cache.lock(); cache && is_succeeded) {
+        cache->Put(id, out, size);
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->prepared.push_back(
+            Prepared{id, is_succeeded, is_cache_only, size, decompress_time});
+      }
+
+      uint64_t count = 1;
+      write(shared->event_fd, &count, sizeof(count));
+    });
+    compressed_ = std::vector<uint8_t>();
+  }
+
+  cache_only_blob_ = std::vector<uint8_t>();
+  is_cache_only_ = false;
+  blob_destination_ = nullptr;
+  destination_ = nullptr;
+
+  UpdateStats();
+}
+
+void
+BulkChannel::ApplySceneBounds()
+{
+  auto scene_sink = scene_sink_.lock();
+  if (!scene_sink) return;
+
+  for (size_t offset = 0; offset < scene_data_.size();
+       offset += sizeof(BoundsRecord)) {
+    BoundsRecord record;
+    memcpy(&record, scene_data_.data() + offset, sizeof(record));
+
+    if (record.flags & kBoundsRemoved) {
+      scene_sink->Remove(record.id);
+      continue;
+    }
+
+    Aabb bounds;
+    bounds.min = glm::vec3(record.min[0], record.min[1], record.min[2]);
+    bounds.max = glm::vec3(record.max[0], record.max[1], record.max[2]);
+    scene_sink->SetBounds(record.id, bounds);
+  }
+}
+
+void
+BulkChannel::ApplyTransforms()
+{
+  auto scene_sink = scene_sink_.lock();
+  if (!scene_sink) return;
+
+  const int64_t receive_time = ClockSync::Now();
+
+  for (size_t offset = 0; offset < scene_data_.size();
+       offset += sizeof(TransformRecord)) {
+    TransformRecord record;
+    memcpy(&record, scene_data_.data() + offset, sizeof(record));
+
+    const XrPosef pose{
+        {record.orientation[0], record.orientation[1], record.orientation[2],
+            record.orientation[3]},
+        {record.position[0], record.position[1], record.position[2]}};
+    scene_sink->SetPose(record.id, record.time, receive_time, pose);
+  }
+}
+
+void
+BulkChannel::ApplyShaderSources()
+{
+  auto shader_sink = shader_sink_.lock();
+  if (!shader_sink) return;
+
+  uint32_t sizes[2];
+  if (scene_data_.size() < sizeof(sizes)) {
+    LOG_WARN("Dropping shader sources of %zu bytes", scene_data_.size());
+    return;
+  }
+  memcpy(sizes, scene_data_.data(), sizeof(sizes));
+  if (sizeof(sizes) + (uint64_t)sizes[0] + sizes[1] != scene_data_.size()) {
+    LOG_WARN("Dropping shader sources of %u and %u bytes in a frame of %zu",
+        sizes[0], sizes[1], scene_data_.size());
+    return;
+  }
+
+  auto text =
+      reinterpret_cast<const char *>(scene_data_.data()) + sizeof(sizes);
+  shader_sink->SetShaderSources(
+      std::string(text, sizes[0]), std::string(text + sizes[0], sizes[1]));
+}
+
+void
+BulkChannel::ApplyMesh()
+{
+  auto mesh_sink = mesh_sink_.lock();
+  if (!mesh_sink) return;
+
+  uint32_t counts[2];
+  if (scene_data_.size() < sizeof(counts)) {
+    LOG_WARN("Dropping a mesh of %zu bytes", scene_data_.size());
+    return;
+  }
+  memcpy(counts, scene_data_.data(), sizeof(counts));
+  const uint64_t vertex_count = counts[0];
+  const uint64_t index_count = counts[1];
+  if (sizeof(counts) + vertex_count * sizeof(glm::vec3) +
+              index_count * sizeof(uint32_t) !=
+          scene_data_.size() ||
+      index_count % 3 != 0) {
+    LOG_WARN("Dropping a mesh of %" PRIu64 " vertices and %" PRIu64
+             " indices in a frame of %zu bytes",
+        vertex_count, index_count, scene_data_.size());
+    return;
+  }
+
+  std::vector<glm::vec3> positions(vertex_count);
+  std::vector<uint32_t> indices(index_count);
+  const uint8_t *data = scene_data_.data() + sizeof(counts);
+  memcpy(positions.data(), data, vertex_count * sizeof(glm::vec3));
+  memcpy(indices.data(), data + vertex_count * sizeof(glm::vec3),
+      index_count * sizeof(uint32_t));
+
+  mesh_sink->SetMesh(header_.id, std::move(positions), std::move(indices));
+}
+
+void
+BulkChannel::ServeCachedBlob()
+{
+  auto cache = content_cache_.lock();
+  auto mapping = cache ? cache->Get(header_.id) : nullptr;
+  if (!mapping) {
+    connection_cache_misses_++;
+    Send(MessageType::kCacheMiss, &header_.id, sizeof(header_.id));
+    return;
+  }
+
+  connection_cache_hits_++;
+  connection_cached_bytes_ += mapping->size();
+
+  auto sink = sink_.lock();
+  void *out = sink ? sink->BeginBlob(header_.id, mapping->size()) : nullptr;
+  if (out == nullptr) {
+    dropped_blobs_++;
+    return;
+  }
+
+  worker_pool_->Post([shared = shared_, id = header_.id, mapping, out] {
+    memcpy(out, mapping->data(), mapping->size());
+
+    {
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      shared->prepared.push_back(Prepared{
+          id, true, false, mapping->size(), std::chrono::nanoseconds(0)});
+    }
+
+    uint64_t count = 1;
+    write(shared->event_fd, &count, sizeof(count));
+  });
+}
+
+void
+BulkChannel::FinishPrepared()
+{
+  uint64_t count;
+  read(shared_->event_fd, &count, sizeof(count));
+
+  std::deque<Prepared> prepared;
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    prepared.swap(shared_->prepared);
+  }
+
+  auto sink = sink_.lock();
+
+  for (auto &blob : prepared) {
+    stats_raw_bytes_ += blob.raw_size;
+    stats_decompress_time_ += blob.decompress_time;
+
+    if (!blob.is_succeeded) {
+      LOG_WARN("Failed to decompress the bulk blob %" PRIu64, blob.id);
+      if (sink && !blob.is_cache_only) sink->AbortBlob(blob.id);
+      continue;
+    }
+
+    if (sink && !blob.is_cache_only) sink->EndBlob(blob.id);
+  }
+}
+
+void
+BulkChannel::Send(MessageType type, const void *data, size_t size)
+{
+  if (connection_fd_ == -1) return;
+
+  MessageHeader header{(uint32_t)type, (uint32_t)size};
+  auto header_bytes = reinterpret_cast<const uint8_t *>(&header);
+  auto bytes = static_cast<const uint8_t *>(data);
+  outgoing_.insert(
+      outgoing_.end(), header_bytes, header_bytes + sizeof(header));
+  outgoing_.insert(outgoing_.end(), bytes, bytes + size);
+
+  Flush();
+}
+
+void
+BulkChannel::Flush()
+{
+  while (!outgoing_.empty()) {
+    ssize_t result = send(connection_fd_, outgoing_.data(), outgoing_.size(),
+        MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (result > 0) {
+      outgoing_.erase(outgoing_.begin(), outgoing_.begin() + result);
+      continue;
+    }
+
+    if (errno == EINTR) continue;
+    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+    LOG_ERROR("Failed to write the bulk channel: %s", strerror(errno));
+    Disconnect();
+    return;
+  }
+
+  if (outgoing_.empty() && is_lod_selection_pending_) {
+    is_lod_selection_pending_ = false;
+    Send(MessageType::kLodSelection, lod_selection_.data(),
+        lod_selection_.size() * sizeof(SelectionRecord));
+    return;
+  }
+
+  WatchWritable(!outgoing_.empty());
+}
+
+void
+BulkChannel::WatchWritable(bool is_watched)
+{
+  if (is_writable_watched_ == is_watched) return;
+  is_writable_watched_ = is_watched;
+
+  loop_->RemoveFd(&connection_source_);
+  if (is_watched) {
+    connection_source_.mask |= remote::FdSource::kWritable;
+  } else {
+    connection_source_.mask &= ~remote::FdSource::kWritable;
+  }
+  loop_->AddFd(&connection_source_);
+}
+
+void
+BulkChannel::SendInventory()
+{
+  std::vector<uint64_t> hashes;
+  if (auto cache = content_cache_.lock()) hashes = cache->Hashes();
+
+  Send(MessageType::kInventory, hashes.data(),
+      hashes.size() * sizeof(uint64_t));
+}
+
+void
+BulkChannel::SendClockSyncRequest()
+{
+  // A request queued behind others would measure the queue, not the link
+  if (connection_fd_ == -1 || !outgoing_.empty()) return;
+
+  int64_t t0 = ClockSync::Now();
+  Send(MessageType::kClockSyncRequest, &t0, sizeof(t0));
+}
+
+void
+BulkChannel::SendHandJoints(const uint8_t *data, size_t size)
+{
+  if (connection_fd_ == -1 || !outgoing_.empty()) return;
+
+  Send(MessageType::kHandJoints, data, size);
+}
+
+void
+BulkChannel::SendGpuMemoryUsage(const GpuMemoryUsage &usage)
+{
+  static_assert(sizeof(GpuMemoryUsage) ==
+                    sizeof(uint64_t) * (3 + (size_t)GpuMemoryCategory::kCount),
+      "GpuMemoryUsage is sent as is");
+
+  if (connection_fd_ == -1 || !outgoing_.empty()) return;
+
+  Send(MessageType::kGpuMemoryUsage, &usage, sizeof(usage));
+}
+
+void
+BulkChannel::SendLodSelection(
+    const std::vector<LodSelector::Selection> &selected)
+{
+  if (connection_fd_ == -1) return;
+
+  lod_selection_.clear();
+  for (const auto &selection : selected) {
+    lod_selection_.push_back(SelectionRecord{selection.id, selection.lod, 0});
+  }
+
+  // At most one selection queued, replaced until the queue drains
+  if (!outgoing_.empty()) {
+    is_lod_selection_pending_ = true;
+    return;
+  }
+
+  Send(MessageType::kLodSelection, lod_selection_.data(),
+      lod_selection_.size() * sizeof(SelectionRecord));
+}
+
+void
+BulkChannel::SendLevels(uint64_t id, const std::vector<mesh::Level> &levels)
+{
+  if (connection_fd_ == -1 || levels.empty()) return;
+
+  std::vector<uint8_t> message(sizeof(uint64_t) + 2 * sizeof(uint32_t));
+  const uint32_t level_count = levels.size() - 1;
+  memcpy(message.data(), &id, sizeof(id));
+  memcpy(message.data() + sizeof(id), &level_count, sizeof(level_count));
+
+  // The server has the full mesh
+  for (size_t i = 1; i < levels.size(); i++) {
+    const auto &level = levels[i];
+    const uint32_t index_count = level.indices.size();
+    const size_t offset = message.size();
+    message.resize(offset + sizeof(level.error) + sizeof(index_count) +
+                   index_count * sizeof(uint32_t));
+    uint8_t *out = message.data() + offset;
+    memcpy(out, &level.error, sizeof(level.error));
+    memcpy(out + sizeof(level.error), &index_count, sizeof(index_count));
+    memcpy(out + sizeof(level.error) + sizeof(index_count),
+        level.indices.data(), index_count * sizeof(uint32_t));
+  }
+
+  Send(MessageType::kMeshLevels, message.data(), message.size());
+}
+
+void
+BulkChannel::ArmClockSyncTimer(bool is_armed)
+{
+  itimerspec spec{};
+  if (is_armed) {
+    spec.it_value.tv_sec = kClockSyncPeriod.count();
+    spec.it_interval.tv_sec = kClockSyncPeriod.count();
+  }
+  timerfd_settime(timer_fd_, 0, &spec, nullptr);
+}
+
+void
+BulkChannel::UpdateStats()
+{
+  auto now = std::chrono::steady_clock::now();
+  auto elapsed = now - stats_begin_;
+  if (elapsed < kStatsPeriod) return;
+
+  float seconds = std::chrono::duration<float>(elapsed).count();
+  LOG_DEBUG("Bulk channel: %.1f MiB/s on the wire, %.1f MiB/s decompressed "
+            "(%.1f ms decompressing), %.1f blobs/s, %" PRIu64
+            " dropped in total",
+      (float)stats_bytes_ / 1024 / 1024 / seconds,
+      (float)stats_raw_bytes_ / 1024 / 1024 / seconds,
+      std::chrono::duration<float, std::milli>(stats_decompress_time_).count(),
+      (float)stats_blobs_ / seconds, dropped_blobs_);
+
+  stats_begin_ = now;
+  stats_bytes_ = 0;
+  stats_raw_bytes_ = 0;
+  stats_blobs_ = 0;
+  stats_decompress_time_ = std::chrono::nanoseconds::zero();
+}
+
+void
+BulkChannel::LogConnectionStats()
+{
+  float seconds = std::chrono::duration<float>(
+      std::chrono::steady_clock::now() - connection_begin_)
+                      .count();
+  LOG_INFO("Bulk channel connection of %.1f s: %.1f MiB over the wire, %.1f "
+           "MiB from the content cache (%" PRIu64 " hits, %" PRIu64
+           " misses)",
+      seconds, (float)connection_bytes_ / 1024 / 1024,
+      (float)connection_cached_bytes_ / 1024 / 1024, connection_cache_hits_,
+      connection_cache_misses_);
+
+  if (auto cache = content_cache_.lock()) cache->LogStats();
+}
+
+}  // namespace zen::mirror
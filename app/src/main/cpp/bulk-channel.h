@@ -0,0 +1,396 @@
+#pragma once
+
+#include "bvh.h"
+#include "common.h"
+#include "content-cache.h"
+#include "gpu-memory-budget.h"
+#include "hand-joints.h"
+#include "lod-selector.h"
+#include "mesh-simplifier.h"
+#include "worker-pool.h"
+
+namespace zen::mirror {
+
+/**
+ * Raw TCP stream next to the gRPC session for large and frequent data, read
+ * straight into the memory the sink provides (e.g. a mapped upload buffer)
+ * instead of going through protobuf messages. The wire format is in
+ * doc/BULK_CHANNEL.adoc.
+ *
+ * The channel handles the framing, the compression, the content cache and
+ * the clock sync requests; each kind of frame goes to the sink of its
+ * feature. One connection is served at a time, on the loopback interface
+ * only. The fds are polled through the given loop, so the sinks are called
+ * on the loop thread. Compressed blobs, cached blobs and the blobs put in the
+ * cache are prepared on the worker pool, so their EndBlob may come after those
+ * of later blobs.
+ */
+class BulkChannel : public IHandJointsSink,
+                    public GpuMemoryBudget::ISink,
+                    public LodSelector::ISink,
+                    public mesh::ILevelsSink {
+ public:
+  struct ISink;
+  struct ISceneSink;
+  struct IShaderSink;
+  struct IMeshSink;
+  struct ILatencySink;
+
+  enum class Codec : uint32_t { kNone = 0, kLz4 = 1 };
+  enum class FrameType : uint32_t {
+    kBlob = 0,
+    kClockSync = 1,
+    kCacheableBlob = 2,
+    kCachedBlob = 3,
+    kSceneBounds = 4,
+    kTransforms = 5,
+    kShaderSources = 6,
+    kMesh = 7,
+  };
+  enum class MessageType : uint32_t {
+    kClockSyncRequest = 0,
+    kInventory = 1,
+    kCacheMiss = 2,
+    kHandJoints = 3,
+    kGpuMemoryUsage = 4,
+    kMeshLevels = 5,
+    kLodSelection = 6,
+  };
+
+  static constexpr uint32_t kMagic = 0x4b4c425a;  // "ZBLK"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kBoundsRemoved = 1;
+  static constexpr std::chrono::seconds kClockSyncPeriod{1};
+
+  DISABLE_MOVE_AND_COPY(BulkChannel);
+  BulkChannel(std::shared_ptr<remote::ILoop> loop, WorkerPool *worker_pool,
+      uint64_t compression_threshold, uint64_t max_blob_size)
+      : loop_(std::move(loop)),
+        worker_pool_(worker_pool),
+        compression_threshold_(compression_threshold),
+        max_blob_size_(max_blob_size),
+        shared_(std::make_shared<Shared>())
+  {
+  }
+  ~BulkChannel() override;
+
+  /* Listen on the local `port`, or on an ephemeral port if 0 */
+  bool Init(uint16_t port);
+
+  /* Blobs are dropped while no sink is set */
+  inline void set_sink(std::weak_ptr<ISink> sink);
+
+  /* Fed with the kSceneBounds and kTransforms frames */
+  inline void set_scene_sink(std::weak_ptr<ISceneSink> scene_sink);
+
+  /* Fed with the kShaderSources frames */
+  inline void set_shader_sink(std::weak_ptr<IShaderSink> shader_sink);
+
+  /* Fed with the kMesh frames */
+  inline void set_mesh_sink(std::weak_ptr<IMeshSink> mesh_sink);
+
+  /* Fed with the clock sync responses and the arrival of blobs */
+  inline void set_latency_sink(std::weak_ptr<ILatencySink> latency_sink);
+
+  /**
+   * Cacheable blobs are stored in it, whether the sink takes them or not,
+   * and cached blobs are read from it
+   */
+  inline void set_content_cache(std::weak_ptr<ContentCache> content_cache);
+
+  /* The port to advertise to the server; available after Init succeeds */
+  inline uint16_t port() const;
+
+  void SendHandJoints(const uint8_t *data, size_t size) override;
+  void SendGpuMemoryUsage(const GpuMemoryUsage &usage) override;
+  void SendLodSelection(
+      const std::vector<LodSelector::Selection> &selected) override;
+  void SendLevels(
+      uint64_t id, const std::vector<mesh::Level> &levels) override;
+
+ private:
+  struct Hello {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t codecs;
+    uint32_t reserved;
+    uint64_t compression_threshold;
+  };
+
+  struct Header {
+    uint64_t id;
+    uint64_t size;
+    uint64_t raw_size;
+    int64_t send_time;
+    uint32_t codec;
+    uint32_t type;
+  };
+
+  struct MessageHeader {
+    uint32_t type;
+    uint32_t size;
+  };
+
+  struct BoundsRecord {
+    uint64_t id;
+    uint32_t flags;
+    uint32_t reserved;
+    float min[3];
+    float max[3];
+  };
+
+  struct TransformRecord {
+    int64_t time;
+    uint64_t id;
+    float position[3];
+    float orientation[4];
+    uint32_t reserved;
+  };
+
+  struct SelectionRecord {
+    uint64_t id;
+    uint32_t level;
+    uint32_t reserved;
+  };
+
+  struct ClockSyncResponse {
+    int64_t t0;
+    int64_t t1;
+    int64_t t2;
+  };
+
+  /**
+   * A blob prepared on the worker pool: decompressed, read from the cache, or
+   * put in the cache from the sink's memory
+   */
+  struct Prepared {
+    uint64_t id;
+    bool is_succeeded;
+    bool is_cache_only;  // not for the sink
+    uint64_t raw_size;
+    std::chrono::nanoseconds decompress_time;  // 0 if not decompressed
+  };
+
+  /* Shared with the tasks on the worker pool, which may outlive this */
+  struct Shared {
+    DISABLE_MOVE_AND_COPY(Shared);
+    Shared() = default;
+    ~Shared();
+
+    int event_fd{-1};  // signaled when a blob is prepared
+    std::mutex mutex;
+    std::deque<Prepared> prepared;  // guarded by mutex
+  };
+
+  void Accept();
+  void Read();
+  void Disconnect();
+
+  /* May disconnect */
+  void BeginBlob();
+  void EndBlob();
+
+  /* Hand the received bounds to the scene sink */
+  void ApplySceneBounds();
+
+  /* Hand the received poses to the scene sink */
+  void ApplyTransforms();
+
+  /* Hand the received shader sources to the shader sink */
+  void ApplyShaderSources();
+
+  /* Hand the received mesh to the mesh sink */
+  void ApplyMesh();
+
+  /* Copy a cached blob to the sink on the worker pool */
+  void ServeCachedBlob();
+
+  /* Hand the prepared blobs to the sink */
+  void FinishPrepared();
+
+  /* Queue a message and send as much of the queue as the socket takes */
+  void Send(MessageType type, const void *data, size_t size);
+  void Flush();
+  void WatchWritable(bool is_watched);
+
+  void SendInventory();
+
+  void SendClockSyncRequest();
+  void ArmClockSyncTimer(bool is_armed);
+
+  void UpdateStats();
+  void LogConnectionStats();
+
+  // Yield to the frame loop after reading this much in one callback
+  static constexpr size_t kMaxReadPerCallback = 8 * 1024 * 1024;
+  static constexpr int kReceiveBufferSize = 4 * 1024 * 1024;
+  static constexpr size_t kDiscardBufferSize = 64 * 1024;
+  static constexpr size_t kMaxSceneDataSize = 1024 * 1024;
+
+  // Write out the throughput at most this often
+  static constexpr std::chrono::seconds kStatsPeriod{5};
+
+  std::shared_ptr<remote::ILoop> loop_;
+  WorkerPool *worker_pool_;
+  const uint64_t compression_threshold_;
+  const uint64_t max_blob_size_;
+  std::shared_ptr<Shared> shared_;
+  std::weak_ptr<ISink> sink_;
+  std::weak_ptr<ISceneSink> scene_sink_;
+  std::weak_ptr<IShaderSink> shader_sink_;
+  std::weak_ptr<IMeshSink> mesh_sink_;
+  std::weak_ptr<ILatencySink> latency_sink_;
+  std::weak_ptr<ContentCache> content_cache_;
+  uint16_t port_{0};
+
+  int listen_fd_{-1};
+  int connection_fd_{-1};
+  remote::FdSource listen_source_{};
+  remote::FdSource connection_source_{};
+  std::vector<uint8_t> outgoing_;  // messages not sent yet
+  bool is_writable_watched_{false};
+  // The latest LOD selection, sent once outgoing_ is empty if pending
+  std::vector<SelectionRecord> lod_selection_;
+  bool is_lod_selection_pending_{false};
+  remote::FdSource event_source_{};
+  int timer_fd_{-1};
+  remote::FdSource timer_source_{};
+
+  Header header_{};
+  size_t header_received_{0};
+  uint8_t *blob_destination_{nullptr};  // from the sink; nullptr if dropped
+  bool is_cache_only_{false};  // blob_destination_ is cache_only_blob_
+  std::vector<uint8_t> cache_only_blob_;
+  uint8_t *destination_{nullptr};       // read into; nullptr while dropping
+  uint64_t payload_received_{0};
+  std::vector<uint8_t> compressed_;
+  ClockSyncResponse clock_sync_response_{};
+  std::vector<uint8_t> scene_data_;  // of kSceneBounds, kTransforms, ...
+  std::vector<uint8_t> discard_buffer_;
+
+  std::chrono::steady_clock::time_point stats_begin_{};
+  uint64_t stats_bytes_{0};
+  uint64_t stats_raw_bytes_{0};
+  uint64_t stats_blobs_{0};
+  std::chrono::nanoseconds stats_decompress_time_{0};
+  uint64_t dropped_blobs_{0};
+
+  // For the connection, to compare reconnects with a cold and a warm cache
+  std::chrono::steady_clock::time_point connection_begin_{};
+  uint64_t connection_bytes_{0};
+  uint64_t connection_cached_bytes_{0};
+  uint64_t connection_cache_hits_{0};
+  uint64_t connection_cache_misses_{0};
+};
+
+struct BulkChannel::ISink {
+  DISABLE_MOVE_AND_COPY(ISink);
+  ISink() = default;
+  virtual ~ISink() = default;
+
+  /**
+   * @returns where to write the `size` bytes of the blob after
+   * decompression, valid until EndBlob or AbortBlob is called, or nullptr to
+   * drop the blob. A worker thread may write compressed blobs there.
+   */
+  virtual void *BeginBlob(uint64_t id, uint64_t size) = 0;
+
+  virtual void EndBlob(uint64_t id) = 0;
+
+  /* The connection was lost or the blob was malformed */
+  virtual void AbortBlob(uint64_t id) = 0;
+};
+
+inline void
+BulkChannel::set_sink(std::weak_ptr<ISink> sink)
+{
+  sink_ = std::move(sink);
+}
+
+struct BulkChannel::ISceneSink {
+  DISABLE_MOVE_AND_COPY(ISceneSink);
+  ISceneSink() = default;
+  virtual ~ISceneSink() = default;
+
+  /* Add an object or move an existing one; in the app space */
+  virtual void SetBounds(uint64_t id, const Aabb &bounds) = 0;
+
+  virtual void Remove(uint64_t id) = 0;
+
+  /**
+   * The pose the server set at `time` of its clock, received at
+   * `receive_time` of the mirror's
+   */
+  virtual void SetPose(uint64_t id, int64_t time, int64_t receive_time,
+      const XrPosef &pose) = 0;
+};
+
+inline void
+BulkChannel::set_scene_sink(std::weak_ptr<ISceneSink> scene_sink)
+{
+  scene_sink_ = std::move(scene_sink);
+}
+
+struct BulkChannel::IShaderSink {
+  DISABLE_MOVE_AND_COPY(IShaderSink);
+  IShaderSink() = default;
+  virtual ~IShaderSink() = default;
+
+  /* The sources of a program, as soon as the server knows it will draw it */
+  virtual void SetShaderSources(std::string vertex, std::string fragment) = 0;
+};
+
+inline void
+BulkChannel::set_shader_sink(std::weak_ptr<IShaderSink> shader_sink)
+{
+  shader_sink_ = std::move(shader_sink);
+}
+
+struct BulkChannel::IMeshSink {
+  DISABLE_MOVE_AND_COPY(IMeshSink);
+  IMeshSink() = default;
+  virtual ~IMeshSink() = default;
+
+  /* A triangle list of the object `id`; indices are not checked */
+  virtual void SetMesh(uint64_t id, std::vector<glm::vec3> positions,
+      std::vector<uint32_t> indices) = 0;
+};
+
+inline void
+BulkChannel::set_mesh_sink(std::weak_ptr<IMeshSink> mesh_sink)
+{
+  mesh_sink_ = std::move(mesh_sink);
+}
+
+struct BulkChannel::ILatencySink {
+  DISABLE_MOVE_AND_COPY(ILatencySink);
+  ILatencySink() = default;
+  virtual ~ILatencySink() = default;
+
+  /* t0 and t3 of the mirror's clock, t1 and t2 of the server's */
+  virtual void AddClockSyncSample(
+      int64_t t0, int64_t t1, int64_t t2, int64_t t3) = 0;
+
+  /* A blob sent at `server_send_time` arrived at `receive_time` */
+  virtual void OnReceived(int64_t server_send_time, int64_t receive_time) = 0;
+};
+
+inline void
+BulkChannel::set_latency_sink(std::weak_ptr<ILatencySink> latency_sink)
+{
+  latency_sink_ = std::move(latency_sink);
+}
+
+inline void
+BulkChannel::set_content_cache(std::weak_ptr<ContentCache> content_cache)
+{
+  content_cache_ = std::move(content_cache);
+}
+
+inline uint16_t
+BulkChannel::port() const
+{
+  return port_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#include "bvh.h"
+
+namespace zen::mirror {
+
+void
+Bvh::Build(std::vector<Primitive> primitives)
+{
+  primitives_ = std::move(primitives);
+  nodes_.clear();
+  primitive_indices_.clear();
+  primitive_leaves_.resize(primitives_.size());
+
+  if (primitives_.empty()) return;
+
+  // A binary tree with leaves of at least one primitive
+  nodes_.reserve(primitives_.size() * 2 - 1);
+  nodes_.push_back(Node{{}, kNoParent, 0, 0, 0});
+  BuildNode(0, 0, (uint32_t)primitives_.size());
+
+  for (uint32_t i = 0; i < primitives_.size(); i++) {
+    primitive_indices_[primitives_[i].id] = i;
+  }
+}
+
+void
+Bvh::BuildNode(uint32_t index, uint32_t first, uint32_t count)
+{
+  Aabb bounds;
+  Aabb centroid_bounds;
+  for (uint32_t i = first; i < first + count; i++) {
+    const Aabb &primitive_bounds = primitives_[i].bounds;
+    glm::vec3 centroid = (primitive_bounds.min + primitive_bounds.max) * 0.5f;
+    bounds.Extend(primitive_bounds);
+    centroid_bounds.Extend(Aabb{centroid, centroid});
+  }
+  nodes_[index].bounds = bounds;
+
+  if (count <= kMaxLeafSize) {
+    nodes_[index].first = first;
+    nodes_[index].count = count;
+    for (uint32_t i = first; i < first + count; i++) {
+      primitive_leaves_[i] = index;
+    }
+    return;
+  }
+
+  // Median split along the axis where the centroids spread the most
+  glm::vec3 extent = centroid_bounds.max - centroid_bounds.min;
+  int axis = 0;
+  if (extent.y > extent[axis]) axis = 1;
+  if (extent.z > extent[axis]) axis = 2;
+
+  uint32_t half = count / 2;
+  auto begin = primitives_.begin() + first;
+  std::nth_element(begin, begin + half, begin + count,
+      [axis](const Primitive &a, const Primitive &b) {
+        return a.bounds.min[axis] + a.bounds.max[axis] <
+               b.bounds.min[axis] + b.bounds.max[axis];
+      });
+
+  uint32_t left = (uint32_t)nodes_.size();
+  nodes_[index].left = left;
+  nodes_.push_back(Node{{}, index, 0, 0, 0});
+  nodes_.push_back(Node{{}, index, 0, 0, 0});
+
+  BuildNode(left, first, half);
+  BuildNode(left + 1, first + half, count - half);
+}
+
+bool
+Bvh::Refit(uint64_t id, const Aabb &bounds)
+{
+  auto it = primitive_indices_.find(id);
+  if (it == primitive_indices_.end()) return false;
+
+  primitives_[it->second].bounds = bounds;
+
+  uint32_t index = primitive_leaves_[it->second];
+  {
+    Node &leaf = nodes_[index];
+    leaf.bounds = Aabb{};
+    for (uint32_t i = leaf.first; i < leaf.first + leaf.count; i++) {
+      leaf.bounds.Extend(primitives_[i].bounds);
+    }
+  }
+
+  for (index = nodes_[index].parent; index != kNoParent;
+       index = nodes_[index].parent) {
+    Node &node = nodes_[index];
+    node.bounds = nodes_[node.left].bounds;
+    node.bounds.Extend(nodes_[node.left + 1].bounds);
+  }
+
+  return true;
+}
+
+bool
+Bvh::Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+    float max_distance, Hit *hit) const
+{
+  if (nodes_.empty()) return false;
+
+  // Division by zero gives infinity, which the slab test handles
+  const glm::vec3 inverse_direction(
+      1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+  float nearest = max_distance;
+  bool found = false;
+
+  // Deep enough for a median-split tree of 2^32 primitives
+  std::array<uint32_t, 64> stack;
+  size_t stack_size = 0;
+  if (nodes_[0].bounds.Intersect(origin, inverse_direction, nearest) >= 0) {
+    stack[stack_size++] = 0;
+  }
+
+  while (stack_size > 0) {
+    const Node &node = nodes_[stack[--stack_size]];
+
+    if (node.count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.count; i++) {
+        float distance =
+            primitives_[i].bounds.Intersect(origin, inverse_direction, nearest);
+        if (distance < 0) continue;
+        nearest = distance;
+        hit->id = primitives_[i].id;
+        hit->distance = distance;
+        found = true;
+      }
+      continue;
+    }
+
+    float left = nodes_[node.left].bounds.Intersect(
+        origin, inverse_direction, nearest);
+    float right = nodes_[node.left + 1].bounds.Intersect(
+        origin, inverse_direction, nearest);
+
+    // Push the farther child first to visit the nearer one first
+    if (left >= 0 && right >= 0) {
+      bool left_first = left <= right;
+      stack[stack_size++] = left_first ? node.left + 1 : node.left;
+      stack[stack_size++] = left_first ? node.left : node.left + 1;
+    } else if (left >= 0) {
+      stack[stack_size++] = node.left;
+    } else if (right >= 0) {
+      stack[stack_size++] = node.left + 1;
+    }
+  }
+
+  return found;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+struct Aabb {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+  inline void Extend(const Aabb &other);
+
+  /**
+   * Slab test against a ray given with the reciprocal of its direction.
+   * @returns the distance to the entry point, or a negative value on miss
+   */
+  inline float Intersect(const glm::vec3 &origin,
+      const glm::vec3 &inverse_direction, float max_distance) const;
+};
+
+/**
+ * Bounding volume hierarchy over axis-aligned boxes identified by id.
+ *
+ * Build is O(n log n). Refit moves a single box and updates its ancestors in
+ * O(depth) without changing the topology, so the tree gets looser as boxes
+ * move far from where they were when it was built.
+ */
+class Bvh {
+ public:
+  struct Primitive {
+    uint64_t id;
+    Aabb bounds;
+  };
+
+  struct Hit {
+    uint64_t id;
+    float distance;
+  };
+
+  DISABLE_MOVE_AND_COPY(Bvh);
+  Bvh() = default;
+  ~Bvh() = default;
+
+  void Build(std::vector<Primitive> primitives);
+
+  /**
+   * @returns false if the primitive is not in the tree
+   */
+  bool Refit(uint64_t id, const Aabb &bounds);
+
+  /**
+   * Find the nearest box hit by the ray. `direction` must be normalized.
+   * @returns false on miss
+   */
+  bool Raycast(const glm::vec3 &origin, const glm::vec3 &direction,
+      float max_distance, Hit *hit) const;
+
+  inline size_t primitive_count() const;
+  inline size_t node_count() const;
+
+ private:
+  struct Node {
+    Aabb bounds;
+    uint32_t parent;
+    uint32_t left;   // right child is left + 1; used if count == 0
+    uint32_t first;  // index into primitives_; used if count > 0
+    uint32_t count;
+  };
+
+  static constexpr uint32_t kMaxLeafSize = 4;
+  static constexpr uint32_t kNoParent = UINT32_MAX;
+
+  void BuildNode(uint32_t index, uint32_t first, uint32_t count);
+
+  std::vector<Node> nodes_;  // nodes_[0] is the root
+  std::vector<Primitive> primitives_;
+  std::vector<uint32_t> primitive_leaves_;  // same order as primitives_
+  std::unordered_map<uint64_t, uint32_t> primitive_indices_;
+};
+
+inline void
+Aabb::Extend(const Aabb &other)
+{
+  min = glm::min(min, other.min);
+  max = glm::max(max, other.max);
+}
+
+inline float
+Aabb::Intersect(const glm::vec3 &origin, const glm::vec3 &inverse_direction,
+    float max_distance) const
+{
+  float near = 0.f;
+  float far = max_distance;
+  for (int axis = 0; axis < 3; axis++) {
+    float t0 = (min[axis] - origin[axis]) * inverse_direction[axis];
+    float t1 = (max[axis] - origin[axis]) * inverse_direction[axis];
+    if (t0 > t1) std::swap(t0, t1);
+    near = std::max(near, t0);
+    far = std::min(far, t1);
+    if (near > far) return -1.f;
+  }
+  return near;
+}
+
+inline size_t
+Bvh::primitive_count() const
+{
+  return primitives_.size();
+}
+
+inline size_t
+Bvh::node_count() const
+{
+  return nodes_.size();
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,28 @@
+#include "pch.h"
+
+#include "clock-sync.h"
+
+namespace zen::mirror {
+
+void
+ClockSync::AddSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3)
+{
+  Sample sample;
+  sample.offset = ((t1 - t0) + (t2 - t3)) / 2;
+  sample.round_trip = (t3 - t0) - (t2 - t1);
+  if (sample.round_trip < 0) return;  // a broken or replayed response
+
+  samples_[sample_count_ % kWindowSize] = sample;
+  sample_count_++;
+
+  const size_t count = std::min(sample_count_, kWindowSize);
+  const Sample *best = &samples_[0];
+  for (size_t i = 1; i < count; i++) {
+    if (samples_[i].round_trip < best->round_trip) best = &samples_[i];
+  }
+
+  offset_ = best->offset;
+  round_trip_ = best->round_trip;
+}
+
+}  // namespace zen::mirror
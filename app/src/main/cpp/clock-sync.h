@@ -0,0 +1,86 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Estimates the offset of the server's monotonic clock from the mirror's,
+ * NTP style, from request-response exchanges:
+ *   t0: the mirror sends a request    (mirror clock)
+ *   t1: the server receives it        (server clock)
+ *   t2: the server sends the response (server clock)
+ *   t3: the mirror receives it        (mirror clock)
+ *
+ * The exchange with the shortest round trip among the recent ones is the
+ * least affected by queuing and gives the offset.
+ */
+class ClockSync {
+ public:
+  DISABLE_MOVE_AND_COPY(ClockSync);
+  ClockSync() = default;
+  ~ClockSync() = default;
+
+  /* The mirror clock in nanoseconds, CLOCK_MONOTONIC on Android */
+  static inline int64_t Now();
+
+  /* All in nanoseconds */
+  void AddSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3);
+
+  /* Convert a time of the server clock to the mirror clock */
+  inline int64_t ToMirrorTime(int64_t server_time) const;
+
+  inline bool is_synchronized() const;
+
+  /* server clock - mirror clock in nanoseconds */
+  inline int64_t offset() const;
+
+  inline int64_t round_trip() const;
+
+ private:
+  struct Sample {
+    int64_t offset;
+    int64_t round_trip;
+  };
+
+  static constexpr size_t kWindowSize = 16;
+
+  std::array<Sample, kWindowSize> samples_{};
+  size_t sample_count_{0};  // total, not bounded by kWindowSize
+  int64_t offset_{0};
+  int64_t round_trip_{0};
+};
+
+inline int64_t
+ClockSync::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+inline int64_t
+ClockSync::ToMirrorTime(int64_t server_time) const
+{
+  return server_time - offset_;
+}
+
+inline bool
+ClockSync::is_synchronized() const
+{
+  return sample_count_ > 0;
+}
+
+inline int64_t
+ClockSync::offset() const
+{
+  return offset_;
+}
+
+inline int64_t
+ClockSync::round_trip() const
+{
+  return round_trip_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,34 @@
+# Build options, shared by the app and the host tests
+
+set(DISPLAY_REFRESH_RATE 90.0 CACHE STRING
+  "Preferred display refresh rate, the highest rate not exceeding it is used")
+set(ADAPTIVE_DISPLAY_REFRESH_RATE true CACHE STRING
+  "Step the display refresh rate down while frames are missed (true/false)")
+set(GPU_MEMORY_BUDGET_MB 1536 CACHE STRING
+  "GPU memory the mirror's own allocations are reported against, in MiB")
+# Not negotiated with the server; 0 turns off every feature of the bulk
+# channel, see doc/BUILD.adoc
+set(BULK_CHANNEL_PORT 0 CACHE STRING
+  "Local TCP port of the bulk data channel, through adb forward, 0 to disable")
+set(BULK_COMPRESSION_THRESHOLD 65536 CACHE STRING
+  "Size in bytes below which the bulk channel asks for uncompressed blobs")
+set(BULK_MAX_BLOB_SIZE_MB 256 CACHE STRING
+  "Largest blob the bulk channel accepts, in MiB; larger ones disconnect")
+set(CONTENT_CACHE_SIZE_MB 512 CACHE STRING
+  "Disk space for remote content kept across reconnects, in MiB")
+set(PROGRAM_BINARY_CACHE_SIZE_MB 32 CACHE STRING
+  "Disk space for linked program binaries kept across runs, in MiB")
+set(SPACE_WARP false CACHE STRING
+  "Render at half rate with depth-only application space warp if available; \
+off by default, since moving objects judder at half rate (true/false)")
+set(SPECTATOR_RATE 0 CACHE STRING
+  "Frames per second of the spectator stream of the left eye, 0 to disable")
+set(SPECTATOR_WIDTH 640 CACHE STRING
+  "Width in pixels of the spectator stream, the height follows the eye")
+set(SPECTATOR_PORT 50053 CACHE STRING
+  "Local TCP port of the spectator stream, reached through adb forward")
+
+configure_file(
+  ${CMAKE_CURRENT_LIST_DIR}/config.h.in
+  ${CMAKE_CURRENT_BINARY_DIR}/include/config.h
+)
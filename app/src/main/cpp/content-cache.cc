@@ -0,0 +1,214 @@
+#include "pch.h"
+
+#include "content-cache.h"
+#include "content-hash.h"
+#include "file-util.h"
+#include "logger.h"
+
+namespace zen::mirror {
+
+ContentCache::Mapping::~Mapping()
+{
+  if (size_ > 0) munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+bool
+ContentCache::Init()
+{
+  if (mkdir(directory_.c_str(), 0700) == -1 && errno != EEXIST) {
+    LOG_ERROR("Failed to create the content cache directory %s: %s",
+        directory_.c_str(), strerror(errno));
+    return false;
+  }
+
+  DIR *dir = opendir(directory_.c_str());
+  if (dir == nullptr) {
+    LOG_ERROR("Failed to open the content cache directory %s: %s",
+        directory_.c_str(), strerror(errno));
+    return false;
+  }
+
+  struct Found {
+    Entry entry;
+    timespec modified;
+  };
+  std::vector<Found> found;
+
+  while (dirent *ent = readdir(dir)) {
+    if (ent->d_name[0] == '.') continue;
+
+    const std::string path = directory_ + "/" + ent->d_name;
+    auto hash = ParseHashFileName(ent->d_name);
+    struct stat st;
+    if (!hash || stat(path.c_str(), &st) == -1 || !S_ISREG(st.st_mode)) {
+      unlink(path.c_str());  // temporary files left by a crash
+      continue;
+    }
+
+    found.push_back(Found{Entry{*hash, (uint64_t)st.st_size}, st.st_mtim});
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+    return std::tie(a.modified.tv_sec, a.modified.tv_nsec) <
+           std::tie(b.modified.tv_sec, b.modified.tv_nsec);
+  });
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto &item : found) {
+    entries_.push_back(item.entry);
+    index_[item.entry.hash] = std::prev(entries_.end());
+    size_ += item.entry.size;
+  }
+  Evict();
+
+  LOG_INFO("Content cache: %zu entries, %.1f / %.1f MiB", entries_.size(),
+      (float)size_ / 1024 / 1024, (float)capacity_ / 1024 / 1024);
+
+  return true;
+}
+
+bool
+ContentCache::Put(uint64_t hash, const uint8_t *data, size_t size)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index_.count(hash) > 0) return true;
+  }
+
+  if (size > capacity_) return false;
+
+  if (ContentHash(data, size) != hash) {
+    LOG_WARN("Content does not match its hash %016" PRIx64, hash);
+    return false;
+  }
+
+  uint64_t temporary_id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    temporary_id = temporary_count_++;
+  }
+
+  // Written aside and renamed into place, so that an entry is never partial
+  const std::string path = PathOf(hash);
+  const std::string temporary_path =
+      path + ".tmp" + std::to_string(temporary_id);
+
+  int fd = open(temporary_path.c_str(),
+      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    LOG_WARN("Failed to create %s: %s", temporary_path.c_str(),
+        strerror(errno));
+    return false;
+  }
+
+  const bool is_written = WriteAll(fd, data, size);
+  close(fd);
+
+  if (!is_written || rename(temporary_path.c_str(), path.c_str()) == -1) {
+    LOG_WARN("Failed to write %s: %s", path.c_str(), strerror(errno));
+    unlink(temporary_path.c_str());
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (index_.count(hash) == 0) {
+    entries_.push_back(Entry{hash, size});
+    index_[hash] = std::prev(entries_.end());
+    size_ += size;
+    Evict();
+  }
+
+  return true;
+}
+
+std::shared_ptr<const ContentCache::Mapping>
+ContentCache::Get(uint64_t hash)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = index_.find(hash);
+  if (it == index_.end()) {
+    misses_++;
+    return nullptr;
+  }
+
+  const std::string path = PathOf(hash);
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    LOG_WARN("Content cache entry %s is gone: %s", path.c_str(),
+        strerror(errno));
+    Erase(it);
+    misses_++;
+    return nullptr;
+  }
+
+  const size_t size = it->second->size;
+  void *data = nullptr;
+  if (size > 0) {
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  futimens(fd, nullptr);  // record the use for the next run
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    LOG_WARN("Failed to map %s: %s", path.c_str(), strerror(errno));
+    misses_++;
+    return nullptr;
+  }
+
+  entries_.splice(entries_.end(), entries_, it->second);
+  hits_++;
+
+  return std::make_shared<Mapping>(static_cast<const uint8_t *>(data), size);
+}
+
+std::vector<uint64_t>
+ContentCache::Hashes()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::vector<uint64_t> hashes;
+  hashes.reserve(entries_.size());
+  for (auto &entry : entries_) hashes.push_back(entry.hash);
+
+  return hashes;
+}
+
+void
+ContentCache::LogStats()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  LOG_DEBUG("Content cache: %zu entries, %.1f MiB, %" PRIu64 " hits, %" PRIu64
+            " misses, %" PRIu64 " evictions",
+      entries_.size(), (float)size_ / 1024 / 1024, hits_, misses_, evictions_);
+}
+
+std::string
+ContentCache::PathOf(uint64_t hash) const
+{
+  return directory_ + "/" + HashFileName(hash);
+}
+
+void
+ContentCache::Evict()
+{
+  while (size_ > capacity_ && !entries_.empty()) {
+    unlink(PathOf(entries_.front().hash).c_str());
+    Erase(index_.find(entries_.front().hash));
+    evictions_++;
+  }
+}
+
+void
+ContentCache::Erase(Index::iterator it)
+{
+  size_ -= it->second->size;
+  entries_.erase(it->second);
+  index_.erase(it);
+}
+
+}  // namespace zen::mirror
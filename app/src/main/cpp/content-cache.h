@@ -0,0 +1,101 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Content-addressed cache of remote resources in app storage, keyed by
+ * ContentHash, so that a reconnecting server can skip what the mirror
+ * already has.
+ *
+ * Each entry is a file named by its hash; reads are memory-mapped. The total
+ * size is bounded by evicting the least recently used entries, and file
+ * modification times carry the recency across runs. Thread safe.
+ */
+class ContentCache {
+ public:
+  class Mapping;
+
+  DISABLE_MOVE_AND_COPY(ContentCache);
+  ContentCache(std::string directory, uint64_t capacity)
+      : directory_(std::move(directory)), capacity_(capacity)
+  {
+  }
+  ~ContentCache() = default;
+
+  /* Create the directory if needed and index the entries in it */
+  bool Init();
+
+  /**
+   * Store the content unless it is already cached.
+   * @returns false if the content does not match the hash or writing failed.
+   */
+  bool Put(uint64_t hash, const uint8_t *data, size_t size);
+
+  /* @returns nullptr if not cached */
+  std::shared_ptr<const Mapping> Get(uint64_t hash);
+
+  /* In the order of least recently used first */
+  std::vector<uint64_t> Hashes();
+
+  void LogStats();
+
+ private:
+  struct Entry {
+    uint64_t hash;
+    uint64_t size;
+  };
+
+  using Index = std::unordered_map<uint64_t, std::list<Entry>::iterator>;
+
+  std::string PathOf(uint64_t hash) const;
+
+  /* Call with mutex_ locked */
+  void Evict();
+
+  /* Call with mutex_ locked */
+  void Erase(Index::iterator it);
+
+  const std::string directory_;
+  const uint64_t capacity_;
+
+  std::mutex mutex_;
+  // Least recently used first; the following are guarded by mutex_
+  std::list<Entry> entries_;
+  Index index_;
+  uint64_t size_{0};
+  uint64_t temporary_count_{0};
+  uint64_t hits_{0};
+  uint64_t misses_{0};
+  uint64_t evictions_{0};
+};
+
+/* A read-only mapping of a cached entry; stays valid even if it is evicted */
+class ContentCache::Mapping {
+ public:
+  DISABLE_MOVE_AND_COPY(Mapping);
+  Mapping(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+  ~Mapping();
+
+  inline const uint8_t *data() const;
+  inline size_t size() const;
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+};
+
+inline const uint8_t *
+ContentCache::Mapping::data() const
+{
+  return data_;
+}
+
+inline size_t
+ContentCache::Mapping::size() const
+{
+  return size_;
+}
+
+}  // namespace zen::mirror
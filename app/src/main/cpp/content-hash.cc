@@ -0,0 +1,114 @@
+#include "pch.h"
+
+#include "content-hash.h"
+
+namespace zen::mirror {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+inline uint64_t
+RotateLeft(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t
+Read64(const uint8_t *data)
+{
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;  // little endian on every target of the mirror
+}
+
+inline uint32_t
+Read32(const uint8_t *data)
+{
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+inline uint64_t
+Round(uint64_t accumulator, uint64_t input)
+{
+  accumulator += input * kPrime2;
+  accumulator = RotateLeft(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+inline uint64_t
+MergeRound(uint64_t hash, uint64_t accumulator)
+{
+  hash ^= Round(0, accumulator);
+  return hash * kPrime1 + kPrime4;
+}
+
+}  // namespace
+
+uint64_t
+ContentHash(const void *data, size_t size)
+{
+  const uint8_t *cursor = static_cast<const uint8_t *>(data);
+  const uint8_t *const end = cursor + size;
+  uint64_t hash;
+
+  if (size >= 32) {
+    uint64_t v1 = kPrime1 + kPrime2;
+    uint64_t v2 = kPrime2;
+    uint64_t v3 = 0;
+    uint64_t v4 = 0 - kPrime1;
+
+    do {
+      v1 = Round(v1, Read64(cursor));
+      v2 = Round(v2, Read64(cursor + 8));
+      v3 = Round(v3, Read64(cursor + 16));
+      v4 = Round(v4, Read64(cursor + 24));
+      cursor += 32;
+    } while (end - cursor >= 32);
+
+    hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) +
+           RotateLeft(v4, 18);
+    hash = MergeRound(hash, v1);
+    hash = MergeRound(hash, v2);
+    hash = MergeRound(hash, v3);
+    hash = MergeRound(hash, v4);
+  } else {
+    hash = kPrime5;
+  }
+
+  hash += size;
+
+  while (end - cursor >= 8) {
+    hash ^= Round(0, Read64(cursor));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+    cursor += 8;
+  }
+
+  if (end - cursor >= 4) {
+    hash ^= Read32(cursor) * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    cursor += 4;
+  }
+
+  while (cursor < end) {
+    hash ^= *cursor * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+    cursor++;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/* XXH64 with seed 0; the server must key cached content the same way */
+uint64_t ContentHash(const void *data, size_t size);
+
+}  // namespace zen::mirror
@@ -64,6 +64,19 @@ CheckEglResult(
 #define IF_EGL_FAILED(err, cmd) \
   if (std::string err = CheckEglResult(cmd, #cmd, FILE_AND_LINE); !err.empty())
 
+// clang-format off
+constexpr EGLint kContextAttribs[] = {
+    EGL_CONTEXT_CLIENT_VERSION, 3,
+    EGL_NONE,
+};
+
+constexpr EGLint kSurfaceAttribs[] = {
+    EGL_WIDTH,  16,
+    EGL_HEIGHT, 16,
+    EGL_NONE,
+};
+// clang-format on
+
 }  // namespace
 
 bool
@@ -134,29 +147,14 @@ EglInstance::Initialize()
     return false;
   }
 
-  // clang-format off
-  constexpr EGLint context_attribs[] = {
-      EGL_CONTEXT_CLIENT_VERSION, 3,
-      EGL_NONE,
-  };
-  // clang-format on
-
   context_ =
-      eglCreateContext(display_, config_, EGL_NO_CONTEXT, context_attribs);
+      eglCreateContext(display_, config_, EGL_NO_CONTEXT, kContextAttribs);
   if (context_ == EGL_NO_CONTEXT) {
     LOG_ERROR("eglCreateContext() failed: %s", EglErrorString(eglGetError()));
     return false;
   }
 
-  // clang-format off
-  constexpr EGLint surface_attribs[] = {
-      EGL_WIDTH,  16,
-      EGL_HEIGHT, 16,
-      EGL_NONE,
-  };
-  // clang-format on
-
-  surface_ = eglCreatePbufferSurface(display_, config_, surface_attribs);
+  surface_ = eglCreatePbufferSurface(display_, config_, kSurfaceAttribs);
   if (surface_ == EGL_NO_SURFACE) {
     LOG_ERROR(
         "eglCreatePbufferSurface() failed %s", EglErrorString(eglGetError()));
@@ -171,4 +169,25 @@ EglInstance::Initialize()
   return true;
 }
 
+bool
+EglInstance::CreateSharedContext(EGLContext *context, EGLSurface *surface)
+{
+  *context = eglCreateContext(display_, config_, context_, kContextAttribs);
+  if (*context == EGL_NO_CONTEXT) {
+    LOG_ERROR("eglCreateContext() failed: %s", EglErrorString(eglGetError()));
+    return false;
+  }
+
+  *surface = eglCreatePbufferSurface(display_, config_, kSurfaceAttribs);
+  if (*surface == EGL_NO_SURFACE) {
+    LOG_ERROR(
+        "eglCreatePbufferSurface() failed %s", EglErrorString(eglGetError()));
+    eglDestroyContext(display_, *context);
+    *context = EGL_NO_CONTEXT;
+    return false;
+  }
+
+  return true;
+}
+
 }  // namespace zen::mirror
@@ -12,6 +12,12 @@ class EglInstance {
 
   bool Initialize();
 
+  /**
+   * Create a context sharing objects with the main one, and a small pbuffer
+   * surface to make it current with on another thread
+   */
+  bool CreateSharedContext(EGLContext *context, EGLSurface *surface);
+
   inline EGLDisplay display();
   inline EGLConfig config();
   inline EGLDisplay context();
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+constexpr size_t kHashFileNameLength = 16;  // hex digits of uint64_t
+
+/* Name of a file keyed by a 64-bit hash */
+inline std::string
+HashFileName(uint64_t hash)
+{
+  char name[kHashFileNameLength + 1];
+  snprintf(name, sizeof(name), "%016" PRIx64, hash);
+  return name;
+}
+
+/* @returns std::nullopt if `name` is not a HashFileName */
+inline std::optional<uint64_t>
+ParseHashFileName(const char *name)
+{
+  if (strlen(name) != kHashFileNameLength) return std::nullopt;
+
+  uint64_t hash = 0;
+  for (size_t i = 0; i < kHashFileNameLength; i++) {
+    const char c = name[i];
+    uint64_t digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else {
+      return std::nullopt;
+    }
+    hash = (hash << 4) | digit;
+  }
+
+  return hash;
+}
+
+/* Retries short and interrupted writes */
+inline bool
+WriteAll(int fd, const void *data, size_t size)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t result = write(fd, bytes, size);
+    if (result == -1) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    bytes += result;
+    size -= result;
+  }
+  return true;
+}
+
+/* @returns false on an error or if the file ends first */
+inline bool
+ReadAll(int fd, void *data, size_t size)
+{
+  auto bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    ssize_t result = read(fd, bytes, size);
+    if (result == -1) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (result == 0) return false;
+    bytes += result;
+    size -= result;
+  }
+  return true;
+}
+
+}  // namespace zen::mirror
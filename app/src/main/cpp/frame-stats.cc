@@ -0,0 +1,59 @@
+#include "pch.h"
+
+#include "frame-stats.h"
+
+namespace zen::mirror {
+
+void
+FrameStats::BeginFrame(const XrFrameState &frame_state)
+{
+  frame_begin_ = Clock::now();
+
+  bool missed = false;
+  if (predicted_display_time_ != 0 && predicted_display_period_ > 0) {
+    auto elapsed = frame_state.predictedDisplayTime - predicted_display_time_;
+    missed = elapsed > predicted_display_period_ * kMissedFrameThreshold;
+  }
+
+  predicted_display_time_ = frame_state.predictedDisplayTime;
+  predicted_display_period_ = frame_state.predictedDisplayPeriod;
+
+  if (missed_window_[window_index_]) missed_frames_--;
+  missed_window_[window_index_] = missed;
+  if (missed) missed_frames_++;
+  window_index_ = (window_index_ + 1) % kWindowSize;
+  if (window_fill_ < kWindowSize) window_fill_++;
+
+  consecutive_good_frames_ = missed ? 0 : consecutive_good_frames_ + 1;
+}
+
+void
+FrameStats::EndFrame()
+{
+  if (predicted_display_period_ <= 0) return;
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      Clock::now() - frame_begin_);
+  float usage = (float)elapsed.count() / (float)predicted_display_period_;
+  float headroom = std::clamp(1.f - usage, 0.f, 1.f);
+
+  if (window_fill_ <= 1) {
+    headroom_ = headroom;
+  } else {
+    headroom_ += (headroom - headroom_) * kHeadroomSmoothing;
+  }
+}
+
+void
+FrameStats::Reset()
+{
+  missed_window_.fill(false);
+  window_index_ = 0;
+  window_fill_ = 0;
+  missed_frames_ = 0;
+  consecutive_good_frames_ = 0;
+  headroom_ = 0.f;
+  predicted_display_time_ = 0;
+}
+
+}  // namespace zen::mirror
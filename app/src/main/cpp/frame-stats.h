@@ -0,0 +1,103 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Collects per-frame timing to detect missed frames and to measure how much
+ * of the display period is left unused by the render loop.
+ */
+class FrameStats {
+ public:
+  DISABLE_MOVE_AND_COPY(FrameStats);
+  FrameStats() = default;
+  ~FrameStats() = default;
+
+  /* Call right after xrWaitFrame returns */
+  void BeginFrame(const XrFrameState &frame_state);
+
+  /* Call right after xrEndFrame returns */
+  void EndFrame();
+
+  /**
+   * Forget the collected history. Used when the frame pacing changes, e.g.
+   * the display refresh rate is switched by the runtime.
+   */
+  void Reset();
+
+  /* The number of missed frames in the last kWindowSize frames */
+  inline uint32_t missed_frames();
+
+  /* The number of frames in a row that did not miss the display period */
+  inline uint64_t consecutive_good_frames();
+
+  /* Averaged fraction of the display period unused by the render loop [0, 1] */
+  inline float headroom();
+
+  /* Whether enough frames have been collected since the last reset */
+  inline bool is_settled();
+
+  inline XrTime predicted_display_time();
+  inline XrDuration predicted_display_period();
+
+  static constexpr uint32_t kWindowSize = 90;
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // A frame is regarded as missed when the predicted display time advances
+  // more than this many display periods.
+  static constexpr float kMissedFrameThreshold = 1.5f;
+  // Smoothing factor of the exponential moving average of the headroom
+  static constexpr float kHeadroomSmoothing = 0.05f;
+
+  std::array<bool, kWindowSize> missed_window_{};
+  uint32_t window_index_{0};
+  uint32_t window_fill_{0};
+  uint32_t missed_frames_{0};
+  uint64_t consecutive_good_frames_{0};
+  float headroom_{0.f};
+
+  XrTime predicted_display_time_{0};
+  XrDuration predicted_display_period_{0};
+  Clock::time_point frame_begin_;
+};
+
+inline uint32_t
+FrameStats::missed_frames()
+{
+  return missed_frames_;
+}
+
+inline uint64_t
+FrameStats::consecutive_good_frames()
+{
+  return consecutive_good_frames_;
+}
+
+inline float
+FrameStats::headroom()
+{
+  return headroom_;
+}
+
+inline bool
+FrameStats::is_settled()
+{
+  return window_fill_ == kWindowSize;
+}
+
+inline XrTime
+FrameStats::predicted_display_time()
+{
+  return predicted_display_time_;
+}
+
+inline XrDuration
+FrameStats::predicted_display_period()
+{
+  return predicted_display_period_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,150 @@
+#include "pch.h"
+
+#include "frustum-culler.h"
+#include "logger.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+void
+FrustumCuller::SetBounds(uint64_t id, const Aabb &bounds)
+{
+  auto [it, inserted] = indices_.try_emplace(id, ids_.size());
+  if (inserted) {
+    ids_.push_back(id);
+    mins_.push_back(bounds.min);
+    maxs_.push_back(bounds.max);
+  } else {
+    mins_[it->second] = bounds.min;
+    maxs_[it->second] = bounds.max;
+  }
+}
+
+void
+FrustumCuller::Remove(uint64_t id)
+{
+  auto it = indices_.find(id);
+  if (it == indices_.end()) return;
+
+  // Move the last object into the hole to keep the arrays dense
+  size_t index = it->second;
+  size_t last = ids_.size() - 1;
+  if (index != last) {
+    ids_[index] = ids_[last];
+    mins_[index] = mins_[last];
+    maxs_[index] = maxs_[last];
+    indices_[ids_[index]] = index;
+  }
+  ids_.pop_back();
+  mins_.pop_back();
+  maxs_.pop_back();
+  indices_.erase(it);
+}
+
+void
+FrustumCuller::Cull(const std::vector<XrView> &views)
+{
+  visible_.clear();
+  if (ids_.empty()) return;
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  BuildPlanes(views);
+
+  for (size_t i = 0; i < ids_.size(); i++) {
+    bool is_visible = true;
+    for (const auto &plane : planes_) {
+      // The corner of the box farthest along the plane normal
+      glm::vec3 corner(plane.normal.x >= 0 ? maxs_[i].x : mins_[i].x,
+          plane.normal.y >= 0 ? maxs_[i].y : mins_[i].y,
+          plane.normal.z >= 0 ? maxs_[i].z : mins_[i].z);
+      if (glm::dot(plane.normal, corner) + plane.distance < 0) {
+        is_visible = false;
+        break;
+      }
+    }
+    if (is_visible) visible_.push_back(ids_[i]);
+  }
+
+  submitted_count_ += visible_.size();
+  culled_count_ += ids_.size() - visible_.size();
+
+  cull_time_ += std::chrono::steady_clock::now() - begin;
+  if (++frames_ % kStatsPeriodFrames == 0) LogStats();
+}
+
+void
+FrustumCuller::BuildPlanes(const std::vector<XrView> &views)
+{
+  constexpr size_t kPlaneCount = (size_t)Side::kCount;
+
+  auto &view_planes = view_planes_;
+  auto &view_corners = view_corners_;
+  view_planes.resize(views.size());
+  view_corners.resize(views.size());
+
+  for (size_t v = 0; v < views.size(); v++) {
+    const XrFovf &fov = views[v].fov;
+    const float tan_left = tanf(fov.angleLeft);
+    const float tan_right = tanf(fov.angleRight);
+    const float tan_down = tanf(fov.angleDown);
+    const float tan_up = tanf(fov.angleUp);
+
+    // In the view space, looking down -Z
+    std::array<Plane, kPlaneCount> planes;
+    planes[(int)Side::kLeft] = {glm::vec3(1, 0, tan_left), 0};
+    planes[(int)Side::kRight] = {glm::vec3(-1, 0, -tan_right), 0};
+    planes[(int)Side::kBottom] = {glm::vec3(0, 1, tan_down), 0};
+    planes[(int)Side::kTop] = {glm::vec3(0, -1, -tan_up), 0};
+    planes[(int)Side::kFar] = {glm::vec3(0, 0, 1), far_};
+
+    const glm::vec3 eye = Math::ToGlm(views[v].pose.position);
+    const glm::quat orientation = Math::ToGlm(views[v].pose.orientation);
+
+    for (size_t p = 0; p < kPlaneCount; p++) {
+      glm::vec3 normal = orientation * glm::normalize(planes[p].normal);
+      view_planes[v][p].normal = normal;
+      view_planes[v][p].distance = planes[p].distance - glm::dot(normal, eye);
+    }
+
+    view_corners[v] = {
+        eye,
+        eye + orientation * glm::vec3(tan_left, tan_down, -1) * far_,
+        eye + orientation * glm::vec3(tan_left, tan_up, -1) * far_,
+        eye + orientation * glm::vec3(tan_right, tan_down, -1) * far_,
+        eye + orientation * glm::vec3(tan_right, tan_up, -1) * far_,
+    };
+  }
+
+  // For each side, take the plane of the view that needs the least push
+  // outward to enclose the frusta of all the views. With parallel views of
+  // the same fov the outermost plane already encloses the others.
+  for (size_t p = 0; p < kPlaneCount; p++) {
+    float best_push = std::numeric_limits<float>::max();
+    for (size_t candidate = 0; candidate < views.size(); candidate++) {
+      const Plane &plane = view_planes[candidate][p];
+      float push = 0;
+      for (const auto &corners : view_corners) {
+        for (const auto &corner : corners) {
+          push = std::max(
+              push, -(glm::dot(plane.normal, corner) + plane.distance));
+        }
+      }
+      if (push < best_push) {
+        best_push = push;
+        planes_[p] = Plane{plane.normal, plane.distance + push};
+      }
+    }
+  }
+}
+
+void
+FrustumCuller::LogStats()
+{
+  LOG_DEBUG("Frustum culling: %.1f us/frame, %.1f submitted and %.1f culled "
+            "objects/frame",
+      (float)cull_time_.count() / 1000 / frames_,
+      (float)submitted_count_ / frames_, (float)culled_count_ / frames_);
+}
+
+}  // namespace zen::mirror
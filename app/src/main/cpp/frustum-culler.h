@@ -0,0 +1,96 @@
+#pragma once
+
+#include "bvh.h"
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Culls the bounds of the remote render objects against a single frustum
+ * enclosing all the views, so each object is tested once per frame.
+ *
+ * The visible set only narrows what the LOD selector looks at; zen-remote
+ * 0.1.2 draws every object of its scene and cannot skip the culled ones.
+ *
+ * Bounds are kept in flat arrays and culled linearly, which stays cache
+ * friendly when most of the objects are off screen.
+ */
+class FrustumCuller {
+ public:
+  DISABLE_MOVE_AND_COPY(FrustumCuller);
+  /* `far` is the far plane of the projection of the views */
+  FrustumCuller(float far) : far_(far) {}
+  ~FrustumCuller() = default;
+
+  /* Add an object or move an existing one */
+  void SetBounds(uint64_t id, const Aabb &bounds);
+
+  void Remove(uint64_t id);
+
+  /* Rebuild the visible set for the located views; cheap while empty */
+  void Cull(const std::vector<XrView> &views);
+
+  /* Ids of the objects passing the last Cull, in no particular order */
+  inline const std::vector<uint64_t> &visible() const;
+
+  /* Totals over all the Cull calls */
+  inline uint64_t submitted_count() const;
+  inline uint64_t culled_count() const;
+
+ private:
+  struct Plane {
+    glm::vec3 normal;  // pointing inside
+    float distance;    // dot(normal, p) + distance >= 0 inside
+  };
+
+  enum class Side { kLeft = 0, kRight, kBottom, kTop, kFar, kCount };
+
+  // Write out the cost per frame every this many frames
+  static constexpr uint64_t kStatsPeriodFrames = 1000;
+
+  /* Build the planes of a frustum enclosing all the views */
+  void BuildPlanes(const std::vector<XrView> &views);
+
+  void LogStats();
+
+  const float far_;
+  std::array<Plane, (size_t)Side::kCount> planes_;
+
+  // Scratch buffers of BuildPlanes reused every frame; eye and far corners
+  std::vector<std::array<Plane, (size_t)Side::kCount>> view_planes_;
+  std::vector<std::array<glm::vec3, 5>> view_corners_;
+
+  // The following vectors are of the same size, and items at the same index
+  // correspond to each other.
+  std::vector<uint64_t> ids_;
+  std::vector<glm::vec3> mins_;
+  std::vector<glm::vec3> maxs_;
+
+  std::unordered_map<uint64_t, size_t> indices_;
+  std::vector<uint64_t> visible_;
+
+  uint64_t frames_{0};
+  uint64_t submitted_count_{0};
+  uint64_t culled_count_{0};
+  std::chrono::nanoseconds cull_time_{0};
+};
+
+inline const std::vector<uint64_t> &
+FrustumCuller::visible() const
+{
+  return visible_;
+}
+
+inline uint64_t
+FrustumCuller::submitted_count() const
+{
+  return submitted_count_;
+}
+
+inline uint64_t
+FrustumCuller::culled_count() const
+{
+  return culled_count_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,151 @@
+#include "pch.h"
+
+#include "gl-upload-thread.h"
+#include "logger.h"
+
+namespace zen::mirror {
+
+GlUploadThread::~GlUploadThread()
+{
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_stopping_ = true;
+    }
+    condition_.notify_one();
+    thread_.join();
+  }
+
+  for (auto &pending : pending_) glDeleteSync(pending.fence);
+
+  if (surface_ != EGL_NO_SURFACE) eglDestroySurface(egl_->display(), surface_);
+  if (context_ != EGL_NO_CONTEXT) eglDestroyContext(egl_->display(), context_);
+}
+
+bool
+GlUploadThread::Init()
+{
+  if (!egl_->CreateSharedContext(&context_, &surface_)) return false;
+
+  thread_ = std::thread(&GlUploadThread::Run, this);
+
+  // Uploads enqueued to a thread without a context would never complete
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this] { return is_current_.has_value(); });
+  if (*is_current_) return true;
+
+  lock.unlock();
+  thread_.join();
+
+  return false;
+}
+
+void
+GlUploadThread::Enqueue(Upload upload)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(upload));
+  }
+  condition_.notify_one();
+}
+
+void
+GlUploadThread::Run()
+{
+  const bool is_current =
+      eglMakeCurrent(egl_->display(), surface_, surface_, context_) ==
+      EGL_TRUE;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  is_current_ = is_current;
+  condition_.notify_all();
+
+  if (!is_current) {
+    LOG_ERROR("Failed to make the upload context current: 0x%x",
+        eglGetError());
+    return;
+  }
+
+  while (true) {
+    condition_.wait(lock, [this] { return is_stopping_ || !queue_.empty(); });
+    if (is_stopping_) break;
+
+    Upload upload = std::move(queue_.front());
+    queue_.pop_front();
+
+    lock.unlock();
+
+    const auto begin = std::chrono::steady_clock::now();
+    upload.upload();
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();  // so the fence signals without another thread flushing it
+    const auto upload_time = std::chrono::steady_clock::now() - begin;
+
+    lock.lock();
+
+    upload_time_ += upload_time;
+    pending_.push_back(Pending{fence, std::move(upload.on_ready), upload.size});
+  }
+
+  lock.unlock();
+
+  eglMakeCurrent(
+      egl_->display(), EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+size_t
+GlUploadThread::Poll()
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  std::vector<Pending> ready;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!pending_.empty()) {
+      GLenum result = glClientWaitSync(pending_.front().fence, 0, 0);
+      if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+        break;
+      }
+      ready.push_back(std::move(pending_.front()));
+      pending_.pop_front();
+    }
+  }
+
+  for (auto &pending : ready) {
+    glDeleteSync(pending.fence);
+    if (pending.on_ready) pending.on_ready();
+    ready_bytes_ += pending.size;
+  }
+
+  const auto poll_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - begin);
+  max_poll_time_ = std::max(max_poll_time_, poll_time);
+
+  const uint64_t previous_uploads = ready_uploads_;
+  ready_uploads_ += ready.size();
+  if (ready_uploads_ / kStatsPeriodUploads !=
+      previous_uploads / kStatsPeriodUploads) {
+    LogStats();
+  }
+
+  return ready.size();
+}
+
+void
+GlUploadThread::LogStats()
+{
+  std::chrono::nanoseconds upload_time;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    upload_time = upload_time_;
+  }
+
+  LOG_DEBUG("GL uploads: %" PRIu64 " uploads, %.1f KiB/upload, %.2f ms/upload "
+            "off the render thread, %.3f ms max poll on the render thread",
+      ready_uploads_, (float)ready_bytes_ / ready_uploads_ / 1024,
+      (float)upload_time.count() / ready_uploads_ / 1000000,
+      (float)max_poll_time_.count() / 1000000);
+}
+
+}  // namespace zen::mirror
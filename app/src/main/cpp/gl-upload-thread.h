@@ -0,0 +1,84 @@
+#pragma once
+
+#include "common.h"
+#include "egl-instance.h"
+
+namespace zen::mirror {
+
+/**
+ * Uploads GPU resources on a dedicated thread with a GL context shared with
+ * the render thread, so large uploads do not stall frames.
+ *
+ * Each upload is fenced after it is issued. The render thread calls Poll
+ * before rendering to take over the uploads the GPU has finished; only then
+ * is it safe to use the uploaded objects for drawing.
+ *
+ * The program binary cache links the programs of the kShaderSources frames
+ * of the bulk channel here.
+ */
+class GlUploadThread {
+ public:
+  struct Upload {
+    /* Called on the upload thread with the shared context current */
+    std::function<void()> upload;
+
+    /* Called on the render thread by Poll once the upload has completed */
+    std::function<void()> on_ready;
+
+    size_t size;  // bytes, for the stats
+  };
+
+  DISABLE_MOVE_AND_COPY(GlUploadThread);
+  GlUploadThread(EglInstance *egl) : egl_(egl) {}
+  ~GlUploadThread();
+
+  /**
+   * Create the shared context and start the thread
+   * @returns false if the context could not be made current on the thread
+   */
+  bool Init();
+
+  /* Thread safe */
+  void Enqueue(Upload upload);
+
+  /**
+   * Call on the render thread. Uploads become ready in the order they were
+   * enqueued.
+   * @returns the number of uploads that became ready
+   */
+  size_t Poll();
+
+ private:
+  struct Pending {
+    GLsync fence;
+    std::function<void()> on_ready;
+    size_t size;
+  };
+
+  // Write out the stats every this many uploads
+  static constexpr uint64_t kStatsPeriodUploads = 100;
+
+  void Run();
+
+  void LogStats();
+
+  EglInstance *egl_;
+  EGLContext context_{EGL_NO_CONTEXT};
+  EGLSurface surface_{EGL_NO_SURFACE};
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<Upload> queue_;        // guarded by mutex_
+  std::deque<Pending> pending_;     // guarded by mutex_
+  bool is_stopping_{false};         // guarded by mutex_
+  std::optional<bool> is_current_;  // set once Run starts; by mutex_
+  std::chrono::nanoseconds upload_time_{0};  // guarded by mutex_
+
+  // Only touched on the render thread
+  uint64_t ready_uploads_{0};
+  uint64_t ready_bytes_{0};
+  std::chrono::nanoseconds max_poll_time_{0};
+};
+
+}  // namespace zen::mirror
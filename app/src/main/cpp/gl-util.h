@@ -0,0 +1,21 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/* Call with a GL context current */
+inline bool
+IsGlExtensionSupported(const char *name)
+{
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; i++) {
+    auto extension =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension != nullptr && strcmp(extension, name) == 0) return true;
+  }
+  return false;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,112 @@
+#include "pch.h"
+
+#include "gpu-memory-budget.h"
+#include "logger.h"
+
+namespace zen::mirror {
+
+GpuMemoryBudget::Handle
+GpuMemoryBudget::Track(GpuMemoryCategory category, uint64_t size,
+    std::function<void()> evict)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  Handle handle = next_handle_++;
+  allocations_.push_back(
+      Allocation{handle, category, size, std::move(evict), frame_});
+  handles_[handle] = std::prev(allocations_.end());
+  total_ += size;
+  categories_[(int)category] += size;
+
+  return handle;
+}
+
+void
+GpuMemoryBudget::Release(Handle handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = handles_.find(handle);
+  if (it == handles_.end()) return;
+
+  total_ -= it->second->size;
+  categories_[(int)it->second->category] -= it->second->size;
+  allocations_.erase(it->second);
+  handles_.erase(it);
+}
+
+void
+GpuMemoryBudget::Touch(Handle handle)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto it = handles_.find(handle);
+  if (it == handles_.end()) return;
+
+  it->second->last_frame = frame_;
+  allocations_.splice(allocations_.end(), allocations_, it->second);
+}
+
+void
+GpuMemoryBudget::EndFrame()
+{
+  std::vector<std::function<void()>> evictions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Resources rendered in this frame are at the end and are never evicted
+    for (auto it = allocations_.begin();
+         total_ > budget_ && it != allocations_.end() &&
+         it->last_frame != frame_;) {
+      if (!it->evict) {
+        it++;
+        continue;
+      }
+
+      total_ -= it->size;
+      categories_[(int)it->category] -= it->size;
+      evictions.push_back(std::move(it->evict));
+      handles_.erase(it->handle);
+      it = allocations_.erase(it);
+    }
+
+    evictions_ += evictions.size();
+
+    if (total_ > budget_ && !is_over_budget_logged_) {
+      LOG_WARN("Tracked GPU memory stays over the budget (%" PRIu64
+               " MiB > %" PRIu64 " MiB) without anything left to evict",
+          total_ / 1024 / 1024, budget_ / 1024 / 1024);
+    }
+    is_over_budget_logged_ = total_ > budget_;
+
+    frame_++;
+  }
+
+  for (auto &evict : evictions) evict();
+
+  if (frame_ % kReportPeriodFrames != 0) return;
+
+  GpuMemoryUsage current_usage = usage();
+  LOG_DEBUG("Tracked GPU memory: %.1f / %.1f MiB (swapchain %.1f, depth %.1f, "
+            "remote texture %.1f, remote buffer %.1f, mirror %.1f), %" PRIu64
+            " evictions",
+      (float)current_usage.total / 1024 / 1024,
+      (float)current_usage.budget / 1024 / 1024,
+      (float)current_usage.categories[0] / 1024 / 1024,
+      (float)current_usage.categories[1] / 1024 / 1024,
+      (float)current_usage.categories[2] / 1024 / 1024,
+      (float)current_usage.categories[3] / 1024 / 1024,
+      (float)current_usage.categories[4] / 1024 / 1024,
+      current_usage.evictions);
+
+  if (auto sink = sink_.lock()) sink->SendGpuMemoryUsage(current_usage);
+}
+
+GpuMemoryUsage
+GpuMemoryBudget::usage()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return GpuMemoryUsage{budget_, total_, categories_, evictions_};
+}
+
+}  // namespace zen::mirror
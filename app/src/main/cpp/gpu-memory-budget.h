@@ -0,0 +1,108 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+enum class GpuMemoryCategory {
+  kSwapchain = 0,
+  kDepth,
+  kRemoteTexture,
+  kRemoteBuffer,
+  kMirror,  // buffers the mirror uses for itself
+  kCount,
+};
+
+struct GpuMemoryUsage {
+  uint64_t budget;
+  uint64_t total;
+  std::array<uint64_t, (size_t)GpuMemoryCategory::kCount> categories;
+  uint64_t evictions;
+};
+
+/**
+ * Accounts for the GPU memory of the mirror by category and reports it
+ * against a budget, evicting the least recently rendered evictable resources
+ * when over it.
+ *
+ * Only the mirror's own allocations are tracked: the swapchains, their depth
+ * and the buffers of the mirror. zen-remote 0.1.2 allocates the remote
+ * textures and buffers on its own, so nothing evictable is tracked yet and
+ * the budget does not limit the memory the scene uses.
+ *
+ * Allocations are tracked with an estimate of their size. An allocation
+ * tracked with an eviction callback may be evicted at the end of a frame in
+ * which it was not rendered; the owner frees the GPU object in the callback
+ * and keeps what it needs to fetch and upload it again, tracking it anew.
+ *
+ * Thread safe, except that eviction callbacks run on the thread of EndFrame.
+ */
+class GpuMemoryBudget {
+ public:
+  struct ISink;
+
+  using Handle = uint64_t;
+
+  DISABLE_MOVE_AND_COPY(GpuMemoryBudget);
+  GpuMemoryBudget(uint64_t budget) : budget_(budget) {}
+  ~GpuMemoryBudget() = default;
+
+  Handle Track(GpuMemoryCategory category, uint64_t size,
+      std::function<void()> evict = nullptr);
+
+  /* Call when the owner frees the allocation; evicted ones are released */
+  void Release(Handle handle);
+
+  /* Mark the allocation as rendered in the current frame */
+  void Touch(Handle handle);
+
+  /* Evict down to the budget and report the usage periodically */
+  void EndFrame();
+
+  GpuMemoryUsage usage();
+
+  inline void set_sink(std::weak_ptr<ISink> sink);
+
+ private:
+  struct Allocation {
+    Handle handle;
+    GpuMemoryCategory category;
+    uint64_t size;
+    std::function<void()> evict;  // nullptr if not evictable
+    uint64_t last_frame;          // the last frame in which it was rendered
+  };
+
+  // Report the usage every this many frames
+  static constexpr uint64_t kReportPeriodFrames = 500;
+
+  const uint64_t budget_;
+
+  std::mutex mutex_;
+  // Least recently rendered first; the following are guarded by mutex_
+  std::list<Allocation> allocations_;
+  std::unordered_map<Handle, std::list<Allocation>::iterator> handles_;
+  Handle next_handle_{1};
+  uint64_t frame_{0};
+  uint64_t total_{0};
+  std::array<uint64_t, (size_t)GpuMemoryCategory::kCount> categories_{};
+  uint64_t evictions_{0};
+  bool is_over_budget_logged_{false};
+
+  std::weak_ptr<ISink> sink_;
+};
+
+struct GpuMemoryBudget::ISink {
+  DISABLE_MOVE_AND_COPY(ISink);
+  ISink() = default;
+  virtual ~ISink() = default;
+
+  virtual void SendGpuMemoryUsage(const GpuMemoryUsage &usage) = 0;
+};
+
+inline void
+GpuMemoryBudget::set_sink(std::weak_ptr<ISink> sink)
+{
+  sink_ = std::move(sink);
+}
+
+}  // namespace zen::mirror
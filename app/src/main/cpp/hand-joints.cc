@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#include "hand-joints.h"
+
+namespace zen::mirror {
+
+void
+ScatterHandJointLocations(
+    const XrHandJointLocationEXT *locations, XrTime time, HandJoints *joints)
+{
+  joints->time = time;
+  joints->position_valid_bits = 0;
+  joints->orientation_valid_bits = 0;
+  for (size_t i = 0; i < kHandJointCount; i++) {
+    const auto &location = locations[i];
+    joints->positions[i] = location.pose.position;
+    joints->orientations[i] = location.pose.orientation;
+    joints->radii[i] = location.radius;
+
+    if (location.locationFlags & XR_SPACE_LOCATION_POSITION_VALID_BIT) {
+      joints->position_valid_bits |= 1u << i;
+    }
+    if (location.locationFlags & XR_SPACE_LOCATION_ORIENTATION_VALID_BIT) {
+      joints->orientation_valid_bits |= 1u << i;
+    }
+  }
+}
+
+namespace hand_joints_codec {
+
+namespace {
+
+template <typename T>
+inline void
+Write(uint8_t **cursor, T value)
+{
+  memcpy(*cursor, &value, sizeof(T));
+  *cursor += sizeof(T);
+}
+
+template <typename T>
+inline T
+Read(const uint8_t **cursor)
+{
+  T value;
+  memcpy(&value, *cursor, sizeof(T));
+  *cursor += sizeof(T);
+  return value;
+}
+
+inline int16_t
+Quantize(float value, float unit)
+{
+  float quantized = std::round(value / unit);
+  return (int16_t)std::clamp(quantized, -32767.f, 32767.f);
+}
+
+}  // namespace
+
+void
+Encode(uint8_t hand, const HandJoints &joints, std::vector<uint8_t> *out)
+{
+  const size_t offset = out->size();
+  out->resize(offset + kEncodedSize);
+  uint8_t *cursor = out->data() + offset;
+
+  const XrVector3f wrist = joints.positions[XR_HAND_JOINT_WRIST_EXT];
+
+  Write<int64_t>(&cursor, joints.time);
+  Write<uint32_t>(&cursor, joints.position_valid_bits);
+  Write<uint32_t>(&cursor, joints.orientation_valid_bits);
+  Write<uint8_t>(&cursor, hand);
+  Write<uint8_t>(&cursor, kHandJointCount);
+  Write<float>(&cursor, wrist.x);
+  Write<float>(&cursor, wrist.y);
+  Write<float>(&cursor, wrist.z);
+
+  for (size_t i = 0; i < kHandJointCount; i++) {
+    const XrVector3f &position = joints.positions[i];
+    Write<int16_t>(&cursor, Quantize(position.x - wrist.x, kPositionUnit));
+    Write<int16_t>(&cursor, Quantize(position.y - wrist.y, kPositionUnit));
+    Write<int16_t>(&cursor, Quantize(position.z - wrist.z, kPositionUnit));
+
+    // Smallest three: drop the largest component, which can be recovered
+    // from the unit length, and flip the sign to keep it positive.
+    const XrQuaternionf &orientation = joints.orientations[i];
+    const float components[4] = {
+        orientation.x, orientation.y, orientation.z, orientation.w};
+    uint8_t largest = 0;
+    for (uint8_t c = 1; c < 4; c++) {
+      if (std::abs(components[c]) > std::abs(components[largest])) largest = c;
+    }
+    const float sign = components[largest] < 0.f ? -1.f : 1.f;
+
+    Write<uint8_t>(&cursor, largest);
+    for (uint8_t c = 0; c < 4; c++) {
+      if (c == largest) continue;
+      Write<int16_t>(&cursor, Quantize(components[c] * sign, kOrientationUnit));
+    }
+
+    float radius = std::round(joints.radii[i] / kRadiusUnit);
+    Write<uint8_t>(&cursor, (uint8_t)std::clamp(radius, 0.f, 255.f));
+  }
+}
+
+size_t
+Decode(const uint8_t *data, size_t size, uint8_t *hand, HandJoints *joints)
+{
+  if (size < kHeaderSize) return 0;
+
+  const uint8_t *cursor = data;
+
+  joints->time = Read<int64_t>(&cursor);
+  joints->position_valid_bits = Read<uint32_t>(&cursor);
+  joints->orientation_valid_bits = Read<uint32_t>(&cursor);
+  *hand = Read<uint8_t>(&cursor);
+  const uint8_t joint_count = Read<uint8_t>(&cursor);
+  XrVector3f wrist;
+  wrist.x = Read<float>(&cursor);
+  wrist.y = Read<float>(&cursor);
+  wrist.z = Read<float>(&cursor);
+
+  if (joint_count != kHandJointCount) return 0;
+  if (size < kEncodedSize) return 0;
+
+  for (size_t i = 0; i < kHandJointCount; i++) {
+    XrVector3f &position = joints->positions[i];
+    position.x = wrist.x + Read<int16_t>(&cursor) * kPositionUnit;
+    position.y = wrist.y + Read<int16_t>(&cursor) * kPositionUnit;
+    position.z = wrist.z + Read<int16_t>(&cursor) * kPositionUnit;
+
+    const uint8_t largest = Read<uint8_t>(&cursor);
+    if (largest >= 4) return 0;
+
+    float components[4];
+    float square_sum = 0.f;
+    for (uint8_t c = 0; c < 4; c++) {
+      if (c == largest) continue;
+      components[c] = Read<int16_t>(&cursor) * kOrientationUnit;
+      square_sum += components[c] * components[c];
+    }
+    components[largest] = std::sqrt(std::max(0.f, 1.f - square_sum));
+
+    joints->orientations[i] = {
+        components[0], components[1], components[2], components[3]};
+
+    joints->radii[i] = Read<uint8_t>(&cursor) * kRadiusUnit;
+  }
+
+  return kEncodedSize;
+}
+
+}  // namespace hand_joints_codec
+
+}  // namespace zen::mirror
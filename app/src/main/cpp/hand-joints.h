@@ -0,0 +1,75 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+constexpr size_t kHandJointCount = XR_HAND_JOINT_COUNT_EXT;
+
+/* Joints of a hand in structure-of-arrays layout, indexed by XrHandJointEXT */
+struct HandJoints {
+  XrTime time{0};
+  uint32_t position_valid_bits{0};     // bit i for joint i
+  uint32_t orientation_valid_bits{0};  // bit i for joint i
+  std::array<XrVector3f, kHandJointCount> positions;
+  std::array<XrQuaternionf, kHandJointCount> orientations;
+  std::array<float, kHandJointCount> radii;
+};
+
+static_assert(kHandJointCount <= 32, "valid bits must fit in uint32_t");
+
+/* Scatter kHandJointCount locations from the runtime into `joints` */
+void ScatterHandJointLocations(const XrHandJointLocationEXT *locations,
+    XrTime time, HandJoints *joints);
+
+/* Takes the tracked hands of each frame to the server */
+struct IHandJointsSink {
+  DISABLE_MOVE_AND_COPY(IHandJointsSink);
+  IHandJointsSink() = default;
+  virtual ~IHandJointsSink() = default;
+
+  /**
+   * Called once per frame with the tracked hands encoded one after another in
+   * the hand_joints_codec format. The data is valid only during the call.
+   */
+  virtual void SendHandJoints(const uint8_t *data, size_t size) = 0;
+};
+
+/**
+ * Quantized wire format of HandJoints, in host byte order.
+ *
+ * Header:
+ *   int64  time
+ *   uint32 position_valid_bits
+ *   uint32 orientation_valid_bits
+ *   uint8  hand (0: left, 1: right)
+ *   uint8  joint count
+ *   float  wrist position x, y, z
+ * Each joint:
+ *   int16  position relative to the wrist x, y, z in kPositionUnit
+ *   uint8  index of the dropped largest quaternion component
+ *   int16  the other three quaternion components in kOrientationUnit
+ *   uint8  radius in kRadiusUnit
+ */
+namespace hand_joints_codec {
+
+constexpr float kPositionUnit = 0.00005f;  // 0.05 mm, covers +-1.6 m
+constexpr float kOrientationUnit = 1.f / 32767.f / 1.41421356f;
+constexpr float kRadiusUnit = 0.0001f;  // 0.1 mm, covers 25.5 mm
+
+constexpr size_t kHeaderSize = 8 + 4 + 4 + 1 + 1 + 4 * 3;
+constexpr size_t kJointSize = 2 * 3 + 1 + 2 * 3 + 1;
+constexpr size_t kEncodedSize = kHeaderSize + kJointSize * kHandJointCount;
+
+/* Append the encoded joints to `out` */
+void Encode(uint8_t hand, const HandJoints &joints, std::vector<uint8_t> *out);
+
+/**
+ * @returns the number of bytes consumed, or 0 if the data is malformed.
+ */
+size_t Decode(
+    const uint8_t *data, size_t size, uint8_t *hand, HandJoints *joints);
+
+}  // namespace hand_joints_codec
+
+}  // namespace zen::mirror
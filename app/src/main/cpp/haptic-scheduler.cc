@@ -0,0 +1,128 @@
+#include "pch.h"
+
+#include "haptic-scheduler.h"
+#include "logger.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+void
+HapticScheduler::Play(Hand hand, const HapticPattern &pattern)
+{
+  if (pattern.empty()) {
+    Stop(hand);
+    return;
+  }
+
+  auto &channel = channels_[(int)hand];
+  channel.pulses.assign(pattern.begin(), pattern.end());
+  channel.pulse_end = Clock::now();
+}
+
+void
+HapticScheduler::Enqueue(Hand hand, const HapticPattern &pattern)
+{
+  auto &channel = channels_[(int)hand];
+  channel.pulses.insert(channel.pulses.end(), pattern.begin(), pattern.end());
+}
+
+void
+HapticScheduler::Stop(Hand hand)
+{
+  auto &channel = channels_[(int)hand];
+  const auto now = Clock::now();
+
+  channel.pulses.clear();
+  channel.pulse_end = now;
+
+  if (now < channel.vibration_end) {
+    StopOutput(hand);
+    channel.vibration_end = now;
+  }
+}
+
+void
+HapticScheduler::Update()
+{
+  const auto now = Clock::now();
+  bool is_any_vibrating = false;
+
+  for (auto hand : {Hand::kLeft, Hand::kRight}) {
+    auto &channel = channels_[(int)hand];
+
+    if (now >= channel.pulse_end && !channel.pulses.empty()) {
+      const HapticPulse pulse = channel.pulses.front();
+      channel.pulses.pop_front();
+      channel.pulse_end = now + std::chrono::nanoseconds(pulse.duration);
+
+      if (pulse.amplitude > 0.f) {
+        if (ApplyOutput(hand, pulse)) channel.vibration_end = channel.pulse_end;
+      } else if (now < channel.vibration_end) {
+        StopOutput(hand);
+        channel.vibration_end = now;
+      }
+    }
+
+    if (now < channel.vibration_end) is_any_vibrating = true;
+  }
+
+  if (is_any_vibrating) active_updates_++;
+}
+
+bool
+HapticScheduler::ApplyOutput(Hand hand, const HapticPulse &pulse)
+{
+  XrHapticVibration vibration{XR_TYPE_HAPTIC_VIBRATION};
+  vibration.amplitude = pulse.amplitude;
+  vibration.duration = pulse.duration;
+  vibration.frequency = pulse.frequency;
+
+  XrHapticActionInfo haptic_action_info{XR_TYPE_HAPTIC_ACTION_INFO};
+  haptic_action_info.action = vibrate_action_;
+  haptic_action_info.subactionPath = hand_subaction_path_[(int)hand];
+
+  runtime_calls_++;
+  IF_XR_FAILED (err, xrApplyHapticFeedback(session_, &haptic_action_info,
+                         (XrHapticBaseHeader *)&vibration)) {
+    LOG_WARN("%s", err.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+void
+HapticScheduler::StopOutput(Hand hand)
+{
+  XrHapticActionInfo haptic_action_info{XR_TYPE_HAPTIC_ACTION_INFO};
+  haptic_action_info.action = vibrate_action_;
+  haptic_action_info.subactionPath = hand_subaction_path_[(int)hand];
+
+  runtime_calls_++;
+  IF_XR_FAILED (err, xrStopHapticFeedback(session_, &haptic_action_info)) {
+    LOG_WARN("%s", err.c_str());
+  }
+}
+
+GrabEdges::Edge
+GrabEdges::Update(bool is_active, float value)
+{
+  if (!is_active) {
+    is_grabbing_ = false;
+    return Edge::kNone;
+  }
+
+  if (!is_grabbing_ && value > kPressThreshold) {
+    is_grabbing_ = true;
+    return Edge::kPress;
+  }
+
+  if (is_grabbing_ && value < kReleaseThreshold) {
+    is_grabbing_ = false;
+    return Edge::kRelease;
+  }
+
+  return Edge::kNone;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+struct HapticPulse {
+  XrDuration duration;  // nanoseconds
+  float amplitude;      // [0, 1], 0 for a pause
+  float frequency;      // Hz, or XR_FREQUENCY_UNSPECIFIED
+};
+
+using HapticPattern = std::vector<HapticPulse>;
+
+/**
+ * Plays haptic patterns on the controllers.
+ *
+ * Each pulse is handed to the runtime once with its duration, and the runtime
+ * stops it on its own. So the runtime is called only when the output changes
+ * instead of every frame.
+ */
+class HapticScheduler {
+ public:
+  enum class Hand { kLeft = 0, kRight = 1, kCount = 2 };
+
+  DISABLE_MOVE_AND_COPY(HapticScheduler);
+  HapticScheduler(XrSession session, XrAction vibrate_action,
+      std::array<XrPath, (size_t)Hand::kCount> hand_subaction_path)
+      : session_(session),
+        vibrate_action_(vibrate_action),
+        hand_subaction_path_(hand_subaction_path)
+  {
+  }
+  ~HapticScheduler() = default;
+
+  /* Replace whatever is playing on the hand with the pattern */
+  void Play(Hand hand, const HapticPattern &pattern);
+
+  /* Play the pattern after the ones already queued on the hand */
+  void Enqueue(Hand hand, const HapticPattern &pattern);
+
+  void Stop(Hand hand);
+
+  /* Advance the patterns; call every loop iteration */
+  void Update();
+
+  /* The number of xrApplyHapticFeedback and xrStopHapticFeedback calls */
+  inline uint64_t runtime_calls();
+
+  /* The number of updates during which any hand was vibrating */
+  inline uint64_t active_updates();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Channel {
+    std::deque<HapticPulse> pulses;
+    Clock::time_point pulse_end;      // when to move on to the next pulse
+    Clock::time_point vibration_end;  // when the runtime stops vibrating
+  };
+
+  bool ApplyOutput(Hand hand, const HapticPulse &pulse);
+  void StopOutput(Hand hand);
+
+  XrSession session_;
+  XrAction vibrate_action_;
+  std::array<XrPath, (size_t)Hand::kCount> hand_subaction_path_;
+  std::array<Channel, (size_t)Hand::kCount> channels_;
+
+  uint64_t runtime_calls_{0};
+  uint64_t active_updates_{0};
+};
+
+/**
+ * Press and release edges of an analog grab. The press threshold is above the
+ * release threshold, so a value hovering around either does not toggle.
+ */
+class GrabEdges {
+ public:
+  enum class Edge { kNone, kPress, kRelease };
+
+  DISABLE_MOVE_AND_COPY(GrabEdges);
+  GrabEdges() = default;
+  ~GrabEdges() = default;
+
+  /* An inactive action ends the grab without a release edge */
+  Edge Update(bool is_active, float value);
+
+  inline bool is_grabbing() const;
+
+  static constexpr float kPressThreshold = 0.9f;
+  static constexpr float kReleaseThreshold = 0.8f;
+
+ private:
+  bool is_grabbing_{false};
+};
+
+inline uint64_t
+HapticScheduler::runtime_calls()
+{
+  return runtime_calls_;
+}
+
+inline uint64_t
+HapticScheduler::active_updates()
+{
+  return active_updates_;
+}
+
+inline bool
+GrabEdges::is_grabbing() const
+{
+  return is_grabbing_;
+}
+
+}  // namespace zen::mirror
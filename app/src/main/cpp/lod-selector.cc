@@ -0,0 +1,123 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "lod-selector.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+void
+LodSelector::SetLods(uint64_t id, std::vector<Lod> lods)
+{
+  Object &object = objects_[id];
+  if (object.lods.empty() && !lods.empty()) lod_object_count_++;
+  if (!object.lods.empty() && lods.empty()) lod_object_count_--;
+  object.lods = std::move(lods);
+  object.lod = 0;
+}
+
+void
+LodSelector::SetBounds(uint64_t id, const Aabb &bounds)
+{
+  Object &object = objects_[id];
+  object.center = (bounds.min + bounds.max) * 0.5f;
+  object.radius = glm::length(bounds.max - bounds.min) * 0.5f;
+  object.has_bounds = true;
+}
+
+void
+LodSelector::Remove(uint64_t id)
+{
+  auto it = objects_.find(id);
+  if (it == objects_.end()) return;
+  if (!it->second.lods.empty()) lod_object_count_--;
+  objects_.erase(it);
+}
+
+void
+LodSelector::Select(
+    const std::vector<XrView> &views, const std::vector<uint64_t> &visible)
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  selected_.clear();
+  if (lod_object_count_ == 0 || visible.empty() || display_width_ == 0 ||
+      views.empty()) {
+    return;
+  }
+
+  // The longest focal length among the views, in display pixels
+  float focal_length = 0;
+  eyes_.clear();
+  for (const auto &view : views) {
+    const float tan_width =
+        tanf(view.fov.angleRight) - tanf(view.fov.angleLeft);
+    if (tan_width > 0) {
+      focal_length = std::max(focal_length, display_width_ / tan_width);
+    }
+    eyes_.push_back(Math::ToGlm(view.pose.position));
+  }
+
+  bool is_switched = false;
+  for (uint64_t id : visible) {
+    auto it = objects_.find(id);
+    if (it == objects_.end()) continue;
+    Object &object = it->second;
+    if (object.lods.empty() || !object.has_bounds) continue;
+
+    float distance = std::numeric_limits<float>::max();
+    for (const auto &eye : eyes_) {
+      distance = std::min(
+          distance, glm::length(object.center - eye) - object.radius);
+    }
+    const float pixels_per_meter = focal_length / std::max(distance, near_);
+
+    const auto &lods = object.lods;
+    uint32_t lod = std::min<uint32_t>(object.lod, lods.size() - 1);
+    if (lods[lod].error * pixels_per_meter > kMaxErrorPixels) {
+      lod = Coarsest(lods, kMaxErrorPixels / pixels_per_meter);
+    } else {
+      const float max_error = kMaxErrorPixels * kHysteresis / pixels_per_meter;
+      lod = std::max(lod, Coarsest(lods, max_error));
+    }
+
+    if (lod != object.lod) {
+      is_switched = true;
+      switches_++;
+    }
+    object.lod = lod;
+    selected_.push_back(Selection{id, lod});
+
+    triangles_ += lods[lod].triangle_count;
+    full_triangles_ += lods[0].triangle_count;
+  }
+
+  if (auto sink = sink_.lock(); sink && is_switched) {
+    sink->SendLodSelection(selected_);
+  }
+
+  select_time_ += std::chrono::steady_clock::now() - begin;
+  if (++frames_ % kStatsPeriodFrames == 0) LogStats();
+}
+
+uint32_t
+LodSelector::Coarsest(const std::vector<Lod> &lods, float max_error)
+{
+  uint32_t coarsest = 0;
+  for (uint32_t i = 1; i < lods.size(); i++) {
+    if (lods[i].error <= max_error) coarsest = i;
+  }
+  return coarsest;
+}
+
+void
+LodSelector::LogStats()
+{
+  LOG_DEBUG("LOD selection: %.1f us/frame, %.0f triangles/frame instead of "
+            "%.0f at full detail, %.2f switches/frame",
+      (float)select_time_.count() / 1000 / frames_,
+      (float)triangles_ / frames_, (float)full_triangles_ / frames_,
+      (float)switches_ / frames_);
+}
+
+}  // namespace zen::mirror
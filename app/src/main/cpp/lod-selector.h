@@ -0,0 +1,125 @@
+#pragma once
+
+#include "bvh.h"
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Picks a level of detail for each visible remote object every frame, the
+ * coarsest whose error projects to at most kMaxErrorPixels on the display.
+ * The error is projected from the point of the object's bounding sphere
+ * nearest to the eyes, with the focal length of the views in display
+ * pixels; the supersampled swapchains then add no detail that could hide
+ * coarser levels.
+ *
+ * An object only moves to a coarser level once it would stay within
+ * kHysteresis of the limit, so objects at the boundary do not pop back and
+ * forth as the head moves slightly.
+ *
+ * The sink gets the whole selection on the frames in which an object
+ * switched levels; the server then draws each object with its level.
+ */
+class LodSelector {
+ public:
+  struct ISink;
+
+  struct Lod {
+    float error;  // in meters; 0 for the full mesh
+    uint32_t triangle_count;
+  };
+
+  struct Selection {
+    uint64_t id;
+    uint32_t lod;  // index into the levels given to SetLods
+  };
+
+  DISABLE_MOVE_AND_COPY(LodSelector);
+  /* `near` is the near plane of the projection of the views */
+  LodSelector(float near) : near_(near) {}
+  ~LodSelector() = default;
+
+  /* Width of the views on the display, in pixels */
+  inline void set_display_width(uint32_t display_width);
+
+  /* Levels from the full mesh on, with increasing errors */
+  void SetLods(uint64_t id, std::vector<Lod> lods);
+
+  /* Add an object or move an existing one */
+  void SetBounds(uint64_t id, const Aabb &bounds);
+
+  void Remove(uint64_t id);
+
+  /* Objects without levels or bounds are left out of the selection */
+  void Select(
+      const std::vector<XrView> &views, const std::vector<uint64_t> &visible);
+
+  /* The result of the last Select, in the order of `visible` */
+  inline const std::vector<Selection> &selected() const;
+
+  inline void set_sink(std::weak_ptr<ISink> sink);
+
+ private:
+  struct Object {
+    std::vector<Lod> lods;
+    glm::vec3 center{0};
+    float radius{0};
+    bool has_bounds{false};
+    uint32_t lod{0};
+  };
+
+  static constexpr float kMaxErrorPixels = 1.f;
+  static constexpr float kHysteresis = 0.75f;
+
+  // Write out the triangle counts every this many frames
+  static constexpr uint64_t kStatsPeriodFrames = 1000;
+
+  /* The coarsest level whose projected error is within `max_error` */
+  static uint32_t Coarsest(const std::vector<Lod> &lods, float max_error);
+
+  void LogStats();
+
+  const float near_;  // anything closer projects as if at this distance
+  uint32_t display_width_{0};
+  std::unordered_map<uint64_t, Object> objects_;
+  size_t lod_object_count_{0};  // of objects_ with levels
+  std::vector<Selection> selected_;
+  std::weak_ptr<ISink> sink_;
+
+  // Scratch buffers of Select reused every frame
+  std::vector<glm::vec3> eyes_;
+
+  uint64_t frames_{0};
+  uint64_t triangles_{0};
+  uint64_t full_triangles_{0};
+  uint64_t switches_{0};
+  std::chrono::nanoseconds select_time_{0};
+};
+
+inline void
+LodSelector::set_display_width(uint32_t display_width)
+{
+  display_width_ = display_width;
+}
+
+inline const std::vector<LodSelector::Selection> &
+LodSelector::selected() const
+{
+  return selected_;
+}
+
+struct LodSelector::ISink {
+  DISABLE_MOVE_AND_COPY(ISink);
+  ISink() = default;
+  virtual ~ISink() = default;
+
+  virtual void SendLodSelection(const std::vector<Selection> &selected) = 0;
+};
+
+inline void
+LodSelector::set_sink(std::weak_ptr<ISink> sink)
+{
+  sink_ = std::move(sink);
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,76 @@
+#include "pch.h"
+
+#include "lz4-block.h"
+
+namespace zen::mirror::lz4 {
+
+namespace {
+
+constexpr size_t kMinMatchLength = 4;
+
+/* Add the extra length bytes following a length of 15 in the token */
+inline bool
+ReadLength(const uint8_t **cursor, const uint8_t *end, size_t *length)
+{
+  if (*length != 15) return true;
+
+  uint8_t byte;
+  do {
+    if (*cursor == end) return false;
+    byte = *(*cursor)++;
+    *length += byte;
+  } while (byte == 255);
+
+  return true;
+}
+
+}  // namespace
+
+bool
+DecompressBlock(
+    const uint8_t *data, size_t data_size, uint8_t *out, size_t size)
+{
+  const uint8_t *cursor = data;
+  const uint8_t *const end = data + data_size;
+  uint8_t *output = out;
+  uint8_t *const output_end = out + size;
+
+  while (cursor < end) {
+    const uint8_t token = *cursor++;
+
+    size_t literal_length = token >> 4;
+    if (!ReadLength(&cursor, end, &literal_length)) return false;
+    if (literal_length > (size_t)(end - cursor)) return false;
+    if (literal_length > (size_t)(output_end - output)) return false;
+
+    memcpy(output, cursor, literal_length);
+    cursor += literal_length;
+    output += literal_length;
+
+    // The last sequence has literals only
+    if (cursor == end) break;
+
+    if (end - cursor < 2) return false;
+    const size_t offset = cursor[0] | (cursor[1] << 8);
+    cursor += 2;
+    if (offset == 0 || offset > (size_t)(output - out)) return false;
+
+    size_t match_length = token & 0x0f;
+    if (!ReadLength(&cursor, end, &match_length)) return false;
+    match_length += kMinMatchLength;
+    if (match_length > (size_t)(output_end - output)) return false;
+
+    const uint8_t *match = output - offset;
+    if (offset >= match_length) {
+      memcpy(output, match, match_length);
+      output += match_length;
+    } else {
+      // Overlapping matches repeat the last `offset` bytes
+      for (size_t i = 0; i < match_length; i++) *output++ = *match++;
+    }
+  }
+
+  return output == output_end;
+}
+
+}  // namespace zen::mirror::lz4
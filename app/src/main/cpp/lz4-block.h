@@ -0,0 +1,17 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror::lz4 {
+
+/**
+ * Decompress one block in the LZ4 block format, without the frame format
+ * around it.
+ *
+ * @returns true if the block is well formed and decompresses to exactly
+ * `size` bytes; `out` is left partially written otherwise.
+ */
+bool DecompressBlock(
+    const uint8_t *data, size_t data_size, uint8_t *out, size_t size);
+
+}  // namespace zen::mirror::lz4
@@ -1,14 +1,20 @@
 #include "pch.h"
 
+#include "bulk-channel.h"
 #include "config.h"
+#include "content-cache.h"
 #include "logger.h"
 #include "loop.h"
+#include "mesh-lod-generator.h"
 #include "openxr-action-source.h"
 #include "openxr-context.h"
 #include "openxr-event-source.h"
+#include "openxr-hand-tracking-source.h"
 #include "openxr-view-source.h"
+#include "ray-picker.h"
 #include "remote-log-sink.h"
 #include "remote-loop.h"
+#include "scene-latency.h"
 
 using namespace zen::mirror;
 
@@ -36,6 +42,35 @@ android_main(struct android_app *app)
       return;
     }
 
+    auto bulk_channel =
+        std::make_shared<BulkChannel>(std::make_shared<RemoteLoop>(loop),
+            context->worker_pool(), config::BULK_COMPRESSION_THRESHOLD,
+            config::BULK_MAX_BLOB_SIZE_MB * 1024 * 1024);
+    if (config::BULK_CHANNEL_PORT == 0) {
+      LOG_INFO("Bulk channel is disabled");
+    } else if (!bulk_channel->Init(config::BULK_CHANNEL_PORT)) {
+      LOG_WARN("Bulk channel is not available");
+    }
+
+    // Filled and served through the bulk channel only
+    std::shared_ptr<ContentCache> content_cache;
+    if (bulk_channel->port() != 0) {
+      content_cache = std::make_shared<ContentCache>(
+          std::string(app->activity->internalDataPath) + "/content-cache",
+          config::CONTENT_CACHE_SIZE_MB * 1024 * 1024);
+      if (content_cache->Init()) {
+        bulk_channel->set_content_cache(content_cache);
+      } else {
+        LOG_WARN("Content cache is not available");
+      }
+    }
+
+    context->gpu_memory_budget()->set_sink(bulk_channel);
+    bulk_channel->set_shader_sink(context->program_binary_cache());
+
+    auto scene_latency = std::make_shared<SceneLatency>();
+    bulk_channel->set_latency_sink(scene_latency);
+
     auto xr_event_source = std::make_shared<OpenXREventSource>(context, loop);
 
     auto action_source = std::make_shared<OpenXRActionSource>(context, loop);
@@ -44,6 +79,9 @@ android_main(struct android_app *app)
       return;
     }
 
+    auto ray_picker = std::make_shared<RayPicker>();
+    action_source->set_ray_picker(ray_picker);
+
     std::shared_ptr<OpenXRViewSource> view_source;
     view_source = std::make_shared<OpenXRViewSource>(context, loop, remote);
 
@@ -52,6 +90,34 @@ android_main(struct android_app *app)
       return;
     }
 
+    view_source->AddFrameListener(action_source);
+    view_source->set_scene_latency(scene_latency);
+    view_source->set_ray_picker(ray_picker);
+    bulk_channel->set_scene_sink(view_source);
+    view_source->lod_selector()->set_sink(bulk_channel);
+
+    auto mesh_lod_generator = std::make_shared<MeshLodGenerator>(
+        std::make_shared<RemoteLoop>(loop), context->worker_pool());
+    if (mesh_lod_generator->Init()) {
+      mesh_lod_generator->set_lod_selector(view_source->lod_selector());
+      mesh_lod_generator->set_sink(bulk_channel);
+      bulk_channel->set_mesh_sink(mesh_lod_generator);
+    } else {
+      LOG_WARN("Mesh levels of detail are not generated");
+    }
+
+    // The bulk channel is the only way to the server for the hands
+    auto hand_tracking_source =
+        std::make_shared<OpenXRHandTrackingSource>(context, loop);
+    if (bulk_channel->port() == 0) {
+      LOG_INFO("Hand tracking is not streamed without the bulk channel");
+    } else if (hand_tracking_source->Init()) {
+      hand_tracking_source->set_sink(bulk_channel);
+      view_source->AddFrameListener(hand_tracking_source);
+    } else {
+      LOG_INFO("Hand tracking is not available");
+    }
+
     loop->AddBusy(xr_event_source);
     loop->AddBusy(action_source);
     loop->AddBusy(view_source);
@@ -0,0 +1,236 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "media-codec-encoder.h"
+
+namespace zen::mirror {
+
+namespace {
+
+/* BT.601 limited range, the default of H.264 decoders */
+inline uint8_t
+ToY(int32_t r, int32_t g, int32_t b)
+{
+  return (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+inline uint8_t
+ToU(int32_t r, int32_t g, int32_t b)
+{
+  return (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+inline uint8_t
+ToV(int32_t r, int32_t g, int32_t b)
+{
+  return (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/**
+ * `width` and `height` must be even. Rows of both planes are `stride` bytes
+ * apart, and the UV plane starts `slice_height` rows after the Y plane.
+ */
+void
+ConvertToNv12(const uint8_t *rgba, uint32_t width, uint32_t height,
+    uint32_t stride, uint32_t slice_height, uint8_t *nv12)
+{
+  uint8_t *y_plane = nv12;
+  uint8_t *uv_plane = nv12 + (size_t)stride * slice_height;
+  const size_t rgba_stride = (size_t)width * 4;
+
+  for (uint32_t y = 0; y < height; y += 2) {
+    const uint8_t *row0 = rgba + y * rgba_stride;
+    const uint8_t *row1 = row0 + rgba_stride;
+    uint8_t *y_row0 = y_plane + (size_t)y * stride;
+    uint8_t *y_row1 = y_row0 + stride;
+    uint8_t *uv_row = uv_plane + (size_t)y / 2 * stride;
+
+    for (uint32_t x = 0; x < width; x += 2) {
+      const uint8_t *p00 = row0 + x * 4;
+      const uint8_t *p01 = p00 + 4;
+      const uint8_t *p10 = row1 + x * 4;
+      const uint8_t *p11 = p10 + 4;
+
+      y_row0[x] = ToY(p00[0], p00[1], p00[2]);
+      y_row0[x + 1] = ToY(p01[0], p01[1], p01[2]);
+      y_row1[x] = ToY(p10[0], p10[1], p10[2]);
+      y_row1[x + 1] = ToY(p11[0], p11[1], p11[2]);
+
+      const int32_t r = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+      const int32_t g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+      const int32_t b = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+      uv_row[x] = ToU(r, g, b);
+      uv_row[x + 1] = ToV(r, g, b);
+    }
+  }
+}
+
+}  // namespace
+
+MediaCodecEncoder::~MediaCodecEncoder()
+{
+  if (format_ != nullptr) AMediaFormat_delete(format_);
+  if (codec_ == nullptr) return;
+
+  Stop();
+  AMediaCodec_delete(codec_);
+
+  if (dropped_frames_ > 0) {
+    LOG_DEBUG("H.264 encoder dropped %" PRIu64 " frames without an input "
+              "buffer",
+        dropped_frames_);
+  }
+}
+
+bool
+MediaCodecEncoder::Init(uint32_t width, uint32_t height, float rate)
+{
+  width_ = width;
+  height_ = height;
+
+  codec_ = AMediaCodec_createEncoderByType(kMimeType);
+  if (codec_ == nullptr) {
+    LOG_WARN("No H.264 encoder is available");
+    return false;
+  }
+
+  format_ = AMediaFormat_new();
+  AMediaFormat_setString(format_, AMEDIAFORMAT_KEY_MIME, kMimeType);
+  AMediaFormat_setInt32(format_, AMEDIAFORMAT_KEY_WIDTH, width);
+  AMediaFormat_setInt32(format_, AMEDIAFORMAT_KEY_HEIGHT, height);
+  AMediaFormat_setInt32(
+      format_, AMEDIAFORMAT_KEY_COLOR_FORMAT, kColorFormatYuv420SemiPlanar);
+  AMediaFormat_setInt32(format_, AMEDIAFORMAT_KEY_BIT_RATE,
+      (int32_t)(kBitsPerPixel * width * height * rate));
+  AMediaFormat_setInt32(
+      format_, AMEDIAFORMAT_KEY_FRAME_RATE, std::max(1, (int32_t)rate));
+  AMediaFormat_setInt32(
+      format_, AMEDIAFORMAT_KEY_I_FRAME_INTERVAL, kKeyFrameInterval);
+
+  return true;
+}
+
+bool
+MediaCodecEncoder::Start()
+{
+  media_status_t status = AMediaCodec_configure(
+      codec_, format_, nullptr, nullptr, AMEDIACODEC_CONFIGURE_FLAG_ENCODE);
+  if (status != AMEDIA_OK) {
+    LOG_ERROR("Failed to configure the H.264 encoder: %d", status);
+    return false;
+  }
+
+  // Encoders may want rows and the UV plane aligned past the frame
+  stride_ = width_;
+  slice_height_ = height_;
+  if (__builtin_available(android 28, *)) {
+    if (AMediaFormat *input = AMediaCodec_getInputFormat(codec_)) {
+      int32_t stride = 0, slice_height = 0;
+      if (AMediaFormat_getInt32(input, AMEDIAFORMAT_KEY_STRIDE, &stride)) {
+        stride_ = std::max(width_, (uint32_t)std::max(stride, 0));
+      }
+      if (AMediaFormat_getInt32(
+              input, AMEDIAFORMAT_KEY_SLICE_HEIGHT, &slice_height)) {
+        slice_height_ = std::max(height_, (uint32_t)std::max(slice_height, 0));
+      }
+      AMediaFormat_delete(input);
+    }
+  }
+
+  status = AMediaCodec_start(codec_);
+  if (status != AMEDIA_OK) {
+    LOG_ERROR("Failed to start the H.264 encoder: %d", status);
+    AMediaCodec_stop(codec_);  // back to unconfigured
+    return false;
+  }
+  is_started_ = true;
+  codec_config_.clear();
+
+  LOG_DEBUG("H.264 encoder started, input stride %u, slice height %u",
+      stride_, slice_height_);
+
+  return true;
+}
+
+void
+MediaCodecEncoder::Stop()
+{
+  if (!is_started_) return;
+
+  AMediaCodec_stop(codec_);
+  is_started_ = false;
+}
+
+SpectatorStream::Codec
+MediaCodecEncoder::codec() const
+{
+  return SpectatorStream::Codec::kH264;
+}
+
+bool
+MediaCodecEncoder::Encode(const uint8_t *rgba, int64_t time,
+    std::vector<SpectatorStream::Packet> *packets)
+{
+  ssize_t index = AMediaCodec_dequeueInputBuffer(codec_, 0);
+  if (index < 0) {
+    dropped_frames_++;
+    return Drain(packets);
+  }
+
+  const size_t size = (size_t)stride_ * slice_height_ * 3 / 2;
+  size_t capacity = 0;
+  uint8_t *buffer = AMediaCodec_getInputBuffer(codec_, index, &capacity);
+  if (buffer == nullptr || capacity < size) {
+    LOG_ERROR("H.264 encoder input buffer too small: %zu < %zu", capacity,
+        size);
+    return false;
+  }
+
+  ConvertToNv12(rgba, width_, height_, stride_, slice_height_, buffer);
+
+  media_status_t status =
+      AMediaCodec_queueInputBuffer(codec_, index, 0, size, time / 1000, 0);
+  if (status != AMEDIA_OK) {
+    LOG_ERROR("Failed to queue a frame to the H.264 encoder: %d", status);
+    return false;
+  }
+
+  return Drain(packets);
+}
+
+bool
+MediaCodecEncoder::Drain(std::vector<SpectatorStream::Packet> *packets)
+{
+  while (true) {
+    AMediaCodecBufferInfo info;
+    ssize_t index = AMediaCodec_dequeueOutputBuffer(codec_, &info, 0);
+    if (index == AMEDIACODEC_INFO_TRY_AGAIN_LATER) return true;
+    if (index == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED ||
+        index == AMEDIACODEC_INFO_OUTPUT_BUFFERS_CHANGED) {
+      continue;
+    }
+    if (index < 0) {
+      LOG_ERROR("Failed to take output of the H.264 encoder: %zd", index);
+      return false;
+    }
+
+    size_t capacity = 0;
+    const uint8_t *data = AMediaCodec_getOutputBuffer(codec_, index, &capacity);
+    if (data != nullptr && info.size > 0) {
+      data += info.offset;
+      if (info.flags & AMEDIACODEC_BUFFER_FLAG_CODEC_CONFIG) {
+        codec_config_.assign(data, data + info.size);
+      } else {
+        SpectatorStream::Packet packet{info.presentationTimeUs * 1000,
+            (info.flags & kBufferFlagKeyFrame) != 0, {}};
+        if (packet.is_key_frame) packet.data = codec_config_;
+        packet.data.insert(packet.data.end(), data, data + info.size);
+        packets->push_back(std::move(packet));
+      }
+    }
+
+    AMediaCodec_releaseOutputBuffer(codec_, index, false);
+  }
+}
+
+}  // namespace zen::mirror
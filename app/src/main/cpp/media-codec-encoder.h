@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+#include "spectator-stream.h"
+
+namespace zen::mirror {
+
+/**
+ * H.264 through the hardware encoder of the device, running only while a
+ * viewer is connected. Frames are converted to NV12 in the layout of the
+ * encoder's input format on the encoder thread and queued without waiting
+ * for an input buffer; a frame finding none is dropped. Each viewer starts
+ * with a key frame, and one comes every kKeyFrameInterval after.
+ */
+class MediaCodecEncoder final : public SpectatorStream::IEncoder {
+ public:
+  DISABLE_MOVE_AND_COPY(MediaCodecEncoder);
+  MediaCodecEncoder() = default;
+  ~MediaCodecEncoder() override;
+
+  bool Init(uint32_t width, uint32_t height, float rate) override;
+  bool Start() override;
+  void Stop() override;
+  SpectatorStream::Codec codec() const override;
+  bool Encode(const uint8_t *rgba, int64_t time,
+      std::vector<SpectatorStream::Packet> *packets) override;
+
+ private:
+  static constexpr const char *kMimeType = "video/avc";
+  static constexpr int32_t kColorFormatYuv420SemiPlanar = 21;
+  static constexpr uint32_t kBufferFlagKeyFrame = 1;
+  static constexpr float kBitsPerPixel = 0.3f;     // 4 Mbps at 640x672, 30 Hz
+  static constexpr int32_t kKeyFrameInterval = 1;  // in seconds
+
+  /* Hand the output ready so far to `packets` */
+  bool Drain(std::vector<SpectatorStream::Packet> *packets);
+
+  AMediaCodec *codec_{nullptr};
+  AMediaFormat *format_{nullptr};  // configured again on every Start
+  bool is_started_{false};
+  uint32_t width_{0};
+  uint32_t height_{0};
+  uint32_t stride_{0};        // of the rows of both planes, in bytes
+  uint32_t slice_height_{0};  // rows of the Y plane before the UV plane
+  std::vector<uint8_t> codec_config_;  // prepended to key frames
+  uint64_t dropped_frames_{0};
+};
+
+}  // namespace zen::mirror
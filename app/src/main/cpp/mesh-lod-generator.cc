@@ -0,0 +1,87 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "mesh-lod-generator.h"
+
+namespace zen::mirror {
+
+MeshLodGenerator::~MeshLodGenerator()
+{
+  if (shared_->event_fd != -1) loop_->RemoveFd(&event_source_);
+}
+
+MeshLodGenerator::Shared::~Shared()
+{
+  if (event_fd != -1) close(event_fd);
+}
+
+bool
+MeshLodGenerator::Init()
+{
+  shared_->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (shared_->event_fd == -1) {
+    LOG_ERROR("Failed to create the mesh LOD event: %s", strerror(errno));
+    return false;
+  }
+
+  event_source_.fd = shared_->event_fd;
+  event_source_.mask = remote::FdSource::kReadable;
+  event_source_.callback = [this](int /*fd*/, uint32_t /*mask*/) {
+    FinishGenerated();
+  };
+  loop_->AddFd(&event_source_);
+
+  return true;
+}
+
+void
+MeshLodGenerator::SetMesh(uint64_t id, std::vector<glm::vec3> positions,
+    std::vector<uint32_t> indices)
+{
+  if (shared_->event_fd == -1) return;
+
+  // Out of range indices are dropped with their triangles by the simplifier
+  worker_pool_->Post([shared = shared_, id, positions = std::move(positions),
+                         indices = std::move(indices)] {
+    auto levels = mesh::GenerateLevels(positions.data(), positions.size(),
+        indices, kMaxLevelCount, kMinLevelTriangleCount);
+
+    {
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      shared->generated.push_back(Levels{id, std::move(levels)});
+    }
+
+    uint64_t count = 1;
+    write(shared->event_fd, &count, sizeof(count));
+  });
+}
+
+void
+MeshLodGenerator::FinishGenerated()
+{
+  uint64_t count;
+  read(shared_->event_fd, &count, sizeof(count));
+
+  std::deque<Levels> generated;
+  {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    generated.swap(shared_->generated);
+  }
+
+  auto sink = sink_.lock();
+
+  for (auto &mesh : generated) {
+    if (lod_selector_) {
+      std::vector<LodSelector::Lod> lods;
+      for (const auto &level : mesh.levels) {
+        lods.push_back(LodSelector::Lod{
+            level.error, (uint32_t)(level.indices.size() / 3)});
+      }
+      lod_selector_->SetLods(mesh.id, std::move(lods));
+    }
+
+    if (sink) sink->SendLevels(mesh.id, mesh.levels);
+  }
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "bulk-channel.h"
+#include "common.h"
+#include "lod-selector.h"
+#include "mesh-simplifier.h"
+#include "worker-pool.h"
+
+namespace zen::mirror {
+
+/**
+ * Generates coarser levels of detail of the meshes the server sends with a
+ * single one. The levels are generated on the worker pool; back on the loop
+ * thread, their errors go to the LOD selector and their indices to the sink,
+ * for the server to draw the level the selector picks.
+ */
+class MeshLodGenerator : public BulkChannel::IMeshSink {
+ public:
+  DISABLE_MOVE_AND_COPY(MeshLodGenerator);
+  MeshLodGenerator(std::shared_ptr<remote::ILoop> loop, WorkerPool *worker_pool)
+      : loop_(std::move(loop)),
+        worker_pool_(worker_pool),
+        shared_(std::make_shared<Shared>())
+  {
+  }
+  ~MeshLodGenerator() override;
+
+  bool Init();
+
+  void SetMesh(uint64_t id, std::vector<glm::vec3> positions,
+      std::vector<uint32_t> indices) override;
+
+  /* Given the errors of the levels; outlives this */
+  inline void set_lod_selector(LodSelector *lod_selector);
+
+  inline void set_sink(std::weak_ptr<mesh::ILevelsSink> sink);
+
+ private:
+  struct Levels {
+    uint64_t id;
+    std::vector<mesh::Level> levels;
+  };
+
+  /* Shared with the tasks on the worker pool, which may outlive this */
+  struct Shared {
+    DISABLE_MOVE_AND_COPY(Shared);
+    Shared() = default;
+    ~Shared();
+
+    int event_fd{-1};  // signaled when the levels of a mesh are generated
+    std::mutex mutex;
+    std::deque<Levels> generated;  // guarded by mutex
+  };
+
+  /* Hand the generated levels to the LOD selector and the sink */
+  void FinishGenerated();
+
+  static constexpr size_t kMaxLevelCount = 8;
+  static constexpr size_t kMinLevelTriangleCount = 256;
+
+  std::shared_ptr<remote::ILoop> loop_;
+  WorkerPool *worker_pool_;
+  std::shared_ptr<Shared> shared_;
+  remote::FdSource event_source_{};
+  LodSelector *lod_selector_{nullptr};
+  std::weak_ptr<mesh::ILevelsSink> sink_;
+};
+
+inline void
+MeshLodGenerator::set_lod_selector(LodSelector *lod_selector)
+{
+  lod_selector_ = lod_selector;
+}
+
+inline void
+MeshLodGenerator::set_sink(std::weak_ptr<mesh::ILevelsSink> sink)
+{
+  sink_ = std::move(sink);
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,159 @@
+#include "pch.h"
+
+#include "mesh-simplifier.h"
+
+namespace zen::mirror::mesh {
+
+namespace {
+
+// Cell coordinates are packed into 64 bits
+constexpr uint32_t kCellBits = 21;
+constexpr uint64_t kCellMax = (1ull << kCellBits) - 1;
+
+// The first level tried is a grid of this many cells along the longest axis
+constexpr float kInitialCellsPerAxis = 256.f;
+constexpr float kCellGrowth = 1.5f;
+
+struct Cell {
+  glm::vec3 sum{0};
+  uint32_t count{0};
+  uint32_t representative{std::numeric_limits<uint32_t>::max()};
+  float representative_distance2{0};
+};
+
+struct TriangleHash {
+  size_t operator()(const std::array<uint32_t, 3> &triangle) const
+  {
+    uint64_t hash = triangle[0];
+    hash = hash * 0x9e3779b97f4a7c15ull + triangle[1];
+    hash = hash * 0x9e3779b97f4a7c15ull + triangle[2];
+    return (size_t)(hash ^ (hash >> 32));
+  }
+};
+
+void
+ComputeBounds(const glm::vec3 *positions, size_t vertex_count, glm::vec3 *min,
+    glm::vec3 *max)
+{
+  *min = glm::vec3(std::numeric_limits<float>::max());
+  *max = glm::vec3(std::numeric_limits<float>::lowest());
+  for (size_t i = 0; i < vertex_count; i++) {
+    *min = glm::min(*min, positions[i]);
+    *max = glm::max(*max, positions[i]);
+  }
+}
+
+}  // namespace
+
+Level
+Simplify(const glm::vec3 *positions, size_t vertex_count,
+    const std::vector<uint32_t> &indices, float cell_size)
+{
+  Level level{{}, 0.f};
+  if (vertex_count == 0 || cell_size <= 0) return level;
+
+  glm::vec3 min, max;
+  ComputeBounds(positions, vertex_count, &min, &max);
+
+  auto cell_key = [&](const glm::vec3 &position) {
+    glm::vec3 cell = (position - min) / cell_size;
+    uint64_t x = std::min((uint64_t)cell.x, kCellMax);
+    uint64_t y = std::min((uint64_t)cell.y, kCellMax);
+    uint64_t z = std::min((uint64_t)cell.z, kCellMax);
+    return x | (y << kCellBits) | (z << (kCellBits * 2));
+  };
+
+  std::unordered_map<uint64_t, uint32_t> cell_indices;
+  cell_indices.reserve(vertex_count);
+  std::vector<Cell> cells;
+  std::vector<uint32_t> vertex_cells(vertex_count);
+
+  for (size_t i = 0; i < vertex_count; i++) {
+    auto [it, inserted] =
+        cell_indices.try_emplace(cell_key(positions[i]), cells.size());
+    if (inserted) cells.emplace_back();
+    cells[it->second].sum += positions[i];
+    cells[it->second].count++;
+    vertex_cells[i] = it->second;
+  }
+
+  // The vertex nearest the mean of its cell represents the cell
+  for (size_t i = 0; i < vertex_count; i++) {
+    Cell &cell = cells[vertex_cells[i]];
+    glm::vec3 mean = cell.sum / (float)cell.count;
+    glm::vec3 offset = positions[i] - mean;
+    float distance2 = glm::dot(offset, offset);
+    if (cell.representative == std::numeric_limits<uint32_t>::max() ||
+        distance2 < cell.representative_distance2) {
+      cell.representative = (uint32_t)i;
+      cell.representative_distance2 = distance2;
+    }
+  }
+
+  for (size_t i = 0; i < vertex_count; i++) {
+    glm::vec3 offset =
+        positions[i] - positions[cells[vertex_cells[i]].representative];
+    level.error = std::max(level.error, glm::length(offset));
+  }
+
+  std::unordered_set<std::array<uint32_t, 3>, TriangleHash> triangles;
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    std::array<uint32_t, 3> triangle;
+    bool is_valid = true;
+    for (size_t j = 0; j < 3; j++) {
+      uint32_t index = indices[i + j];
+      if (index >= vertex_count) {
+        is_valid = false;
+        break;
+      }
+      triangle[j] = cells[vertex_cells[index]].representative;
+    }
+    if (!is_valid || triangle[0] == triangle[1] || triangle[1] == triangle[2] ||
+        triangle[2] == triangle[0]) {
+      continue;
+    }
+
+    // Rotate the smallest index first, keeping the winding, to find
+    // duplicates
+    auto smallest = std::min_element(triangle.begin(), triangle.end());
+    std::rotate(triangle.begin(), smallest, triangle.end());
+    if (!triangles.insert(triangle).second) continue;
+
+    level.indices.insert(level.indices.end(), triangle.begin(), triangle.end());
+  }
+
+  return level;
+}
+
+std::vector<Level>
+GenerateLevels(const glm::vec3 *positions, size_t vertex_count,
+    const std::vector<uint32_t> &indices, size_t max_level_count,
+    size_t min_triangle_count)
+{
+  std::vector<Level> levels;
+  levels.push_back(Level{indices, 0.f});
+  if (vertex_count == 0) return levels;
+
+  glm::vec3 min, max;
+  ComputeBounds(positions, vertex_count, &min, &max);
+  const glm::vec3 extent = max - min;
+  const float longest = std::max({extent.x, extent.y, extent.z});
+  if (longest <= 0) return levels;
+
+  // Each level is simplified from the full mesh, so errors do not add up
+  for (float cell_size = longest / kInitialCellsPerAxis;
+       cell_size < longest && levels.size() < max_level_count &&
+       levels.back().indices.size() / 3 >= min_triangle_count;
+       cell_size *= kCellGrowth) {
+    Level level = Simplify(positions, vertex_count, indices, cell_size);
+    if (level.indices.empty()) break;
+
+    if (level.indices.size() * 4 <= levels.back().indices.size() * 3) {
+      levels.push_back(std::move(level));
+    }
+  }
+
+  return levels;
+}
+
+}  // namespace zen::mirror::mesh
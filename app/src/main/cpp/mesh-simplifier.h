@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror::mesh {
+
+/* A coarser index buffer over the vertices of the full mesh */
+struct Level {
+  std::vector<uint32_t> indices;
+  float error;  // the farthest a vertex moved, in the units of the positions
+};
+
+/**
+ * Simplify a triangle list by vertex clustering: the vertices in each cell
+ * of a grid of `cell_size` collapse to the one nearest their mean, and the
+ * triangles that degenerate are dropped. Vertices are reused rather than
+ * created, so normals and texture coordinates stay valid.
+ */
+Level Simplify(const glm::vec3 *positions, size_t vertex_count,
+    const std::vector<uint32_t> &indices, float cell_size);
+
+/**
+ * Levels of detail coarsening from the full mesh until fewer than
+ * `min_triangle_count` triangles remain or `max_level_count` levels are
+ * made. Each level has at most 3/4 of the triangles of the previous one.
+ * The first level is the full mesh with an error of 0. Pure; run it on the
+ * worker pool.
+ */
+std::vector<Level> GenerateLevels(const glm::vec3 *positions,
+    size_t vertex_count, const std::vector<uint32_t> &indices,
+    size_t max_level_count, size_t min_triangle_count);
+
+/* Takes the generated levels of each mesh to the server */
+struct ILevelsSink {
+  DISABLE_MOVE_AND_COPY(ILevelsSink);
+  ILevelsSink() = default;
+  virtual ~ILevelsSink() = default;
+
+  /* `levels` as GenerateLevels returns them, the full mesh first */
+  virtual void SendLevels(uint64_t id, const std::vector<Level> &levels) = 0;
+};
+
+}  // namespace zen::mirror::mesh
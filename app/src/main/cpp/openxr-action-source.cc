@@ -2,12 +2,34 @@
 
 #include "logger.h"
 #include "openxr-action-source.h"
+#include "openxr-bindings.h"
+#include "openxr-path-cache.h"
 #include "openxr-util.h"
 
 namespace zen::mirror {
 
+namespace {
+
+const HapticPattern kGrabPressPattern{
+    {20'000'000, 0.5f, XR_FREQUENCY_UNSPECIFIED},
+};
+
+const HapticPattern kGrabReleasePattern{
+    {10'000'000, 0.25f, XR_FREQUENCY_UNSPECIFIED},
+};
+
+}  // namespace
+
 OpenXRActionSource::~OpenXRActionSource()
 {
+  for (auto space : aim_spaces_) {
+    if (space != XR_NULL_HANDLE) xrDestroySpace(space);
+  }
+
+  if (aim_action_ != XR_NULL_HANDLE) {
+    xrDestroyAction(aim_action_);
+  }
+
   if (grab_action_ != XR_NULL_HANDLE) {
     xrDestroyAction(grab_action_);
   }
@@ -38,20 +60,43 @@ OpenXRActionSource::Init()
     }
   }
 
-  // Get the XrPath for the left and right hands - we will use them as subaction
-  // paths.
+  auto is_profile_available =
+      [this](const InteractionProfileBindings &profile) {
+        return profile.required_extension == nullptr ||
+               context_->IsExtensionEnabled(profile.required_extension);
+      };
+
+  // Resolve every path used for the bindings at once. Paths shared among the
+  // interaction profiles are resolved only once.
+  OpenXRPathCache path_cache(context_->instance());
   {
-    IF_XR_FAILED (err, xrStringToPath(context_->instance(), "/user/hand/left",
-                           &hand_subaction_path_[(int)Hand::kLeft])) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
+    const auto begin = std::chrono::steady_clock::now();
+
+    for (auto path : bindings::kHandSubactionPaths) {
+      path_cache.Add(path);
     }
 
-    IF_XR_FAILED (err, xrStringToPath(context_->instance(), "/user/hand/right",
-                           &hand_subaction_path_[(int)Hand::kRight])) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
+    for (auto &profile : bindings::kInteractionProfiles) {
+      if (!is_profile_available(profile)) continue;
+
+      path_cache.Add(profile.profile);
+      for (size_t i = 0; i < profile.binding_count; i++) {
+        path_cache.Add(profile.bindings[i].path);
+      }
+    }
+
+    if (!path_cache.Resolve()) return false;
+
+    for (auto hand : {Hand::kLeft, Hand::kRight}) {
+      hand_subaction_path_[(int)hand] =
+          path_cache.Get(bindings::kHandSubactionPaths[(int)hand]);
     }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - begin);
+    LOG_DEBUG("Resolved %zu paths for %zu path references in %" PRId64 " us",
+        path_cache.resolved_count(), path_cache.reference_count(),
+        (int64_t)elapsed.count());
   }
 
   // Create actions
@@ -81,36 +126,15 @@ OpenXRActionSource::Init()
       LOG_ERROR("%s", err.c_str());
       return false;
     }
-  }
-
-  // Create binding paths
-  std::array<XrPath, (size_t)Hand::kCount> squeeze_value_path;
-  std::array<XrPath, (size_t)Hand::kCount> haptic_path;
-  {
-    IF_XR_FAILED (err, xrStringToPath(context_->instance(),
-                           "/user/hand/left/input/squeeze/value",
-                           &squeeze_value_path[(int)Hand::kLeft])) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
-    }
-
-    IF_XR_FAILED (err, xrStringToPath(context_->instance(),
-                           "/user/hand/right/input/squeeze/value",
-                           &squeeze_value_path[(int)Hand::kRight])) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
-    }
-
-    IF_XR_FAILED (err,
-        xrStringToPath(context_->instance(), "/user/hand/left/output/haptic",
-            &haptic_path[(int)Hand::kLeft])) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
-    }
 
+    action_create_info.actionType = XR_ACTION_TYPE_POSE_INPUT;
+    strcpy(action_create_info.actionName, "aim_pose");
+    strcpy(action_create_info.localizedActionName, "Aim Pose");
+    action_create_info.countSubactionPaths =
+        uint32_t(hand_subaction_path_.size());
+    action_create_info.subactionPaths = hand_subaction_path_.data();
     IF_XR_FAILED (err,
-        xrStringToPath(context_->instance(), "/user/hand/right/output/haptic",
-            &haptic_path[(int)Hand::kRight])) {
+        xrCreateAction(action_set_, &action_create_info, &aim_action_)) {
       LOG_ERROR("%s", err.c_str());
       return false;
     }
@@ -118,29 +142,45 @@ OpenXRActionSource::Init()
 
   // Bind actions
   {
-    XrPath oculus_interaction_path;
-    IF_XR_FAILED (err, xrStringToPath(context_->instance(),
-                           "/interaction_profiles/oculus/touch_controller",
-                           &oculus_interaction_path)) {
-      LOG_ERROR("%s", err.c_str());
-      return false;
+    const std::array<XrAction, (size_t)BindingAction::kCount> actions{
+        grab_action_,
+        vibrate_action_,
+        aim_action_,
+    };
+
+    uint32_t suggested_profile_count = 0;
+    std::vector<XrActionSuggestedBinding> suggested_bindings;
+    for (auto &profile : bindings::kInteractionProfiles) {
+      if (!is_profile_available(profile)) continue;
+
+      suggested_bindings.clear();
+      for (size_t i = 0; i < profile.binding_count; i++) {
+        auto &binding = profile.bindings[i];
+        suggested_bindings.push_back({
+            actions[(int)binding.action],
+            path_cache.Get(binding.path),
+        });
+      }
+
+      XrInteractionProfileSuggestedBinding profile_suggested_bindings{
+          XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING};
+      profile_suggested_bindings.interactionProfile =
+          path_cache.Get(profile.profile);
+      profile_suggested_bindings.countSuggestedBindings =
+          (uint32_t)suggested_bindings.size();
+      profile_suggested_bindings.suggestedBindings = suggested_bindings.data();
+      IF_XR_FAILED (err,
+          xrSuggestInteractionProfileBindings(
+              context_->instance(), &profile_suggested_bindings)) {
+        LOG_WARN("%s: %s", profile.profile, err.c_str());
+        continue;
+      }
+
+      suggested_profile_count++;
     }
 
-    std::vector<XrActionSuggestedBinding> bindings{{
-        {grab_action_, squeeze_value_path[(int)Hand::kLeft]},
-        {grab_action_, squeeze_value_path[(int)Hand::kRight]},
-        {vibrate_action_, haptic_path[(int)Hand::kLeft]},
-        {vibrate_action_, haptic_path[(int)Hand::kRight]},
-    }};
-
-    XrInteractionProfileSuggestedBinding suggested_bindings{
-        XR_TYPE_INTERACTION_PROFILE_SUGGESTED_BINDING};
-    suggested_bindings.interactionProfile = oculus_interaction_path;
-    suggested_bindings.countSuggestedBindings = (uint32_t)bindings.size();
-    suggested_bindings.suggestedBindings = bindings.data();
-    IF_XR_FAILED (err, xrSuggestInteractionProfileBindings(
-                           context_->instance(), &suggested_bindings)) {
-      LOG_ERROR("%s", err.c_str());
+    if (suggested_profile_count == 0) {
+      LOG_ERROR("No interaction profile accepted");
       return false;
     }
   }
@@ -158,6 +198,35 @@ OpenXRActionSource::Init()
     }
   }
 
+  if (!InitializeAimSpaces()) return false;
+
+  haptics_ = std::make_unique<HapticScheduler>(
+      context_->session(), vibrate_action_,
+      std::array<XrPath, (size_t)HapticScheduler::Hand::kCount>{
+          hand_subaction_path_[(int)Hand::kLeft],
+          hand_subaction_path_[(int)Hand::kRight]});
+
+  return true;
+}
+
+bool
+OpenXRActionSource::InitializeAimSpaces()
+{
+  for (auto hand : {Hand::kLeft, Hand::kRight}) {
+    XrActionSpaceCreateInfo action_space_create_info{
+        XR_TYPE_ACTION_SPACE_CREATE_INFO};
+    action_space_create_info.action = aim_action_;
+    action_space_create_info.subactionPath = hand_subaction_path_[(int)hand];
+    action_space_create_info.poseInActionSpace = Math::ToXrPosef(
+        glm::vec3(0), glm::quat_identity<float, glm::packed_highp>());
+    IF_XR_FAILED (err,
+        xrCreateActionSpace(context_->session(), &action_space_create_info,
+            &aim_spaces_[(int)hand])) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+  }
+
   return true;
 }
 
@@ -176,7 +245,6 @@ OpenXRActionSource::Process()
     return;
   }
 
-  // When you hold a controller, that controller vibrates.
   for (auto hand : {Hand::kLeft, Hand::kRight}) {
     XrActionStateGetInfo get_info{XR_TYPE_ACTION_STATE_GET_INFO};
     get_info.action = grab_action_;
@@ -189,22 +257,79 @@ OpenXRActionSource::Process()
       continue;
     }
 
-    if (grab_value.isActive == XR_TRUE && grab_value.currentState > 0.9f) {
-      XrHapticVibration vibration{XR_TYPE_HAPTIC_VIBRATION};
-      vibration.amplitude = 0.5;
-      vibration.duration = XR_MIN_HAPTIC_DURATION;
-      vibration.frequency = XR_FREQUENCY_UNSPECIFIED;
+    UpdateGrab(hand, grab_value);
+  }
+
+  haptics_->Update();
+}
+
+void
+OpenXRActionSource::UpdateGrab(Hand hand, const XrActionStateFloat &grab_value)
+{
+  auto haptics_hand = static_cast<HapticScheduler::Hand>(hand);
+  auto &grab_edges = grab_edges_[(int)hand];
+
+  switch (grab_edges.Update(
+      grab_value.isActive == XR_TRUE, grab_value.currentState)) {
+    case GrabEdges::Edge::kPress:
+      haptics_->Play(haptics_hand, kGrabPressPattern);
+      break;
+
+    case GrabEdges::Edge::kRelease:
+      haptics_->Play(haptics_hand, kGrabReleasePattern);
 
-      XrHapticActionInfo haptic_action_info{XR_TYPE_HAPTIC_ACTION_INFO};
-      haptic_action_info.action = vibrate_action_;
-      haptic_action_info.subactionPath = hand_subaction_path_[(int)hand];
+      LOG_DEBUG("Haptic runtime calls: %" PRIu64 " (%" PRIu64
+                " if applied every frame while grabbing)",
+          haptics_->runtime_calls(), grabbing_updates_);
+      break;
+
+    case GrabEdges::Edge::kNone:
+      break;
+  }
+
+  if (grab_edges.is_grabbing()) grabbing_updates_++;
+}
+
+void
+OpenXRActionSource::OnFrame(const XrFrameState &frame_state)
+{
+  if (context_->is_session_running() == false) return;
+
+  auto ray_picker = ray_picker_.lock();
+  if (!ray_picker) return;
+
+  for (auto hand : {Hand::kLeft, Hand::kRight}) {
+    auto picker_hand = static_cast<RayPicker::Hand>(hand);
+
+    XrActionStateGetInfo get_info{XR_TYPE_ACTION_STATE_GET_INFO};
+    get_info.action = aim_action_;
+    get_info.subactionPath = hand_subaction_path_[(int)hand];
+
+    XrActionStatePose pose_state{XR_TYPE_ACTION_STATE_POSE};
+    IF_XR_FAILED (err,
+        xrGetActionStatePose(context_->session(), &get_info, &pose_state)) {
+      LOG_WARN("%s", err.c_str());
+      ray_picker->Clear(picker_hand);
+      continue;
+    }
+
+    XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+    if (pose_state.isActive == XR_TRUE) {
       IF_XR_FAILED (err,
-          xrApplyHapticFeedback(context_->session(), &haptic_action_info,
-              (XrHapticBaseHeader*)&vibration)) {
+          xrLocateSpace(aim_spaces_[(int)hand], context_->app_space(),
+              frame_state.predictedDisplayTime, &location)) {
         LOG_WARN("%s", err.c_str());
-        continue;
       }
     }
+
+    constexpr XrSpaceLocationFlags kValidBits =
+        XR_SPACE_LOCATION_POSITION_VALID_BIT |
+        XR_SPACE_LOCATION_ORIENTATION_VALID_BIT;
+    if ((location.locationFlags & kValidBits) == kValidBits) {
+      ray_picker->Pick(picker_hand, location.pose);
+    } else {
+      ray_picker->Clear(picker_hand);
+    }
   }
 }
 
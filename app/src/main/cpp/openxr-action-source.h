@@ -1,11 +1,15 @@
 #pragma once
 
+#include "haptic-scheduler.h"
 #include "loop.h"
 #include "openxr-context.h"
+#include "openxr-view-source.h"
+#include "ray-picker.h"
 
 namespace zen::mirror {
 
-class OpenXRActionSource : public Loop::ISource {
+class OpenXRActionSource : public Loop::ISource,
+                           public OpenXRViewSource::IFrameListener {
  public:
   DISABLE_MOVE_AND_COPY(OpenXRActionSource);
   OpenXRActionSource(
@@ -18,15 +22,49 @@ class OpenXRActionSource : public Loop::ISource {
   bool Init();
   void Process() override;
 
+  /* Pick with the aim poses at the predicted display time */
+  void OnFrame(const XrFrameState &frame_state) override;
+
+  inline void set_ray_picker(std::weak_ptr<RayPicker> ray_picker);
+
+  /* Available after Init succeeds */
+  inline HapticScheduler *haptics();
+
  private:
   enum class Hand { kLeft = 0, kRight = 1, kCount = 2 };
+  /* Create an aim action space for each hand */
+  bool InitializeAimSpaces();
+
+  /* Vibrate on the edges of grabbing */
+  void UpdateGrab(Hand hand, const XrActionStateFloat &grab_value);
 
   std::shared_ptr<OpenXRContext> context_;
   std::shared_ptr<Loop> loop_;
   XrActionSet action_set_{XR_NULL_HANDLE};
   XrAction grab_action_{XR_NULL_HANDLE};
   XrAction vibrate_action_{XR_NULL_HANDLE};
+  XrAction aim_action_{XR_NULL_HANDLE};
   std::array<XrPath, (size_t)Hand::kCount> hand_subaction_path_;
+  std::array<XrSpace, (size_t)Hand::kCount> aim_spaces_{};
+  std::weak_ptr<RayPicker> ray_picker_;
+  std::unique_ptr<HapticScheduler> haptics_;
+  std::array<GrabEdges, (size_t)Hand::kCount> grab_edges_;
+
+  // The number of runtime calls the haptics would take if vibrated every
+  // frame while grabbing, to compare with HapticScheduler::runtime_calls()
+  uint64_t grabbing_updates_{0};
 };
 
+inline void
+OpenXRActionSource::set_ray_picker(std::weak_ptr<RayPicker> ray_picker)
+{
+  ray_picker_ = std::move(ray_picker);
+}
+
+inline HapticScheduler *
+OpenXRActionSource::haptics()
+{
+  return haptics_.get();
+}
+
 }  // namespace zen::mirror
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+enum class BindingAction { kGrab = 0, kVibrate, kAimPose, kCount };
+
+struct SuggestedBinding {
+  BindingAction action;
+  const char *path;
+};
+
+struct InteractionProfileBindings {
+  const char *profile;
+  const char *required_extension;  // nullptr for the core profiles
+  const SuggestedBinding *bindings;
+  size_t binding_count;
+};
+
+namespace bindings {
+
+#define BOTH_HANDS(action, component)                     \
+  SuggestedBinding{action, "/user/hand/left/" component}, \
+      SuggestedBinding{action, "/user/hand/right/" component}
+
+constexpr const char *kHandSubactionPaths[] = {
+    "/user/hand/left",
+    "/user/hand/right",
+};
+
+constexpr SuggestedBinding kOculusTouch[] = {
+    BOTH_HANDS(BindingAction::kGrab, "input/squeeze/value"),
+    BOTH_HANDS(BindingAction::kVibrate, "output/haptic"),
+    BOTH_HANDS(BindingAction::kAimPose, "input/aim/pose"),
+};
+
+constexpr SuggestedBinding kValveIndex[] = {
+    BOTH_HANDS(BindingAction::kGrab, "input/squeeze/value"),
+    BOTH_HANDS(BindingAction::kVibrate, "output/haptic"),
+    BOTH_HANDS(BindingAction::kAimPose, "input/aim/pose"),
+};
+
+constexpr SuggestedBinding kPico4[] = {
+    BOTH_HANDS(BindingAction::kGrab, "input/squeeze/value"),
+    BOTH_HANDS(BindingAction::kVibrate, "output/haptic"),
+    BOTH_HANDS(BindingAction::kAimPose, "input/aim/pose"),
+};
+
+constexpr SuggestedBinding kKhronosSimple[] = {
+    BOTH_HANDS(BindingAction::kGrab, "input/select/click"),
+    BOTH_HANDS(BindingAction::kVibrate, "output/haptic"),
+    BOTH_HANDS(BindingAction::kAimPose, "input/aim/pose"),
+};
+
+constexpr SuggestedBinding kHandInteraction[] = {
+    BOTH_HANDS(BindingAction::kGrab, "input/squeeze/value"),
+    BOTH_HANDS(BindingAction::kAimPose, "input/aim/pose"),
+};
+
+#undef BOTH_HANDS
+
+constexpr const char *kPicoControllerExtensionName =
+    "XR_BD_controller_interaction";
+
+constexpr InteractionProfileBindings kInteractionProfiles[] = {
+    {"/interaction_profiles/oculus/touch_controller", nullptr, kOculusTouch,
+        std::size(kOculusTouch)},
+    {"/interaction_profiles/valve/index_controller", nullptr, kValveIndex,
+        std::size(kValveIndex)},
+    {"/interaction_profiles/bytedance/pico4_controller",
+        kPicoControllerExtensionName, kPico4, std::size(kPico4)},
+    {"/interaction_profiles/khr/simple_controller", nullptr, kKhronosSimple,
+        std::size(kKhronosSimple)},
+    {"/interaction_profiles/microsoft/hand_interaction",
+        XR_MSFT_HAND_INTERACTION_EXTENSION_NAME, kHandInteraction,
+        std::size(kHandInteraction)},
+};
+
+}  // namespace bindings
+
+}  // namespace zen::mirror
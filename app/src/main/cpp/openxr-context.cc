@@ -3,11 +3,27 @@
 #include "common.h"
 #include "config.h"
 #include "logger.h"
+#include "openxr-bindings.h"
 #include "openxr-context.h"
 #include "openxr-util.h"
 
 namespace zen::mirror {
 
+namespace {
+
+/* Extensions enabled only when the runtime supports them */
+constexpr const char *kOptionalExtensions[] = {
+    XR_FB_DISPLAY_REFRESH_RATE_EXTENSION_NAME,
+    XR_FB_SPACE_WARP_EXTENSION_NAME,
+    XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME,
+    XR_EXT_HAND_TRACKING_EXTENSION_NAME,
+    XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME,
+    XR_MSFT_HAND_INTERACTION_EXTENSION_NAME,
+    bindings::kPicoControllerExtensionName,
+};
+
+}  // namespace
+
 OpenXRContext::~OpenXRContext()
 {
   if (app_space_ != XR_NULL_HANDLE) {
@@ -42,8 +58,23 @@ OpenXRContext::Init(struct android_app *app)
 
   if (!InitializeGraphicsLibrary()) return false;
 
+  gpu_memory_budget_ = std::make_unique<GpuMemoryBudget>(
+      config::GPU_MEMORY_BUDGET_MB * 1024 * 1024);
+
   if (!InitializeSession()) return false;
 
+  InitializeTimeConversion();
+
+  InitializeDisplayRefreshRate();
+
+  InitializePerformanceGovernor();
+
+  InitializeUploadThread();
+
+  InitializeWorkers();
+
+  InitializeProgramBinaryCache(app);
+
   LogReferenceSpaces();
 
   return true;
@@ -52,43 +83,25 @@ OpenXRContext::Init(struct android_app *app)
 void
 OpenXRContext::UpdateSessionState(XrSessionState state, XrTime time)
 {
-  XrSessionState old_state = session_state_;
-  session_state_ = state;
-  LOG_INFO("XrEventDataSessionStateChanged: state %s -> %s time=%" PRId64,
-      to_string(old_state), to_string(session_state_), time);
-
-  switch (session_state_) {
-    case XR_SESSION_STATE_READY: {
-      XrSessionBeginInfo session_begin_info{XR_TYPE_SESSION_BEGIN_INFO};
-      session_begin_info.primaryViewConfigurationType =
-          view_configuration_type_;
-      IF_XR_FAILED (err, xrBeginSession(session_, &session_begin_info)) {
-        LOG_ERROR("%s", err.c_str());
-        loop_->Terminate();
-      }
-      is_session_running_ = true;
-      remote_->EnableSession();
-      break;
-    }
+  session_state_->Update(state, time);
+}
 
-    case XR_SESSION_STATE_STOPPING: {
-      IF_XR_FAILED (err, xrEndSession(session_)) {
-        LOG_ERROR("%s", err.c_str());
-        loop_->Terminate();
-      }
-      is_session_running_ = false;
-      remote_->DisableSession();
-      break;
-    }
+void
+OpenXRContext::EnableRemoteSession()
+{
+  remote_->EnableSession();
+}
 
-    case XR_SESSION_STATE_EXITING:  // fall through
-    case XR_SESSION_STATE_LOSS_PENDING:
-      loop_->Terminate();
-      break;
+void
+OpenXRContext::DisableRemoteSession()
+{
+  remote_->DisableSession();
+}
 
-    default:
-      break;
-  }
+void
+OpenXRContext::Terminate()
+{
+  loop_->Terminate();
 }
 
 bool
@@ -125,6 +138,38 @@ OpenXRContext::InitializeInstance(struct android_app *app)
   extensions.push_back(XR_KHR_ANDROID_CREATE_INSTANCE_EXTENSION_NAME);
   extensions.push_back(XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME);
 
+  {
+    uint32_t count;
+    IF_XR_FAILED (err,
+        xrEnumerateInstanceExtensionProperties(nullptr, 0, &count, nullptr)) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+
+    std::vector<XrExtensionProperties> available_extensions(
+        count, {XR_TYPE_EXTENSION_PROPERTIES});
+
+    IF_XR_FAILED (err, xrEnumerateInstanceExtensionProperties(nullptr, count,
+                           &count, available_extensions.data())) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+
+    for (auto name : kOptionalExtensions) {
+      bool available = std::any_of(available_extensions.begin(),
+          available_extensions.end(),
+          [name](const XrExtensionProperties &extension) {
+            return strcmp(extension.extensionName, name) == 0;
+          });
+
+      if (available) {
+        extensions.push_back(name);
+      } else {
+        LOG_INFO("Optional extension %s is not available", name);
+      }
+    }
+  }
+
   XrInstanceCreateInfo create_info{XR_TYPE_INSTANCE_CREATE_INFO};
 
   XrInstanceCreateInfoAndroidKHR create_info_android{
@@ -144,9 +189,18 @@ OpenXRContext::InitializeInstance(struct android_app *app)
     return false;
   }
 
+  enabled_extensions_.assign(extensions.begin(), extensions.end());
+
   return true;
 }
 
+bool
+OpenXRContext::IsExtensionEnabled(const char *name) const
+{
+  return std::find(enabled_extensions_.begin(), enabled_extensions_.end(),
+             name) != enabled_extensions_.end();
+}
+
 bool
 OpenXRContext::InitializeSystem()
 {
@@ -271,9 +325,105 @@ OpenXRContext::InitializeSession()
     return false;
   }
 
+  session_state_ = std::make_unique<OpenXRSessionState>(
+      session_, view_configuration_type_, this);
+
   return true;
 }
 
+int64_t
+OpenXRContext::ToMonotonicTime(XrTime time)
+{
+  if (xrConvertTimeToTimespecTimeKHR_ == nullptr) return time;
+
+  timespec monotonic_time;
+  IF_XR_FAILED (err,
+      xrConvertTimeToTimespecTimeKHR_(instance_, time, &monotonic_time)) {
+    LOG_ERROR("%s", err.c_str());
+    return time;
+  }
+
+  return (int64_t)monotonic_time.tv_sec * 1000000000 + monotonic_time.tv_nsec;
+}
+
+void
+OpenXRContext::InitializeTimeConversion()
+{
+  if (!IsExtensionEnabled(XR_KHR_CONVERT_TIMESPEC_TIME_EXTENSION_NAME)) {
+    LOG_INFO("XrTime is taken as CLOCK_MONOTONIC in nanoseconds");
+    return;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(instance_, "xrConvertTimeToTimespecTimeKHR",
+          reinterpret_cast<PFN_xrVoidFunction *>(
+              &xrConvertTimeToTimespecTimeKHR_))) {
+    LOG_WARN("%s", err.c_str());
+    xrConvertTimeToTimespecTimeKHR_ = nullptr;
+  }
+}
+
+void
+OpenXRContext::InitializeDisplayRefreshRate()
+{
+  CHECK(session_ != XR_NULL_HANDLE);
+
+  if (!IsExtensionEnabled(XR_FB_DISPLAY_REFRESH_RATE_EXTENSION_NAME)) return;
+
+  display_refresh_rate_ = std::make_unique<OpenXRDisplayRefreshRate>(
+      instance_, session_);
+  if (!display_refresh_rate_->Init()) {
+    LOG_WARN("Failed to initialize display refresh rate control");
+    display_refresh_rate_.reset();
+  }
+}
+
+void
+OpenXRContext::InitializePerformanceGovernor()
+{
+  CHECK(session_ != XR_NULL_HANDLE);
+
+  if (!IsExtensionEnabled(XR_EXT_PERFORMANCE_SETTINGS_EXTENSION_NAME)) return;
+
+  performance_governor_ = std::make_unique<OpenXRPerformanceGovernor>(
+      instance_, session_);
+  if (!performance_governor_->Init()) {
+    LOG_WARN("Failed to initialize performance governor");
+    performance_governor_.reset();
+  }
+}
+
+void
+OpenXRContext::InitializeUploadThread()
+{
+  CHECK(egl_);
+
+  upload_thread_ = std::make_unique<GlUploadThread>(egl_.get());
+  if (!upload_thread_->Init()) {
+    LOG_WARN("Failed to start GL upload thread; uploads stay on the render "
+             "thread");
+    upload_thread_.reset();
+  }
+}
+
+void
+OpenXRContext::InitializeWorkers()
+{
+  worker_pool_ = std::make_unique<WorkerPool>(kWorkerThreadCount);
+}
+
+void
+OpenXRContext::InitializeProgramBinaryCache(struct android_app *app)
+{
+  program_binary_cache_ = std::make_shared<ProgramBinaryCache>(
+      std::string(app->activity->internalDataPath) + "/program-binaries",
+      config::PROGRAM_BINARY_CACHE_SIZE_MB * 1024 * 1024, worker_pool_.get(),
+      upload_thread_.get());
+  if (!program_binary_cache_->Init()) {
+    LOG_WARN("Program binaries are not kept across runs");
+  }
+}
+
 bool
 OpenXRContext::InitializeAppSpace(XrTime time)
 {
@@ -2,11 +2,18 @@
 
 #include "common.h"
 #include "egl-instance.h"
+#include "gpu-memory-budget.h"
+#include "gl-upload-thread.h"
 #include "loop.h"
+#include "openxr-display-refresh-rate.h"
+#include "openxr-performance-governor.h"
+#include "openxr-session-state.h"
+#include "program-binary-cache.h"
+#include "worker-pool.h"
 
 namespace zen::mirror {
 
-class OpenXRContext {
+class OpenXRContext : public OpenXRSessionState::IDelegate {
  public:
   DISABLE_MOVE_AND_COPY(OpenXRContext);
   OpenXRContext(std::shared_ptr<Loop> loop,
@@ -14,7 +21,7 @@ class OpenXRContext {
       : loop_(std::move(loop)), remote_(std::move(remote))
   {
   }
-  ~OpenXRContext();
+  ~OpenXRContext() override;
 
   /* Initialize OpenXRContext */
   bool Init(struct android_app *app);
@@ -25,14 +32,51 @@ class OpenXRContext {
   /* Create a new app space and store it in the context */
   bool InitializeAppSpace(XrTime time);
 
+  void EnableRemoteSession() override;
+  void DisableRemoteSession() override;
+  void Terminate() override;
+
+  /* Check whether the instance extension is enabled */
+  bool IsExtensionEnabled(const char *name) const;
+
+  /**
+   * Convert to CLOCK_MONOTONIC in nanoseconds, the clock of ClockSync::Now,
+   * with XR_KHR_convert_timespec_time if available
+   */
+  int64_t ToMonotonicTime(XrTime time);
+
   inline XrInstance instance();
   inline XrSystemId system_id();
   inline XrSession session();
   inline XrSpace app_space();
   inline bool is_session_running();
+
+  /* Stays enabled while the session is stopped, until it exits */
+  inline bool is_remote_session_enabled();
+
+  /* When the session last began */
+  inline std::chrono::steady_clock::time_point session_begin_time();
   inline XrViewConfigurationType view_configuration_type();
   inline XrEnvironmentBlendMode environment_blend_mode();
 
+  /* Available after Init succeeds */
+  inline GpuMemoryBudget *gpu_memory_budget();
+
+  /* nullptr if XR_FB_display_refresh_rate is not available */
+  inline OpenXRDisplayRefreshRate *display_refresh_rate();
+
+  /* nullptr if XR_EXT_performance_settings is not available */
+  inline OpenXRPerformanceGovernor *performance_governor();
+
+  /* nullptr if a shared GL context is not available */
+  inline GlUploadThread *upload_thread();
+
+  /* For CPU work off the loop thread */
+  inline WorkerPool *worker_pool();
+
+  /* Available after Init succeeds */
+  inline std::shared_ptr<ProgramBinaryCache> program_binary_cache();
+
  private:
   /* Initialize the OpenXR loader */
   bool InitializeLoader(struct android_app *app);
@@ -49,6 +93,24 @@ class OpenXRContext {
   /* Create a new XrSession and store it in the context */
   bool InitializeSession();
 
+  /* Set up the display refresh rate control if the runtime supports it */
+  void InitializeDisplayRefreshRate();
+
+  /* Set up the performance governor if the runtime supports it */
+  void InitializePerformanceGovernor();
+
+  /* Load the XrTime conversion of XR_KHR_convert_timespec_time */
+  void InitializeTimeConversion();
+
+  /* Start the GL upload thread with a shared context */
+  void InitializeUploadThread();
+
+  /* Start the worker pool */
+  void InitializeWorkers();
+
+  /* Needs the workers */
+  void InitializeProgramBinaryCache(struct android_app *app);
+
   /* Write out available view configurations, determine the view config type
    * to use and store it in the context */
   bool InitializeViewConfig();
@@ -69,6 +131,9 @@ class OpenXRContext {
    **/
   void LogLayersAndExtensions() const;
 
+  // Leave the cores to the loop thread, the upload thread and the runtime
+  static constexpr size_t kWorkerThreadCount = 2;
+
   static constexpr XrViewConfigurationType kAcceptableViewConfigType =
       XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
   static constexpr XrEnvironmentBlendMode kAcceptableEnvironmentBlendModeType =
@@ -78,11 +143,18 @@ class OpenXRContext {
   XrSystemId system_id_{XR_NULL_SYSTEM_ID};
   XrSession session_{XR_NULL_HANDLE};
   XrSpace app_space_{XR_NULL_HANDLE};
-  bool is_session_running_{false};
-  XrSessionState session_state_{XR_SESSION_STATE_UNKNOWN};
   XrViewConfigurationType view_configuration_type_{};
   XrEnvironmentBlendMode environment_blend_mode_{};
+  std::vector<std::string> enabled_extensions_;
+  PFN_xrConvertTimeToTimespecTimeKHR xrConvertTimeToTimespecTimeKHR_{};
+  std::unique_ptr<OpenXRSessionState> session_state_;
+  std::unique_ptr<OpenXRDisplayRefreshRate> display_refresh_rate_;
+  std::unique_ptr<OpenXRPerformanceGovernor> performance_governor_;
   std::unique_ptr<EglInstance> egl_;
+  std::unique_ptr<GpuMemoryBudget> gpu_memory_budget_;
+  std::unique_ptr<GlUploadThread> upload_thread_;  // destroyed before egl_
+  std::unique_ptr<WorkerPool> worker_pool_;
+  std::shared_ptr<ProgramBinaryCache> program_binary_cache_;
   std::shared_ptr<Loop> loop_;
   std::shared_ptr<zen::remote::client::IRemote> remote_;
 };
@@ -114,7 +186,19 @@ OpenXRContext::app_space()
 inline bool
 OpenXRContext::is_session_running()
 {
-  return is_session_running_;
+  return session_state_->is_running();
+}
+
+inline bool
+OpenXRContext::is_remote_session_enabled()
+{
+  return session_state_->is_remote_session_enabled();
+}
+
+inline std::chrono::steady_clock::time_point
+OpenXRContext::session_begin_time()
+{
+  return session_state_->begin_time();
 }
 
 inline XrViewConfigurationType
@@ -129,4 +213,40 @@ OpenXRContext::environment_blend_mode()
   return environment_blend_mode_;
 }
 
+inline GpuMemoryBudget *
+OpenXRContext::gpu_memory_budget()
+{
+  return gpu_memory_budget_.get();
+}
+
+inline OpenXRDisplayRefreshRate *
+OpenXRContext::display_refresh_rate()
+{
+  return display_refresh_rate_.get();
+}
+
+inline OpenXRPerformanceGovernor *
+OpenXRContext::performance_governor()
+{
+  return performance_governor_.get();
+}
+
+inline GlUploadThread *
+OpenXRContext::upload_thread()
+{
+  return upload_thread_.get();
+}
+
+inline WorkerPool *
+OpenXRContext::worker_pool()
+{
+  return worker_pool_.get();
+}
+
+inline std::shared_ptr<ProgramBinaryCache>
+OpenXRContext::program_binary_cache()
+{
+  return program_binary_cache_;
+}
+
 }  // namespace zen::mirror
@@ -0,0 +1,186 @@
+#include "pch.h"
+
+#include "config.h"
+#include "logger.h"
+#include "openxr-display-refresh-rate.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+bool
+OpenXRDisplayRefreshRate::Init()
+{
+  IF_XR_FAILED (err, xrGetInstanceProcAddr(instance_,
+                         "xrEnumerateDisplayRefreshRatesFB",
+                         reinterpret_cast<PFN_xrVoidFunction *>(
+                             &xrEnumerateDisplayRefreshRatesFB_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(instance_, "xrGetDisplayRefreshRateFB",
+          reinterpret_cast<PFN_xrVoidFunction *>(
+              &xrGetDisplayRefreshRateFB_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(instance_, "xrRequestDisplayRefreshRateFB",
+          reinterpret_cast<PFN_xrVoidFunction *>(
+              &xrRequestDisplayRefreshRateFB_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  uint32_t rate_count;
+  IF_XR_FAILED (err,
+      xrEnumerateDisplayRefreshRatesFB_(session_, 0, &rate_count, nullptr)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  supported_rates_.resize(rate_count);
+
+  IF_XR_FAILED (err, xrEnumerateDisplayRefreshRatesFB_(session_, rate_count,
+                         &rate_count, supported_rates_.data())) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  if (supported_rates_.empty()) {
+    LOG_ERROR("No display refresh rate available");
+    return false;
+  }
+
+  std::sort(supported_rates_.begin(), supported_rates_.end());
+
+  IF_XR_FAILED (err, xrGetDisplayRefreshRateFB_(session_, &current_rate_)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  // Use the highest rate not exceeding the configured one, or the lowest rate
+  // if the configured rate is lower than any supported rate.
+  max_rate_ = supported_rates_.front();
+  for (auto rate : supported_rates_) {
+    if (rate <= config::DISPLAY_REFRESH_RATE) max_rate_ = rate;
+  }
+
+  std::stringstream rates_string_stream;
+  for (auto rate : supported_rates_) {
+    const bool selected = rate == max_rate_;
+
+    rates_string_stream << " ";
+    if (selected) rates_string_stream << "[";
+    rates_string_stream << rate;
+    if (selected) rates_string_stream << "]";
+  }
+
+  LOG_DEBUG("Display Refresh Rates: %s (current %.1f)",
+      rates_string_stream.str().c_str(), current_rate_);
+
+  if (current_rate_ != max_rate_) RequestRate(max_rate_);
+
+  return true;
+}
+
+void
+OpenXRDisplayRefreshRate::Update()
+{
+  if (!config::ADAPTIVE_DISPLAY_REFRESH_RATE) return;
+  if (is_request_pending_ &&
+      std::chrono::steady_clock::now() - request_time_ >= kRequestTimeout) {
+    ExpireRequest();
+  }
+  if (is_request_pending_ || !frame_stats_.is_settled()) return;
+
+  const size_t index = CurrentIndex();
+
+  if (frame_stats_.missed_frames() >= kStepDownMissedFrames) {
+    if (index == 0) return;
+
+    LOG_INFO("%u frames missed in the last %u frames, stepping down",
+        frame_stats_.missed_frames(), FrameStats::kWindowSize);
+    RequestRate(supported_rates_[index - 1]);
+    return;
+  }
+
+  if (index + 1 >= supported_rates_.size()) return;
+
+  const float higher_rate = supported_rates_[index + 1];
+  if (higher_rate > max_rate_) return;
+
+  const uint64_t sustained_frames =
+      static_cast<uint64_t>(current_rate_ * kStepUpSustainedSeconds);
+  if (frame_stats_.missed_frames() == 0 &&
+      frame_stats_.consecutive_good_frames() >= sustained_frames &&
+      frame_stats_.headroom() >= kStepUpHeadroom) {
+    LOG_INFO("%.0f%% of the frame time unused, stepping up",
+        frame_stats_.headroom() * 100.f);
+    RequestRate(higher_rate);
+  }
+}
+
+void
+OpenXRDisplayRefreshRate::HandleChangedEvent(
+    const XrEventDataDisplayRefreshRateChangedFB *event)
+{
+  LOG_INFO("XrEventDataDisplayRefreshRateChangedFB: %.1f -> %.1f",
+      event->fromDisplayRefreshRate, event->toDisplayRefreshRate);
+
+  current_rate_ = event->toDisplayRefreshRate;
+  is_request_pending_ = false;
+
+  // The frame history collected at the previous rate no longer tells anything
+  // about the new display period.
+  frame_stats_.Reset();
+}
+
+bool
+OpenXRDisplayRefreshRate::RequestRate(float rate)
+{
+  IF_XR_FAILED (err, xrRequestDisplayRefreshRateFB_(session_, rate)) {
+    LOG_WARN("%s", err.c_str());
+    return false;
+  }
+
+  LOG_DEBUG("Requested display refresh rate %.1f", rate);
+  is_request_pending_ = true;
+  request_time_ = std::chrono::steady_clock::now();
+
+  return true;
+}
+
+void
+OpenXRDisplayRefreshRate::ExpireRequest()
+{
+  is_request_pending_ = false;
+
+  float rate = current_rate_;
+  IF_XR_FAILED (err, xrGetDisplayRefreshRateFB_(session_, &rate)) {
+    LOG_WARN("%s", err.c_str());
+    return;
+  }
+
+  LOG_DEBUG("No display refresh rate changed event within %llds, now %.1f",
+      (long long)kRequestTimeout.count(), rate);
+
+  if (rate == current_rate_) return;
+  current_rate_ = rate;
+  frame_stats_.Reset();
+}
+
+size_t
+OpenXRDisplayRefreshRate::CurrentIndex() const
+{
+  size_t index = 0;
+  for (size_t i = 0; i < supported_rates_.size(); i++) {
+    if (supported_rates_[i] <= current_rate_) index = i;
+  }
+
+  return index;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "common.h"
+#include "frame-stats.h"
+
+namespace zen::mirror {
+
+/**
+ * Selects the display refresh rate with XR_FB_display_refresh_rate.
+ *
+ * The rate configured at build time is requested on startup. When adaptive
+ * refresh rate is enabled, the rate steps down while frames keep being missed
+ * and steps back up, never above the configured one, while the render loop
+ * has enough headroom.
+ */
+class OpenXRDisplayRefreshRate {
+ public:
+  DISABLE_MOVE_AND_COPY(OpenXRDisplayRefreshRate);
+  OpenXRDisplayRefreshRate(XrInstance instance, XrSession session)
+      : instance_(instance), session_(session)
+  {
+  }
+  ~OpenXRDisplayRefreshRate() = default;
+
+  /* Enumerate the supported rates and request the configured one */
+  bool Init();
+
+  /* Step the rate down or up depending on the frame stats; call every frame */
+  void Update();
+
+  void HandleChangedEvent(const XrEventDataDisplayRefreshRateChangedFB *event);
+
+  inline float current_rate();
+
+  /* Feed every frame to this; forgotten when the rate changes */
+  inline FrameStats *frame_stats();
+
+ private:
+  bool RequestRate(float rate);
+
+  /* Re-read the rate after a request the runtime did not answer */
+  void ExpireRequest();
+
+  /* Index of the current rate in supported_rates_ */
+  size_t CurrentIndex() const;
+
+  // Step down when this many frames are missed in FrameStats::kWindowSize
+  static constexpr uint32_t kStepDownMissedFrames = 5;
+  // Step up when at least this fraction of the display period is left unused
+  static constexpr float kStepUpHeadroom = 0.4f;
+  // ... for this many seconds in a row
+  static constexpr float kStepUpSustainedSeconds = 5.f;
+  // A request not followed by the changed event within this long is over
+  static constexpr std::chrono::seconds kRequestTimeout{2};
+
+  XrInstance instance_;
+  XrSession session_;
+  FrameStats frame_stats_;
+
+  PFN_xrEnumerateDisplayRefreshRatesFB xrEnumerateDisplayRefreshRatesFB_{};
+  PFN_xrGetDisplayRefreshRateFB xrGetDisplayRefreshRateFB_{};
+  PFN_xrRequestDisplayRefreshRateFB xrRequestDisplayRefreshRateFB_{};
+
+  std::vector<float> supported_rates_;  // sorted in ascending order
+  float max_rate_{0.f};                 // never step up beyond this rate
+  float current_rate_{0.f};
+  bool is_request_pending_{false};
+  std::chrono::steady_clock::time_point request_time_{};
+};
+
+inline float
+OpenXRDisplayRefreshRate::current_rate()
+{
+  return current_rate_;
+}
+
+inline FrameStats *
+OpenXRDisplayRefreshRate::frame_stats()
+{
+  return &frame_stats_;
+}
+
+}  // namespace zen::mirror
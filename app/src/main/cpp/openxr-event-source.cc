@@ -28,6 +28,18 @@ OpenXREventSource::Process()
         break;
       }
 
+      case XR_TYPE_EVENT_DATA_DISPLAY_REFRESH_RATE_CHANGED_FB: {
+        HandleDisplayRefreshRateChangedEvent(
+            reinterpret_cast<XrEventDataDisplayRefreshRateChangedFB*>(&event));
+        break;
+      }
+
+      case XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT: {
+        HandlePerfSettingsEvent(
+            reinterpret_cast<XrEventDataPerfSettingsEXT*>(&event));
+        break;
+      }
+
       default:
         LOG_DEBUG("Ignoring event type %d", event.type);
         break;
@@ -65,4 +77,21 @@ OpenXREventSource::HandleSessionStateChangedEvent(
   context_->UpdateSessionState(event->state, event->time);
 }
 
+void
+OpenXREventSource::HandleDisplayRefreshRateChangedEvent(
+    XrEventDataDisplayRefreshRateChangedFB* event)
+{
+  if (auto display_refresh_rate = context_->display_refresh_rate()) {
+    display_refresh_rate->HandleChangedEvent(event);
+  }
+}
+
+void
+OpenXREventSource::HandlePerfSettingsEvent(XrEventDataPerfSettingsEXT* event)
+{
+  if (auto performance_governor = context_->performance_governor()) {
+    performance_governor->HandlePerfSettingsEvent(event);
+  }
+}
+
 }  // namespace zen::mirror
@@ -25,6 +25,11 @@ class OpenXREventSource : public Loop::ISource {
 
   void HandleSessionStateChangedEvent(XrEventDataSessionStateChanged* event);
 
+  void HandleDisplayRefreshRateChangedEvent(
+      XrEventDataDisplayRefreshRateChangedFB* event);
+
+  void HandlePerfSettingsEvent(XrEventDataPerfSettingsEXT* event);
+
   std::shared_ptr<OpenXRContext> context_;
   std::shared_ptr<Loop> loop_;
 };
@@ -0,0 +1,144 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-hand-tracking-source.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+OpenXRHandTrackingSource::~OpenXRHandTrackingSource()
+{
+  for (auto hand_tracker : hand_trackers_) {
+    if (hand_tracker != XR_NULL_HANDLE) xrDestroyHandTrackerEXT_(hand_tracker);
+  }
+}
+
+bool
+OpenXRHandTrackingSource::Init()
+{
+  if (!context_->IsExtensionEnabled(XR_EXT_HAND_TRACKING_EXTENSION_NAME)) {
+    return false;
+  }
+
+  XrSystemHandTrackingPropertiesEXT hand_tracking_properties{
+      XR_TYPE_SYSTEM_HAND_TRACKING_PROPERTIES_EXT};
+  XrSystemProperties system_properties{XR_TYPE_SYSTEM_PROPERTIES};
+  system_properties.next = &hand_tracking_properties;
+  IF_XR_FAILED (err, xrGetSystemProperties(context_->instance(),
+                         context_->system_id(), &system_properties)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  if (hand_tracking_properties.supportsHandTracking == XR_FALSE) {
+    LOG_INFO("The system does not support hand tracking");
+    return false;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(context_->instance(), "xrCreateHandTrackerEXT",
+          reinterpret_cast<PFN_xrVoidFunction *>(&xrCreateHandTrackerEXT_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(context_->instance(), "xrDestroyHandTrackerEXT",
+          reinterpret_cast<PFN_xrVoidFunction *>(&xrDestroyHandTrackerEXT_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  IF_XR_FAILED (err,
+      xrGetInstanceProcAddr(context_->instance(), "xrLocateHandJointsEXT",
+          reinterpret_cast<PFN_xrVoidFunction *>(&xrLocateHandJointsEXT_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  for (auto hand : {Hand::kLeft, Hand::kRight}) {
+    XrHandTrackerCreateInfoEXT create_info{
+        XR_TYPE_HAND_TRACKER_CREATE_INFO_EXT};
+    create_info.hand =
+        hand == Hand::kLeft ? XR_HAND_LEFT_EXT : XR_HAND_RIGHT_EXT;
+    create_info.handJointSet = XR_HAND_JOINT_SET_DEFAULT_EXT;
+    IF_XR_FAILED (err, xrCreateHandTrackerEXT_(context_->session(),
+                           &create_info, &hand_trackers_[(int)hand])) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+  }
+
+  encoded_.reserve(hand_joints_codec::kEncodedSize * (size_t)Hand::kCount);
+
+  return true;
+}
+
+void
+OpenXRHandTrackingSource::OnFrame(const XrFrameState &frame_state)
+{
+  if (context_->is_session_running() == false) return;
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  encoded_.clear();
+  for (auto hand : {Hand::kLeft, Hand::kRight}) {
+    if (!LocateHandJoints(hand, frame_state.predictedDisplayTime)) continue;
+
+    hand_joints_codec::Encode((uint8_t)hand, joints_[(int)hand], &encoded_);
+  }
+
+  if (encoded_.empty()) return;
+
+  if (auto sink = sink_.lock()) {
+    sink->SendHandJoints(encoded_.data(), encoded_.size());
+  }
+
+  processing_time_ += std::chrono::steady_clock::now() - begin;
+  encoded_bytes_ += encoded_.size();
+  if (++frames_ % kStatsPeriodFrames == 0) LogStats();
+}
+
+bool
+OpenXRHandTrackingSource::LocateHandJoints(Hand hand, XrTime time)
+{
+  XrHandJointsLocateInfoEXT locate_info{XR_TYPE_HAND_JOINTS_LOCATE_INFO_EXT};
+  locate_info.baseSpace = context_->app_space();
+  locate_info.time = time;
+
+  XrHandJointLocationsEXT locations{XR_TYPE_HAND_JOINT_LOCATIONS_EXT};
+  locations.jointCount = (uint32_t)locations_.size();
+  locations.jointLocations = locations_.data();
+
+  IF_XR_FAILED (err, xrLocateHandJointsEXT_(
+                         hand_trackers_[(int)hand], &locate_info, &locations)) {
+    LOG_WARN("%s", err.c_str());
+    return false;
+  }
+
+  if (locations.isActive == XR_FALSE) return false;
+
+  ScatterHandJointLocations(locations_.data(), time, &joints_[(int)hand]);
+
+  return true;
+}
+
+void
+OpenXRHandTrackingSource::LogStats()
+{
+  constexpr size_t kRawSize = sizeof(XrTime) + sizeof(uint32_t) * 2 +
+                              (sizeof(XrVector3f) + sizeof(XrQuaternionf) +
+                                  sizeof(float)) *
+                                  kHandJointCount;
+
+  const auto processing_time =
+      std::chrono::duration_cast<std::chrono::microseconds>(processing_time_);
+
+  LOG_DEBUG(
+      "Hand joints: %.1f us/frame to locate and encode, %.1f bytes/frame on "
+      "the wire (%zu bytes/hand unencoded)",
+      (float)processing_time.count() / frames_,
+      (float)encoded_bytes_ / frames_, kRawSize);
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "hand-joints.h"
+#include "loop.h"
+#include "openxr-context.h"
+#include "openxr-view-source.h"
+
+namespace zen::mirror {
+
+/**
+ * Locates all the hand joints at the predicted display time of each frame
+ * with XR_EXT_hand_tracking and hands them to the sink quantized.
+ */
+class OpenXRHandTrackingSource : public OpenXRViewSource::IFrameListener {
+ public:
+  DISABLE_MOVE_AND_COPY(OpenXRHandTrackingSource);
+  OpenXRHandTrackingSource(
+      std::shared_ptr<OpenXRContext> context, std::shared_ptr<Loop> loop)
+      : context_(std::move(context)), loop_(std::move(loop))
+  {
+  }
+  ~OpenXRHandTrackingSource();
+
+  /**
+   * @returns false if hand tracking is not available
+   */
+  bool Init();
+
+  void OnFrame(const XrFrameState &frame_state) override;
+
+  inline void set_sink(std::weak_ptr<IHandJointsSink> sink);
+
+ private:
+  enum class Hand { kLeft = 0, kRight = 1, kCount = 2 };
+
+  /**
+   * @returns false if the hand is not tracked
+   */
+  bool LocateHandJoints(Hand hand, XrTime time);
+
+  void LogStats();
+
+  // Write out the cost per frame every this many frames
+  static constexpr uint64_t kStatsPeriodFrames = 1000;
+
+  std::shared_ptr<OpenXRContext> context_;
+  std::shared_ptr<Loop> loop_;
+  std::weak_ptr<IHandJointsSink> sink_;
+
+  PFN_xrCreateHandTrackerEXT xrCreateHandTrackerEXT_{};
+  PFN_xrDestroyHandTrackerEXT xrDestroyHandTrackerEXT_{};
+  PFN_xrLocateHandJointsEXT xrLocateHandJointsEXT_{};
+
+  std::array<XrHandTrackerEXT, (size_t)Hand::kCount> hand_trackers_{};
+  std::array<HandJoints, (size_t)Hand::kCount> joints_;
+  std::array<XrHandJointLocationEXT, kHandJointCount> locations_;
+  std::vector<uint8_t> encoded_;  // reused every frame
+
+  uint64_t frames_{0};
+  uint64_t encoded_bytes_{0};
+  std::chrono::nanoseconds processing_time_{0};
+};
+
+inline void
+OpenXRHandTrackingSource::set_sink(std::weak_ptr<IHandJointsSink> sink)
+{
+  sink_ = std::move(sink);
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,43 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-path-cache.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+void
+OpenXRPathCache::Add(const char *path)
+{
+  paths_.try_emplace(path, XR_NULL_PATH);
+  reference_count_++;
+}
+
+bool
+OpenXRPathCache::Resolve()
+{
+  for (auto &[path_string, path] : paths_) {
+    if (path != XR_NULL_PATH) continue;
+
+    // std::string_view of a string literal is null-terminated
+    IF_XR_FAILED (err, xrStringToPath(instance_, path_string.data(), &path)) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+
+    resolved_count_++;
+  }
+
+  return true;
+}
+
+XrPath
+OpenXRPathCache::Get(const char *path) const
+{
+  auto it = paths_.find(path);
+  if (it == paths_.end()) return XR_NULL_PATH;
+
+  return it->second;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Resolves XrPaths for path strings once and keeps them. The strings must
+ * outlive the cache; string literals are intended.
+ */
+class OpenXRPathCache {
+ public:
+  DISABLE_MOVE_AND_COPY(OpenXRPathCache);
+  OpenXRPathCache(XrInstance instance) : instance_(instance) {}
+  ~OpenXRPathCache() = default;
+
+  /* Add a path string to be resolved by the next Resolve call */
+  void Add(const char *path);
+
+  /* Resolve all the added paths not resolved yet */
+  bool Resolve();
+
+  /* XR_NULL_PATH if not resolved */
+  XrPath Get(const char *path) const;
+
+  /* The number of Add calls including duplicated paths */
+  inline size_t reference_count();
+
+  /* The number of xrStringToPath calls */
+  inline size_t resolved_count();
+
+ private:
+  XrInstance instance_;
+  std::unordered_map<std::string_view, XrPath> paths_;
+  size_t reference_count_{0};
+  size_t resolved_count_{0};
+};
+
+inline size_t
+OpenXRPathCache::reference_count()
+{
+  return reference_count_;
+}
+
+inline size_t
+OpenXRPathCache::resolved_count()
+{
+  return resolved_count_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,191 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-performance-governor.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+bool
+OpenXRPerformanceGovernor::Init()
+{
+  IF_XR_FAILED (err, xrGetInstanceProcAddr(instance_,
+                         "xrPerfSettingsSetPerformanceLevelEXT",
+                         reinterpret_cast<PFN_xrVoidFunction *>(
+                             &xrPerfSettingsSetPerformanceLevelEXT_))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  for (auto &domain : domains_) {
+    IF_XR_FAILED (err, xrPerfSettingsSetPerformanceLevelEXT_(
+                           session_, domain.domain, domain.level)) {
+      LOG_ERROR("%s", err.c_str());
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+OpenXRPerformanceGovernor::Update(XrTime time)
+{
+  time_ = time;
+
+  if (!frame_stats_.is_settled()) return;
+
+  for (auto &domain : domains_) {
+    SetLevel(&domain, SelectLevel(&domain));
+  }
+
+  // Restore the render scale step by step once the device has cooled down
+  // and the frames are no longer missed.
+  const float since_scale_changed = SecondsSince(render_scale_changed_);
+  if (render_scale_ < 1.f &&
+      ThermalLevel() == XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT &&
+      frame_stats_.missed_frames() == 0 &&
+      since_scale_changed >= kRenderScaleStepSeconds) {
+    SetRenderScale(render_scale_ + kRenderScaleStep);
+  }
+
+  // Keep shedding load while the device is still hot and frames are missed.
+  if (ThermalLevel() != XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT &&
+      frame_stats_.missed_frames() > 0 &&
+      since_scale_changed >= kRenderScaleStepSeconds) {
+    SetRenderScale(render_scale_ - kRenderScaleStep);
+  }
+}
+
+void
+OpenXRPerformanceGovernor::HandlePerfSettingsEvent(
+    const XrEventDataPerfSettingsEXT *event)
+{
+  LOG_INFO("XrEventDataPerfSettingsEXT: %s %s %s -> %s",
+      to_string(event->domain), to_string(event->subDomain),
+      to_string(event->fromLevel), to_string(event->toLevel));
+
+  auto domain = GetDomain(event->domain);
+  if (domain == nullptr) return;
+
+  if (event->subDomain != XR_PERF_SETTINGS_SUB_DOMAIN_THERMAL_EXT) return;
+
+  domain->thermal = event->toLevel;
+
+  // Shed load right away instead of waiting for the runtime to throttle.
+  switch (event->toLevel) {
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT:
+      if (event->fromLevel == XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT) {
+        SetRenderScale(render_scale_ - kRenderScaleStep);
+      }
+      break;
+
+    case XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT:
+      SetRenderScale(kMinRenderScale);
+      break;
+
+    default:
+      break;
+  }
+
+  SetLevel(domain, SelectLevel(domain));
+}
+
+OpenXRPerformanceGovernor::Domain *
+OpenXRPerformanceGovernor::GetDomain(XrPerfSettingsDomainEXT domain)
+{
+  for (auto &candidate : domains_) {
+    if (candidate.domain == domain) return &candidate;
+  }
+
+  return nullptr;
+}
+
+void
+OpenXRPerformanceGovernor::SetLevel(
+    Domain *domain, XrPerfSettingsLevelEXT level)
+{
+  if (domain->level == level) return;
+
+  IF_XR_FAILED (err,
+      xrPerfSettingsSetPerformanceLevelEXT_(session_, domain->domain, level)) {
+    LOG_WARN("%s", err.c_str());
+    return;
+  }
+
+  LOG_DEBUG("Performance level of %s: %s -> %s", to_string(domain->domain),
+      to_string(domain->level), to_string(level));
+  domain->level = level;
+}
+
+XrPerfSettingsLevelEXT
+OpenXRPerformanceGovernor::SelectLevel(Domain *domain)
+{
+  // The runtime is throttling anyway; stay low to let the device cool down.
+  if (domain->thermal == XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT) {
+    domain->is_boosting = false;
+    return XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT;
+  }
+
+  const uint32_t missed_frames = frame_stats_.missed_frames();
+
+  if (missed_frames == 0) domain->is_boost_exhausted = false;
+
+  if (missed_frames >= kBoostMissedFrames && !domain->is_boost_exhausted &&
+      domain->thermal == XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT) {
+    if (!domain->is_boosting) {
+      domain->is_boosting = true;
+      domain->boost_begin = time_;
+    }
+
+    if (SecondsSince(domain->boost_begin) < kMaxBoostSeconds) {
+      return XR_PERF_SETTINGS_LEVEL_BOOST_EXT;
+    }
+
+    domain->is_boost_exhausted = true;
+  }
+
+  domain->is_boosting = false;
+
+  const float headroom = frame_stats_.headroom();
+  if (missed_frames > 0 || headroom < kHighLevelHeadroom) {
+    return XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT;
+  }
+
+  if (headroom > kLowLevelHeadroom) {
+    return XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT;
+  }
+
+  // Keep the current level in between not to flip back and forth.
+  if (domain->level == XR_PERF_SETTINGS_LEVEL_BOOST_EXT) {
+    return XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT;
+  }
+
+  return domain->level;
+}
+
+XrPerfSettingsNotificationLevelEXT
+OpenXRPerformanceGovernor::ThermalLevel() const
+{
+  auto thermal = XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT;
+  for (auto &domain : domains_) {
+    thermal = std::max(thermal, domain.thermal);
+  }
+
+  return thermal;
+}
+
+void
+OpenXRPerformanceGovernor::SetRenderScale(float render_scale)
+{
+  render_scale = std::clamp(render_scale, kMinRenderScale, 1.f);
+
+  // Nothing changed; keep holding from the last change
+  if (render_scale == render_scale_) return;
+
+  LOG_INFO("Render scale: %.3f -> %.3f", render_scale_, render_scale);
+  render_scale_ = render_scale;
+  render_scale_changed_ = time_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "common.h"
+#include "frame-stats.h"
+
+namespace zen::mirror {
+
+/**
+ * Sets CPU/GPU performance levels with XR_EXT_performance_settings.
+ *
+ * Levels follow the measured frame headroom: sustained low while there is
+ * plenty of it, sustained high when it gets tight and a short boost when
+ * frames are being missed. Thermal notifications from the runtime shed load
+ * by lowering the render scale before the runtime throttles the device.
+ */
+class OpenXRPerformanceGovernor {
+ public:
+  DISABLE_MOVE_AND_COPY(OpenXRPerformanceGovernor);
+  OpenXRPerformanceGovernor(XrInstance instance, XrSession session)
+      : instance_(instance), session_(session)
+  {
+  }
+  ~OpenXRPerformanceGovernor() = default;
+
+  bool Init();
+
+  /**
+   * Adjust the performance levels and the render scale; call every frame
+   * with its predicted display time
+   */
+  void Update(XrTime time);
+
+  void HandlePerfSettingsEvent(const XrEventDataPerfSettingsEXT *event);
+
+  /* Fraction of the swapchain size to render into (0, 1] */
+  inline float render_scale();
+
+  /* Feed every frame to this; kept across refresh rate changes */
+  inline FrameStats *frame_stats();
+
+ private:
+  struct Domain {
+    XrPerfSettingsDomainEXT domain;
+    XrPerfSettingsLevelEXT level;
+    XrPerfSettingsNotificationLevelEXT thermal;
+    XrTime boost_begin{0};
+    bool is_boosting{false};
+    bool is_boost_exhausted{false};  // until frames stop being missed
+  };
+
+  Domain *GetDomain(XrPerfSettingsDomainEXT domain);
+
+  /* Calls into the runtime only when the level changes */
+  void SetLevel(Domain *domain, XrPerfSettingsLevelEXT level);
+
+  /* The level the frame stats call for, capped by the thermal state */
+  XrPerfSettingsLevelEXT SelectLevel(Domain *domain);
+
+  /* The worst thermal notification level among the domains */
+  XrPerfSettingsNotificationLevelEXT ThermalLevel() const;
+
+  void SetRenderScale(float render_scale);
+
+  /* Seconds from `begin` to the time of the latest frame */
+  inline float SecondsSince(XrTime begin) const;
+
+  // Boost when this many frames are missed in FrameStats::kWindowSize
+  static constexpr uint32_t kBoostMissedFrames = 2;
+  // Boost no longer than this not to heat up the device
+  static constexpr float kMaxBoostSeconds = 2.f;
+  // Fall back to sustained low above this headroom ...
+  static constexpr float kLowLevelHeadroom = 0.5f;
+  // ... and go up to sustained high below this headroom
+  static constexpr float kHighLevelHeadroom = 0.25f;
+
+  static constexpr float kMinRenderScale = 0.5f;
+  static constexpr float kRenderScaleStep = 0.125f;
+  // Change the render scale by a step at most once per this many seconds
+  static constexpr float kRenderScaleStepSeconds = 10.f;
+
+  XrInstance instance_;
+  XrSession session_;
+  FrameStats frame_stats_;
+
+  PFN_xrPerfSettingsSetPerformanceLevelEXT
+      xrPerfSettingsSetPerformanceLevelEXT_{};
+
+  std::array<Domain, 2> domains_{{
+      {XR_PERF_SETTINGS_DOMAIN_CPU_EXT,
+          XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT,
+          XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT},
+      {XR_PERF_SETTINGS_DOMAIN_GPU_EXT,
+          XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT,
+          XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT},
+  }};
+
+  XrTime time_{0};  // of the latest frame
+  float render_scale_{1.f};
+  XrTime render_scale_changed_{0};
+};
+
+inline float
+OpenXRPerformanceGovernor::render_scale()
+{
+  return render_scale_;
+}
+
+inline FrameStats *
+OpenXRPerformanceGovernor::frame_stats()
+{
+  return &frame_stats_;
+}
+
+inline float
+OpenXRPerformanceGovernor::SecondsSince(XrTime begin) const
+{
+  return (float)(time_ - begin) / 1e9f;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,62 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-session-state.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+void
+OpenXRSessionState::Update(XrSessionState state, XrTime time)
+{
+  XrSessionState old_state = state_;
+  state_ = state;
+  LOG_INFO("XrEventDataSessionStateChanged: state %s -> %s time=%" PRId64,
+      to_string(old_state), to_string(state_), time);
+
+  switch (state_) {
+    case XR_SESSION_STATE_READY: {
+      XrSessionBeginInfo session_begin_info{XR_TYPE_SESSION_BEGIN_INFO};
+      session_begin_info.primaryViewConfigurationType =
+          view_configuration_type_;
+      IF_XR_FAILED (err, xrBeginSession(session_, &session_begin_info)) {
+        LOG_ERROR("%s", err.c_str());
+        delegate_->Terminate();
+      }
+      is_running_ = true;
+      begin_time_ = std::chrono::steady_clock::now();
+      if (is_remote_session_enabled_) {
+        LOG_INFO("Resuming with the remote session retained");
+      } else {
+        delegate_->EnableRemoteSession();
+        is_remote_session_enabled_ = true;
+      }
+      break;
+    }
+
+    case XR_SESSION_STATE_STOPPING: {
+      IF_XR_FAILED (err, xrEndSession(session_)) {
+        LOG_ERROR("%s", err.c_str());
+        delegate_->Terminate();
+      }
+      is_running_ = false;
+      // Keep the remote session, and with it the scene and its GL resources,
+      // so that resuming does not re-sync and re-upload the whole scene
+      break;
+    }
+
+    case XR_SESSION_STATE_EXITING:  // fall through
+    case XR_SESSION_STATE_LOSS_PENDING:
+      if (is_remote_session_enabled_) {
+        delegate_->DisableRemoteSession();
+        is_remote_session_enabled_ = false;
+      }
+      delegate_->Terminate();
+      break;
+
+    default:
+      break;
+  }
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Follows the state of the XrSession, beginning it on READY and ending it on
+ * STOPPING.
+ *
+ * The remote session is enabled on the first READY and kept while the session
+ * is stopped, for example while the headset is off, so that zen-remote keeps
+ * the scene and its GL resources and a resume does not sync and upload the
+ * whole scene again. It is disabled once the session exits or is lost.
+ */
+class OpenXRSessionState {
+ public:
+  struct IDelegate;
+
+  DISABLE_MOVE_AND_COPY(OpenXRSessionState);
+  OpenXRSessionState(XrSession session,
+      XrViewConfigurationType view_configuration_type, IDelegate *delegate)
+      : session_(session),
+        view_configuration_type_(view_configuration_type),
+        delegate_(delegate)
+  {
+  }
+  ~OpenXRSessionState() = default;
+
+  /* Handle XrEventDataSessionStateChanged */
+  void Update(XrSessionState state, XrTime time);
+
+  inline XrSessionState state();
+  inline bool is_running();
+
+  /* Stays enabled while the session is stopped, until it exits */
+  inline bool is_remote_session_enabled();
+
+  /* When the session last began */
+  inline std::chrono::steady_clock::time_point begin_time();
+
+ private:
+  XrSession session_;
+  XrViewConfigurationType view_configuration_type_;
+  IDelegate *delegate_;
+  XrSessionState state_{XR_SESSION_STATE_UNKNOWN};
+  bool is_running_{false};
+  bool is_remote_session_enabled_{false};
+  std::chrono::steady_clock::time_point begin_time_{};
+};
+
+struct OpenXRSessionState::IDelegate {
+  DISABLE_MOVE_AND_COPY(IDelegate);
+  IDelegate() = default;
+  virtual ~IDelegate() = default;
+
+  virtual void EnableRemoteSession() = 0;
+  virtual void DisableRemoteSession() = 0;
+
+  /* The session exits or is lost, or could not begin or end */
+  virtual void Terminate() = 0;
+};
+
+inline XrSessionState
+OpenXRSessionState::state()
+{
+  return state_;
+}
+
+inline bool
+OpenXRSessionState::is_running()
+{
+  return is_running_;
+}
+
+inline bool
+OpenXRSessionState::is_remote_session_enabled()
+{
+  return is_remote_session_enabled_;
+}
+
+inline std::chrono::steady_clock::time_point
+OpenXRSessionState::begin_time()
+{
+  return begin_time_;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,237 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-space-warp.h"
+#include "openxr-util.h"
+
+namespace zen::mirror {
+
+OpenXRSpaceWarp::~OpenXRSpaceWarp()
+{
+  for (auto &view : views_) {
+    for (auto [key, framebuffer] : view.framebuffers) {
+      glDeleteFramebuffers(1, &framebuffer);
+    }
+    if (view.motion_vector.handle != XR_NULL_HANDLE) {
+      xrDestroySwapchain(view.motion_vector.handle);
+    }
+    if (view.depth.handle != XR_NULL_HANDLE) {
+      xrDestroySwapchain(view.depth.handle);
+    }
+  }
+
+  for (auto handle : gpu_memory_) {
+    gpu_memory_budget_->Release(handle);
+  }
+}
+
+bool
+OpenXRSpaceWarp::Init(uint32_t view_count, float near, float far)
+{
+  XrSystemSpaceWarpPropertiesFB space_warp_properties{
+      XR_TYPE_SYSTEM_SPACE_WARP_PROPERTIES_FB};
+  XrSystemProperties system_properties{XR_TYPE_SYSTEM_PROPERTIES};
+  system_properties.next = &space_warp_properties;
+  IF_XR_FAILED (err,
+      xrGetSystemProperties(instance_, system_id_, &system_properties)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  width_ = space_warp_properties.recommendedMotionVectorImageRectWidth;
+  height_ = space_warp_properties.recommendedMotionVectorImageRectHeight;
+  if (width_ == 0 || height_ == 0) {
+    LOG_WARN("The system recommends no motion vector image size");
+    return false;
+  }
+
+  uint32_t format_count = 0;
+  IF_XR_FAILED (err,
+      xrEnumerateSwapchainFormats(session_, 0, &format_count, nullptr)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  std::vector<int64_t> formats(format_count);
+  IF_XR_FAILED (err, xrEnumerateSwapchainFormats(session_, format_count,
+                         &format_count, formats.data())) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  for (int64_t format : {kMotionVectorFormat, kDepthFormat}) {
+    if (std::find(formats.begin(), formats.end(), format) == formats.end()) {
+      LOG_WARN("Swapchain format 0x%" PRIx64 " for space warp is not "
+               "supported",
+          format);
+      return false;
+    }
+  }
+
+  views_.resize(view_count);
+  for (auto &view : views_) {
+    if (!CreateSwapchain(kMotionVectorFormat,
+            XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT, &view.motion_vector,
+            kMotionVectorBytesPerPixel, GpuMemoryCategory::kMirror) ||
+        !CreateSwapchain(kDepthFormat,
+            XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &view.depth,
+            kDepthBytesPerPixel, GpuMemoryCategory::kDepth)) {
+      return false;
+    }
+
+    auto &info = view.info;
+    info.layerFlags = 0;
+    info.motionVectorSubImage.swapchain = view.motion_vector.handle;
+    info.motionVectorSubImage.imageRect.offset = {0, 0};
+    info.motionVectorSubImage.imageRect.extent = {width_, height_};
+    info.motionVectorSubImage.imageArrayIndex = 0;
+    info.appSpaceDeltaPose = Math::ToXrPosef(glm::vec3(0), glm::quat());
+    info.depthSubImage.swapchain = view.depth.handle;
+    info.depthSubImage.imageRect.offset = {0, 0};
+    info.depthSubImage.imageRect.extent = {width_, height_};
+    info.depthSubImage.imageArrayIndex = 0;
+    info.minDepth = 0.f;
+    info.maxDepth = 1.f;
+    info.nearZ = near;
+    info.farZ = far;
+  }
+
+  LOG_DEBUG("Space warp: motion vector and depth images of %dx%d", width_,
+      height_);
+
+  return true;
+}
+
+void
+OpenXRSpaceWarp::set_enabled(bool is_enabled)
+{
+  if (is_enabled_ == is_enabled) return;
+  is_enabled_ = is_enabled;
+
+  LOG_INFO("Depth-only space warp %s", is_enabled ? "enabled" : "disabled");
+}
+
+bool
+OpenXRSpaceWarp::CreateSwapchain(int64_t format, XrSwapchainUsageFlags usage,
+    Swapchain *swapchain, uint64_t bytes_per_pixel, GpuMemoryCategory category)
+{
+  XrSwapchainCreateInfo swapchain_create_info{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+  swapchain_create_info.arraySize = 1;
+  swapchain_create_info.format = format;
+  swapchain_create_info.width = width_;
+  swapchain_create_info.height = height_;
+  swapchain_create_info.mipCount = 1;
+  swapchain_create_info.faceCount = 1;
+  swapchain_create_info.sampleCount = 1;
+  swapchain_create_info.usageFlags = usage;
+
+  IF_XR_FAILED (err, xrCreateSwapchain(session_, &swapchain_create_info,
+                         &swapchain->handle)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  uint32_t image_count;
+  IF_XR_FAILED (err, xrEnumerateSwapchainImages(
+                         swapchain->handle, 0, &image_count, nullptr)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  swapchain->images.resize(
+      image_count, {XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR});
+
+  IF_XR_FAILED (err,
+      xrEnumerateSwapchainImages(swapchain->handle, image_count, &image_count,
+          reinterpret_cast<XrSwapchainImageBaseHeader *>(
+              swapchain->images.data()))) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  gpu_memory_.push_back(gpu_memory_budget_->Track(category,
+      (uint64_t)width_ * height_ * bytes_per_pixel * image_count));
+
+  return true;
+}
+
+bool
+OpenXRSpaceWarp::RenderView(uint32_t view_index, GLuint framebuffer,
+    int32_t width, int32_t height,
+    XrCompositionLayerProjectionView *projection_view)
+{
+  CHECK(view_index < views_.size());
+  View &view = views_[view_index];
+
+  auto motion_vector_index = Acquire(view.motion_vector);
+  if (!motion_vector_index) return false;
+  auto depth_index = Acquire(view.depth);
+  if (!depth_index) return false;
+
+  const uint64_t key = (uint64_t)*motion_vector_index << 32 | *depth_index;
+  GLuint &space_warp_framebuffer = view.framebuffers[key];
+  if (space_warp_framebuffer == 0) {
+    glGenFramebuffers(1, &space_warp_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, space_warp_framebuffer);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        view.motion_vector.images[*motion_vector_index].image, 0);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+        view.depth.images[*depth_index].image, 0);
+  }
+
+  // Scaled down; depth allows no filtering but the nearest sample
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, space_warp_framebuffer);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width_, height_,
+      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, space_warp_framebuffer);
+  glViewport(0, 0, width_, height_);
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  if (!Release(view.motion_vector) || !Release(view.depth)) return false;
+
+  projection_view->next = &view.info;
+
+  return true;
+}
+
+std::optional<uint32_t>
+OpenXRSpaceWarp::Acquire(const Swapchain &swapchain)
+{
+  XrSwapchainImageAcquireInfo acquire_info{
+      XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+  uint32_t image_index;
+  IF_XR_FAILED (err,
+      xrAcquireSwapchainImage(swapchain.handle, &acquire_info, &image_index)) {
+    LOG_ERROR("%s", err.c_str());
+    return std::nullopt;
+  }
+
+  XrSwapchainImageWaitInfo wait_info{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+  wait_info.timeout = XR_INFINITE_DURATION;
+  IF_XR_FAILED (err, xrWaitSwapchainImage(swapchain.handle, &wait_info)) {
+    LOG_ERROR("%s", err.c_str());
+    return std::nullopt;
+  }
+
+  return image_index;
+}
+
+bool
+OpenXRSpaceWarp::Release(const Swapchain &swapchain)
+{
+  XrSwapchainImageReleaseInfo release_info{
+      XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+  IF_XR_FAILED (err, xrReleaseSwapchainImage(swapchain.handle, &release_info)) {
+    LOG_ERROR("%s", err.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common.h"
+#include "gpu-memory-budget.h"
+
+namespace zen::mirror {
+
+/**
+ * Depth-only application space warp with XR_FB_space_warp. While enabled,
+ * each projection view carries a depth image and a motion vector image of no
+ * motion, and Meta's runtime paces the app at half the display rate,
+ * synthesizing every other displayed frame from the last one.
+ *
+ * Only head motion is reprojected, with the depth. zen-remote renders no
+ * motion vectors, so objects that move hold still in the synthesized frames
+ * and judder at half the rate.
+ *
+ * The images are at the resolution the system recommends for motion
+ * vectors, below that of the eye buffers. The depth is copied down from the
+ * eye buffer after the scene is rendered.
+ */
+class OpenXRSpaceWarp {
+ public:
+  DISABLE_MOVE_AND_COPY(OpenXRSpaceWarp);
+  OpenXRSpaceWarp(XrInstance instance, XrSystemId system_id,
+      XrSession session, GpuMemoryBudget *gpu_memory_budget)
+      : instance_(instance),
+        system_id_(system_id),
+        session_(session),
+        gpu_memory_budget_(gpu_memory_budget)
+  {
+  }
+  ~OpenXRSpaceWarp();
+
+  /**
+   * Create the swapchains of `view_count` views. `near` and `far` are those
+   * of the projection the scene is rendered with.
+   */
+  bool Init(uint32_t view_count, float near, float far);
+
+  /* Takes effect from the next frame */
+  void set_enabled(bool is_enabled);
+  inline bool is_enabled() const;
+
+  /**
+   * Call while enabled, after the scene of the view is rendered to the
+   * `width` x `height` area of `framebuffer`. Copies the depth, clears the
+   * motion vectors to no motion, and chains their space warp info to
+   * `projection_view`, which must stay where it is until the frame ends.
+   * @returns false on failure of the runtime
+   */
+  bool RenderView(uint32_t view_index, GLuint framebuffer, int32_t width,
+      int32_t height, XrCompositionLayerProjectionView *projection_view);
+
+ private:
+  struct Swapchain {
+    XrSwapchain handle{XR_NULL_HANDLE};
+    std::vector<XrSwapchainImageOpenGLESKHR> images;
+  };
+
+  struct View {
+    Swapchain motion_vector;
+    Swapchain depth;
+
+    // Created lazily for each pair of image indices
+    std::unordered_map<uint64_t, GLuint> framebuffers;
+
+    XrCompositionLayerSpaceWarpInfoFB info{
+        XR_TYPE_COMPOSITION_LAYER_SPACE_WARP_INFO_FB};
+  };
+
+  static constexpr int64_t kMotionVectorFormat = GL_RGBA16F;
+  // The same as the eye buffer depth, which blits require
+  static constexpr int64_t kDepthFormat = GL_DEPTH_COMPONENT32F;
+  static constexpr uint64_t kMotionVectorBytesPerPixel = 8;
+  static constexpr uint64_t kDepthBytesPerPixel = 4;
+
+  bool CreateSwapchain(int64_t format, XrSwapchainUsageFlags usage,
+      Swapchain *swapchain, uint64_t bytes_per_pixel,
+      GpuMemoryCategory category);
+
+  /* @returns the index of the acquired image, or std::nullopt on failure */
+  std::optional<uint32_t> Acquire(const Swapchain &swapchain);
+
+  bool Release(const Swapchain &swapchain);
+
+  XrInstance instance_;
+  XrSystemId system_id_;
+  XrSession session_;
+  GpuMemoryBudget *gpu_memory_budget_;
+
+  int32_t width_{0};
+  int32_t height_{0};
+  std::vector<View> views_;
+  std::vector<GpuMemoryBudget::Handle> gpu_memory_;
+  bool is_enabled_{false};
+};
+
+inline bool
+OpenXRSpaceWarp::is_enabled() const
+{
+  return is_enabled_;
+}
+
+}  // namespace zen::mirror
@@ -20,6 +20,10 @@ namespace {
 
 MAKE_TO_STRING_FUNC(XrEnvironmentBlendMode);
 MAKE_TO_STRING_FUNC(XrFormFactor);
+MAKE_TO_STRING_FUNC(XrPerfSettingsDomainEXT);
+MAKE_TO_STRING_FUNC(XrPerfSettingsLevelEXT);
+MAKE_TO_STRING_FUNC(XrPerfSettingsNotificationLevelEXT);
+MAKE_TO_STRING_FUNC(XrPerfSettingsSubDomainEXT);
 MAKE_TO_STRING_FUNC(XrReferenceSpaceType);
 MAKE_TO_STRING_FUNC(XrResult);
 MAKE_TO_STRING_FUNC(XrSessionState);
@@ -1,18 +1,26 @@
 #include "pch.h"
 
+#include "config.h"
 #include "logger.h"
+#include "media-codec-encoder.h"
 #include "openxr-util.h"
 #include "openxr-view-source.h"
 
 namespace zen::mirror {
 
 constexpr float kRenderingScale = 2.f;
+constexpr uint64_t kSwapchainBytesPerPixel = 4;  // estimated for RGBA8
+constexpr uint64_t kDepthBytesPerPixel = 4;      // GL_DEPTH_COMPONENT32F
 
 OpenXRViewSource::~OpenXRViewSource()
 {
   for (auto swapchain : swapchains_) {
     xrDestroySwapchain(swapchain.handle);
   }
+
+  for (auto handle : gpu_memory_) {
+    context_->gpu_memory_budget()->Release(handle);
+  }
 }
 
 OpenXRViewSource::SwapchainFramebuffer::~SwapchainFramebuffer()
@@ -121,6 +129,10 @@ OpenXRViewSource::Init()
     LOG_DEBUG("Swapchain Formats: %s", formats_string_stream.str().c_str());
   }
 
+  // Levels of detail are chosen for the display, not the supersampled
+  // swapchains
+  lod_selector_.set_display_width(config_views[0].recommendedImageRectWidth);
+
   // Create a swapchain for each view
   for (uint32_t i = 0; i < view_count; i++) {
     auto &config_view = config_views[i];
@@ -204,19 +216,52 @@ OpenXRViewSource::Init()
       swapchain.framebuffers[i].depth_buffer = depth_buffer;
     }
 
+    const uint64_t pixel_count =
+        (uint64_t)swapchain.width * swapchain.height * image_count;
+    gpu_memory_.push_back(context_->gpu_memory_budget()->Track(
+        GpuMemoryCategory::kSwapchain, pixel_count * kSwapchainBytesPerPixel));
+    gpu_memory_.push_back(context_->gpu_memory_budget()->Track(
+        GpuMemoryCategory::kDepth, pixel_count * kDepthBytesPerPixel));
+
     swapchains_.emplace_back(std::move(swapchain));
   }
 
   // Resize view buffer for xrLocateViews later.
   views_.resize(view_count, {XR_TYPE_VIEW});
 
+  if (context_->IsExtensionEnabled(XR_FB_SPACE_WARP_EXTENSION_NAME)) {
+    space_warp_ = std::make_unique<OpenXRSpaceWarp>(context_->instance(),
+        context_->system_id(), context_->session(),
+        context_->gpu_memory_budget());
+    if (space_warp_->Init(view_count, kNear, kFar)) {
+      space_warp_->set_enabled(config::SPACE_WARP);
+    } else {
+      LOG_WARN("Failed to initialize space warp; rendering at full rate");
+      space_warp_.reset();
+    }
+  }
+
+  if (config::SPECTATOR_RATE > 0) {
+    spectator_ = std::make_unique<SpectatorStream>(
+        std::make_unique<MediaCodecEncoder>(), context_->gpu_memory_budget(),
+        config::SPECTATOR_WIDTH, config::SPECTATOR_RATE);
+    if (!spectator_->Init(config::SPECTATOR_PORT, swapchains_[0].width,
+            swapchains_[0].height)) {
+      LOG_WARN("Spectator stream is not available");
+      spectator_.reset();
+    }
+  }
+
   return true;
 }
 
 void
 OpenXRViewSource::Process()
 {
-  if (context_->is_session_running() == false) return;
+  if (context_->is_session_running() == false) {
+    if (context_->is_remote_session_enabled()) UpdatePausedScene();
+    return;
+  }
 
   XrFrameWaitInfo frame_wait_info{XR_TYPE_FRAME_WAIT_INFO};
   XrFrameState frame_state{XR_TYPE_FRAME_STATE};
@@ -227,6 +272,17 @@ OpenXRViewSource::Process()
     return;
   }
 
+  auto display_refresh_rate = context_->display_refresh_rate();
+  auto performance_governor = context_->performance_governor();
+
+  // Each controller keeps its own window of the frames
+  if (display_refresh_rate) {
+    display_refresh_rate->frame_stats()->BeginFrame(frame_state);
+  }
+  if (performance_governor) {
+    performance_governor->frame_stats()->BeginFrame(frame_state);
+  }
+
   if (context_->app_space() == XR_NULL_HANDLE) {
     if (!context_->InitializeAppSpace(frame_state.predictedDisplayTime)) {
       loop_->Terminate();
@@ -234,6 +290,15 @@ OpenXRViewSource::Process()
     }
   }
 
+  for (auto it = frame_listeners_.begin(); it != frame_listeners_.end();) {
+    if (auto listener = (*it).lock()) {
+      listener->OnFrame(frame_state);
+      it++;
+    } else {
+      it = frame_listeners_.erase(it);
+    }
+  }
+
   XrFrameBeginInfo frame_begin_info{XR_TYPE_FRAME_BEGIN_INFO};
   IF_XR_FAILED (err, xrBeginFrame(context_->session(), &frame_begin_info)) {
     LOG_ERROR("%s", err.c_str());
@@ -274,6 +339,68 @@ OpenXRViewSource::Process()
     loop_->Terminate();
     return;
   }
+
+  if (display_refresh_rate) display_refresh_rate->frame_stats()->EndFrame();
+  if (performance_governor) performance_governor->frame_stats()->EndFrame();
+
+  if (!layers.empty() &&
+      first_frame_session_begin_time_ != context_->session_begin_time()) {
+    first_frame_session_begin_time_ = context_->session_begin_time();
+    LOG_INFO("First frame displayed %.1f ms after the session began",
+        std::chrono::duration<float, std::milli>(
+            std::chrono::steady_clock::now() - first_frame_session_begin_time_)
+            .count());
+  }
+
+  if (display_refresh_rate) display_refresh_rate->Update();
+
+  if (performance_governor) {
+    performance_governor->Update(frame_state.predictedDisplayTime);
+  }
+}
+
+void
+OpenXRViewSource::UpdatePausedScene()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now - last_paused_scene_update_ < kPausedSceneUpdatePeriod) return;
+  last_paused_scene_update_ = now;
+
+  remote_->UpdateScene();
+}
+
+void
+OpenXRViewSource::SetBounds(uint64_t id, const Aabb &bounds)
+{
+  culler_.SetBounds(id, bounds);
+  lod_selector_.SetBounds(id, bounds);
+  if (auto ray_picker = ray_picker_.lock()) ray_picker->SetBounds(id, bounds);
+}
+
+void
+OpenXRViewSource::Remove(uint64_t id)
+{
+  culler_.Remove(id);
+  lod_selector_.Remove(id);
+  transforms_.Remove(id);
+  if (auto ray_picker = ray_picker_.lock()) ray_picker->Remove(id);
+}
+
+void
+OpenXRViewSource::SetPose(
+    uint64_t id, int64_t time, int64_t receive_time, const XrPosef &pose)
+{
+  // Left in the server's clock without the clock sync
+  if (auto scene_latency = scene_latency_.lock()) {
+    time = scene_latency->clock_sync()->ToMirrorTime(time);
+  }
+  transforms_.Push(id, time, receive_time, pose);
+}
+
+void
+OpenXRViewSource::AddFrameListener(std::weak_ptr<IFrameListener> listener)
+{
+  frame_listeners_.push_back(listener);
 }
 
 bool
@@ -306,10 +433,33 @@ OpenXRViewSource::RenderViews(XrTime predict_display_time,
 
   projection_layer_views.resize(view_count_output);
 
+  // Take over the uploads the GPU has finished before the scene uses them
+  if (auto upload_thread = context_->upload_thread()) upload_thread->Poll();
+
+  // zen-remote evaluates its scene without a time; the transforms fed here
+  // are evaluated at the time the frame will be displayed
+  const int64_t display_time = context_->ToMonotonicTime(predict_display_time);
+  transforms_.Evaluate(display_time);
+
   remote_->UpdateScene();
+  if (auto scene_latency = scene_latency_.lock()) {
+    scene_latency->OnSceneUpdated(ClockSync::Now(), display_time);
+  }
+
+  // Once for all the views; remote_->Render below still draws every object,
+  // the visible set only spares the LOD selector the off-screen ones
+  culler_.Cull(views_);
+  lod_selector_.Select(views_, culler_.visible());
+
+  float render_scale = 1.f;
+  if (auto performance_governor = context_->performance_governor()) {
+    render_scale = performance_governor->render_scale();
+  }
 
   for (uint32_t i = 0; i < view_count_output; i++) {
     auto &swapchain = swapchains_[i];
+    const int32_t rendering_width = swapchain.width * render_scale;
+    const int32_t rendering_height = swapchain.height * render_scale;
     XrSwapchainImageAcquireInfo acquire_info{
         XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
 
@@ -337,21 +487,21 @@ OpenXRViewSource::RenderViews(XrTime predict_display_time,
     projection_layer_views[i].subImage.swapchain = swapchain.handle;
     projection_layer_views[i].subImage.imageRect.offset = {0, 0};
     projection_layer_views[i].subImage.imageRect.extent = {
-        swapchain.width, swapchain.height};
+        rendering_width, rendering_height};
 
     auto framebuffer =
         swapchain.framebuffers[swapchain_image_index].framebuffer;
 
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
-    auto projection = Math::ToProjectionMatrix(views_[i].fov, 0.05, 1000.0);
+    auto projection = Math::ToProjectionMatrix(views_[i].fov, kNear, kFar);
     auto position = Math::ToGlm(views_[i].pose.position);
     auto orientation = Math::ToGlm(views_[i].pose.orientation);
     auto view = glm::mat4(1.0);
     view = glm::translate(view, -position);
     view = glm::toMat4(glm::inverse(orientation)) * view;
 
-    glViewport(0, 0, swapchain.width, swapchain.height);
+    glViewport(0, 0, rendering_width, rendering_height);
 
     glClearColor(17.f / 256.f, 31.f / 256.f, 77.f / 256.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -362,6 +512,19 @@ OpenXRViewSource::RenderViews(XrTime predict_display_time,
 
     remote_->Render(&camera);
 
+    if (i == 0 && spectator_) {
+      spectator_->Capture(
+          framebuffer, rendering_width, rendering_height, display_time);
+    }
+
+    if (space_warp_ && space_warp_->is_enabled()) {
+      if (!space_warp_->RenderView(i, framebuffer, rendering_width,
+              rendering_height, &projection_layer_views[i])) {
+        loop_->Terminate();
+        return false;
+      }
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     XrSwapchainImageReleaseInfo release_info{
@@ -374,6 +537,8 @@ OpenXRViewSource::RenderViews(XrTime predict_display_time,
     }
   }
 
+  context_->gpu_memory_budget()->EndFrame();
+
   return true;
 }
 
@@ -1,12 +1,22 @@
 #pragma once
 
+#include "bulk-channel.h"
+#include "frustum-culler.h"
+#include "lod-selector.h"
 #include "loop.h"
 #include "openxr-context.h"
+#include "openxr-space-warp.h"
+#include "ray-picker.h"
+#include "scene-latency.h"
+#include "spectator-stream.h"
+#include "transform-timeline.h"
 
 namespace zen::mirror {
 
-class OpenXRViewSource : public Loop::ISource {
+class OpenXRViewSource : public Loop::ISource,
+                         public BulkChannel::ISceneSink {
  public:
+  struct IFrameListener;
   struct Swapchain;
   struct SwapchainFramebuffer;
 
@@ -16,15 +26,47 @@ class OpenXRViewSource : public Loop::ISource {
       std::shared_ptr<zen::remote::client::IRemote> remote)
       : context_(std::move(context)),
         loop_(std::move(loop)),
-        remote_(std::move(remote))
+        remote_(std::move(remote)),
+        culler_(kFar),
+        lod_selector_(kNear)
   {
   }
-  ~OpenXRViewSource();
+  ~OpenXRViewSource() override;
 
   /* Allocate view buffer and create a swapchain for each view */
   bool Init();
   void Process() override;
 
+  /* Add a listener notified of each frame right after xrWaitFrame */
+  void AddFrameListener(std::weak_ptr<IFrameListener> listener);
+
+  /**
+   * The bounds of the remote render objects, for the culler, the LOD selector
+   * and the ray picker, and their poses, for the transform timeline
+   */
+  void SetBounds(uint64_t id, const Aabb &bounds) override;
+  void Remove(uint64_t id) override;
+  void SetPose(uint64_t id, int64_t time, int64_t receive_time,
+      const XrPosef &pose) override;
+
+  /* Picks against the bounds given to SetBounds */
+  inline void set_ray_picker(std::weak_ptr<RayPicker> ray_picker);
+
+  /* Selects among the objects the culler keeps; give it the mesh levels */
+  inline LodSelector *lod_selector();
+
+  /**
+   * Switches depth-only space warp at runtime; nullptr if XR_FB_space_warp is
+   * not available
+   */
+  inline OpenXRSpaceWarp *space_warp();
+
+  /* Remote transforms, evaluated at the predicted display time of frames */
+  inline TransformTimeline *transforms();
+
+  /* Notified of each UpdateScene and the display time of its frame */
+  inline void set_scene_latency(std::weak_ptr<SceneLatency> scene_latency);
+
  private:
   /**
    * @returns false when the views should not be rendered.
@@ -32,9 +74,30 @@ class OpenXRViewSource : public Loop::ISource {
   bool RenderViews(XrTime predict_display_time,
       std::vector<XrCompositionLayerProjectionView>& projection_layer_views);
 
+  /**
+   * Apply the remote updates that arrive while the session is stopped, so
+   * that they do not pile up and the scene is current on resume
+   */
+  void UpdatePausedScene();
+
+  static constexpr std::chrono::milliseconds kPausedSceneUpdatePeriod{100};
+
+  // The planes of the projection
+  static constexpr float kNear = 0.05f;
+  static constexpr float kFar = 1000.f;
+
   std::shared_ptr<OpenXRContext> context_;
   std::shared_ptr<Loop> loop_;
   std::shared_ptr<zen::remote::client::IRemote> remote_;
+  std::vector<std::weak_ptr<IFrameListener>> frame_listeners_;
+  std::weak_ptr<SceneLatency> scene_latency_;
+  std::weak_ptr<RayPicker> ray_picker_;
+  std::chrono::steady_clock::time_point last_paused_scene_update_{};
+  // The begin time of the session whose first frame is already logged
+  std::chrono::steady_clock::time_point first_frame_session_begin_time_{};
+  FrustumCuller culler_;
+  LodSelector lod_selector_;
+  TransformTimeline transforms_;
 
   /**
    * The following vectors are of the same size, and items at the same index
@@ -42,6 +105,51 @@ class OpenXRViewSource : public Loop::ISource {
    */
   std::vector<XrView> views_;  // resized properly when initialized
   std::vector<Swapchain> swapchains_;
+
+  std::unique_ptr<OpenXRSpaceWarp> space_warp_;
+  std::unique_ptr<SpectatorStream> spectator_;  // nullptr if disabled
+
+  // The allocations above tracked in the GPU memory budget
+  std::vector<GpuMemoryBudget::Handle> gpu_memory_;
+};
+
+inline LodSelector *
+OpenXRViewSource::lod_selector()
+{
+  return &lod_selector_;
+}
+
+inline OpenXRSpaceWarp *
+OpenXRViewSource::space_warp()
+{
+  return space_warp_.get();
+}
+
+inline TransformTimeline *
+OpenXRViewSource::transforms()
+{
+  return &transforms_;
+}
+
+inline void
+OpenXRViewSource::set_ray_picker(std::weak_ptr<RayPicker> ray_picker)
+{
+  ray_picker_ = std::move(ray_picker);
+}
+
+inline void
+OpenXRViewSource::set_scene_latency(std::weak_ptr<SceneLatency> scene_latency)
+{
+  scene_latency_ = std::move(scene_latency);
+}
+
+struct OpenXRViewSource::IFrameListener {
+  DISABLE_MOVE_AND_COPY(IFrameListener);
+  IFrameListener() = default;
+  virtual ~IFrameListener() = default;
+
+  /* The app space is available when this is called */
+  virtual void OnFrame(const XrFrameState &frame_state) = 0;
 };
 
 struct OpenXRViewSource::Swapchain {
@@ -1,21 +1,53 @@
 #pragma once
 
+// Only in the app; the host tests build without the NDK
+#ifdef __ANDROID__
+#include <android/log.h>
+#include <android_native_app_glue.h>
+#include <media/NdkMediaCodec.h>
+#endif
+
 #include <EGL/egl.h>
 #include <GLES3/gl3.h>
 #include <GLES3/gl32.h>
-#include <android/log.h>
-#include <android_native_app_glue.h>
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cinttypes>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <functional>
 #include <glm/gtx/quaternion.hpp>
 #include <glm/vec3.hpp>
+#include <limits>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <netinet/in.h>
 #include <openxr/openxr.h>
 #include <openxr/openxr_platform.h>
 #include <openxr/openxr_reflection.h>
+#include <optional>
+#include <poll.h>
 #include <sstream>
 #include <stdarg.h>
 #include <string>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <zen-remote/client/remote.h>
 #include <zen-remote/logger.h>
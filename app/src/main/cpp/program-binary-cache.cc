@@ -0,0 +1,399 @@
+#include "pch.h"
+
+#include "content-hash.h"
+#include "file-util.h"
+#include "logger.h"
+#include "program-binary-cache.h"
+
+namespace zen::mirror {
+
+namespace {
+
+std::string
+PathOf(const std::string &directory, uint64_t key)
+{
+  return directory + "/" + HashFileName(key);
+}
+
+GLuint
+CompileShader(GLenum type, const std::string &source)
+{
+  GLuint shader = glCreateShader(type);
+  const char *data = source.c_str();
+  glShaderSource(shader, 1, &data, nullptr);
+  glCompileShader(shader);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status == GL_FALSE) {
+    char log[512] = {};
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    LOG_WARN("Failed to compile a shader: %s", log);
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+
+}  // namespace
+
+bool
+ProgramBinaryCache::Init()
+{
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  shared_->is_supported = format_count > 0;
+
+  std::string driver;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    auto value = reinterpret_cast<const char *>(glGetString(name));
+    driver += value ? value : "";
+    driver += '\n';
+  }
+  shared_->driver_hash = ContentHash(driver.data(), driver.size());
+
+  if (!shared_->is_supported) {
+    LOG_INFO("Program binaries are not supported; programs are only "
+             "precompiled");
+    return true;
+  }
+
+  const std::string &directory = shared_->directory;
+  if (mkdir(directory.c_str(), 0700) == -1 && errno != EEXIST) {
+    LOG_ERROR("Failed to create the program binary directory %s: %s",
+        directory.c_str(), strerror(errno));
+    return false;
+  }
+
+  DIR *dir = opendir(directory.c_str());
+  if (dir == nullptr) {
+    LOG_ERROR("Failed to open the program binary directory %s: %s",
+        directory.c_str(), strerror(errno));
+    return false;
+  }
+
+  struct Found {
+    uint64_t key;
+    std::shared_ptr<Binary> binary;
+    timespec modified;
+  };
+  std::vector<Found> found;
+  uint64_t stale_count = 0;
+
+  while (dirent *ent = readdir(dir)) {
+    if (ent->d_name[0] == '.') continue;
+
+    const std::string path = directory + "/" + ent->d_name;
+    auto key = ParseHashFileName(ent->d_name);
+    int fd = key ? open(path.c_str(), O_RDONLY | O_CLOEXEC) : -1;
+
+    struct stat st;
+    FileHeader header{};
+    auto binary = std::make_shared<Binary>();
+    bool is_valid = fd != -1 && fstat(fd, &st) == 0 &&
+                    (size_t)st.st_size > sizeof(header) &&
+                    ReadAll(fd, &header, sizeof(header)) &&
+                    header.magic == kMagic;
+    if (is_valid) {
+      binary->format = header.format;
+      binary->data.resize(st.st_size - sizeof(header));
+      is_valid = ReadAll(fd, binary->data.data(), binary->data.size());
+    }
+    if (fd != -1) close(fd);
+
+    // Temporary files left by a crash, and binaries of another driver
+    if (!is_valid || header.driver_hash != shared_->driver_hash) {
+      if (is_valid) stale_count++;
+      unlink(path.c_str());
+      continue;
+    }
+
+    found.push_back(Found{*key, std::move(binary), st.st_mtim});
+  }
+  closedir(dir);
+
+  std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+    return std::tie(a.modified.tv_sec, a.modified.tv_nsec) >
+           std::tie(b.modified.tv_sec, b.modified.tv_nsec);
+  });
+
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+
+  // The newest that fit
+  for (auto &item : found) {
+    const uint64_t size = sizeof(FileHeader) + item.binary->data.size();
+    if (shared_->stored_size + size > shared_->capacity) {
+      unlink(PathOf(directory, item.key).c_str());
+      continue;
+    }
+    shared_->stored.push_front(Stored{item.key, size});
+    shared_->stored_size += size;
+    shared_->binaries[item.key] = std::move(item.binary);
+  }
+
+  LOG_INFO("Program binary cache: %zu binaries loaded, %" PRIu64
+           " of another driver deleted",
+      shared_->binaries.size(), stale_count);
+
+  return true;
+}
+
+void
+ProgramBinaryCache::Precompile(ShaderSources sources, Callback on_ready)
+{
+  if (upload_thread_ == nullptr) {
+    on_ready(Link(sources));
+    return;
+  }
+
+  // The worker pool stops before the upload thread does, so the upload task
+  // stores the binaries itself instead of posting them to the pool
+  auto program = std::make_shared<GLuint>(0);
+  upload_thread_->Enqueue(GlUploadThread::Upload{
+      [shared = shared_, sources = std::move(sources), program] {
+        const uint64_t key = KeyOf(sources);
+        std::shared_ptr<const Binary> binary;
+        *program = LinkProgram(shared.get(), key, sources, &binary);
+        if (binary) Store(shared.get(), key, *binary);
+      },
+      [program, on_ready = std::move(on_ready)] { on_ready(*program); },
+      0,
+  });
+}
+
+void
+ProgramBinaryCache::SetShaderSources(std::string vertex, std::string fragment)
+{
+  // zen-remote links a program of its own from the same sources when it
+  // first draws; this keeps the binary and has drivers that cache compiled
+  // shaders by their source, as Android's do, compile them here
+  Precompile({std::move(vertex), std::move(fragment)}, [](GLuint program) {
+    if (program != 0) glDeleteProgram(program);
+  });
+}
+
+GLuint
+ProgramBinaryCache::Link(const ShaderSources &sources)
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  const uint64_t key = KeyOf(sources);
+  std::shared_ptr<const Binary> binary;
+  GLuint program = LinkProgram(shared_.get(), key, sources, &binary);
+  if (binary) {
+    worker_pool_->Post([shared = shared_, key, binary] {
+      Store(shared.get(), key, *binary);
+    });
+  }
+
+  const auto time = std::chrono::steady_clock::now() - begin;
+
+  std::lock_guard<std::mutex> lock(shared_->mutex);
+  shared_->render_thread_links++;
+  shared_->max_render_thread_link_time =
+      std::max<std::chrono::nanoseconds>(
+          shared_->max_render_thread_link_time, time);
+
+  return program;
+}
+
+uint64_t
+ProgramBinaryCache::KeyOf(const ShaderSources &sources)
+{
+  std::string text;
+  text.reserve(sources.vertex.size() + sources.fragment.size() + 1);
+  text += sources.vertex;
+  text += '\0';
+  text += sources.fragment;
+
+  return ContentHash(text.data(), text.size());
+}
+
+GLuint
+ProgramBinaryCache::LinkProgram(Shared *shared, uint64_t key,
+    const ShaderSources &sources, std::shared_ptr<const Binary> *new_binary)
+{
+  auto begin = std::chrono::steady_clock::now();
+
+  std::shared_ptr<const Binary> binary;
+  {
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    auto it = shared->binaries.find(key);
+    if (it != shared->binaries.end()) binary = it->second;
+  }
+
+  if (binary) {
+    if (GLuint program = Load(*binary)) {
+      std::lock_guard<std::mutex> lock(shared->mutex);
+      shared->loaded++;
+      shared->load_time += std::chrono::steady_clock::now() - begin;
+      if ((shared->loaded + shared->compiled) % kStatsPeriodPrograms == 0) {
+        LogStats(shared);
+      }
+      return program;
+    }
+
+    // Drivers may reject binaries of theirs, e.g. after an update that kept
+    // the version string
+    LOG_WARN("Program binary %016" PRIx64 " was rejected; compiling", key);
+    std::lock_guard<std::mutex> lock(shared->mutex);
+    Erase(shared, key);
+  }
+
+  GLuint program = Compile(sources);
+  if (program == 0) return 0;
+
+  if (shared->is_supported) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+
+    auto compiled = std::make_shared<Binary>();
+    compiled->data.resize(length);
+    glGetProgramBinary(program, length, &length, &compiled->format,
+        compiled->data.data());
+    compiled->data.resize(length);
+
+    if (length > 0) *new_binary = std::move(compiled);
+  }
+
+  std::lock_guard<std::mutex> lock(shared->mutex);
+  if (*new_binary) shared->binaries[key] = *new_binary;
+  shared->compiled++;
+  shared->compile_time += std::chrono::steady_clock::now() - begin;
+  if ((shared->loaded + shared->compiled) % kStatsPeriodPrograms == 0) {
+    LogStats(shared);
+  }
+
+  return program;
+}
+
+GLuint
+ProgramBinaryCache::Load(const Binary &binary)
+{
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, binary.format, binary.data.data(),
+      (GLsizei)binary.data.size());
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  return program;
+}
+
+GLuint
+ProgramBinaryCache::Compile(const ShaderSources &sources)
+{
+  GLuint vertex_shader = CompileShader(GL_VERTEX_SHADER, sources.vertex);
+  GLuint fragment_shader = CompileShader(GL_FRAGMENT_SHADER, sources.fragment);
+  if (vertex_shader == 0 || fragment_shader == 0) {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return 0;
+  }
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertex_shader);
+  glAttachShader(program, fragment_shader);
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status == GL_FALSE) {
+    char log[512] = {};
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    LOG_WARN("Failed to link a program: %s", log);
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  return program;
+}
+
+void
+ProgramBinaryCache::Store(Shared *shared, uint64_t key, const Binary &binary)
+{
+  // Written aside and renamed into place, so that a binary is never partial
+  const std::string path = PathOf(shared->directory, key);
+  const std::string temporary_path = path + ".tmp" +
+      std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  int fd = open(temporary_path.c_str(),
+      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    LOG_WARN("Failed to create %s: %s", temporary_path.c_str(),
+        strerror(errno));
+    return;
+  }
+
+  FileHeader header{kMagic, binary.format, shared->driver_hash};
+  const bool is_written = WriteAll(fd, &header, sizeof(header)) &&
+                          WriteAll(fd, binary.data.data(), binary.data.size());
+  close(fd);
+
+  if (!is_written || rename(temporary_path.c_str(), path.c_str()) == -1) {
+    LOG_WARN("Failed to write %s: %s", path.c_str(), strerror(errno));
+    unlink(temporary_path.c_str());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(shared->mutex);
+
+  // Linked on two threads at once, or rejected and compiled again
+  auto it = std::find_if(shared->stored.begin(), shared->stored.end(),
+      [key](const Stored &stored) { return stored.key == key; });
+  if (it != shared->stored.end()) {
+    shared->stored_size -= it->size;
+    shared->stored.erase(it);
+  }
+
+  const uint64_t size = sizeof(header) + binary.data.size();
+  shared->stored.push_back(Stored{key, size});
+  shared->stored_size += size;
+
+  while (shared->stored_size > shared->capacity) {
+    Erase(shared, shared->stored.front().key);
+    shared->evictions++;
+  }
+}
+
+void
+ProgramBinaryCache::Erase(Shared *shared, uint64_t key)
+{
+  unlink(PathOf(shared->directory, key).c_str());
+  shared->binaries.erase(key);
+
+  auto it = std::find_if(shared->stored.begin(), shared->stored.end(),
+      [key](const Stored &stored) { return stored.key == key; });
+  if (it != shared->stored.end()) {
+    shared->stored_size -= it->size;
+    shared->stored.erase(it);
+  }
+}
+
+void
+ProgramBinaryCache::LogStats(Shared *shared)
+{
+  auto average_ms = [](std::chrono::nanoseconds time, uint64_t count) {
+    return count > 0 ? (float)time.count() / count / 1000000 : 0.f;
+  };
+
+  LOG_DEBUG("Programs: %" PRIu64 " loaded from binaries (%.2f ms each), "
+            "%" PRIu64 " compiled (%.2f ms each), %" PRIu64
+            " linked on the render thread (max %.2f ms); %.1f MiB of "
+            "binaries, %" PRIu64 " evicted",
+      shared->loaded, average_ms(shared->load_time, shared->loaded),
+      shared->compiled, average_ms(shared->compile_time, shared->compiled),
+      shared->render_thread_links,
+      (float)shared->max_render_thread_link_time.count() / 1000000,
+      (float)shared->stored_size / 1024 / 1024, shared->evictions);
+}
+
+}  // namespace zen::mirror
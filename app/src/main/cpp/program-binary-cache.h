@@ -0,0 +1,139 @@
+#pragma once
+
+#include "bulk-channel.h"
+#include "common.h"
+#include "gl-upload-thread.h"
+#include "worker-pool.h"
+
+namespace zen::mirror {
+
+struct ShaderSources {
+  std::string vertex;
+  std::string fragment;
+};
+
+/**
+ * Links GL programs ahead of their first draw, and keeps the linked binaries
+ * in app storage so that a program seen in an earlier run is loaded with
+ * glProgramBinary instead of compiled again. Binaries are keyed by the hash
+ * of the sources and tagged with the driver that produced them; Init deletes
+ * those of another driver. Beyond the capacity, the oldest binaries are
+ * deleted as new ones are stored.
+ *
+ * Precompiled programs are linked on the upload thread when there is one, so
+ * only the programs linked with Link stall the render thread.
+ *
+ * The sources of the bulk channel are precompiled for the binaries alone.
+ */
+class ProgramBinaryCache : public BulkChannel::IShaderSink {
+ public:
+  /* Called on the render thread with 0 on failure; the callee owns it */
+  using Callback = std::function<void(GLuint program)>;
+
+  DISABLE_MOVE_AND_COPY(ProgramBinaryCache);
+  ProgramBinaryCache(std::string directory, uint64_t capacity,
+      WorkerPool *worker_pool, GlUploadThread *upload_thread)
+      : worker_pool_(worker_pool),
+        upload_thread_(upload_thread),
+        shared_(std::make_shared<Shared>(std::move(directory), capacity))
+  {
+  }
+  ~ProgramBinaryCache() override = default;
+
+  /* Call with the GL context current; loads the binaries on disk */
+  bool Init();
+
+  /**
+   * Call on the render thread as soon as the sources are known. `on_ready`
+   * is called from the upload thread's Poll, or right away without one.
+   */
+  void Precompile(ShaderSources sources, Callback on_ready);
+
+  /**
+   * Call on the render thread for a program needed right away; it is linked
+   * with the GL context current.
+   * @returns 0 on failure
+   */
+  GLuint Link(const ShaderSources &sources);
+
+  void SetShaderSources(std::string vertex, std::string fragment) override;
+
+ private:
+  struct Binary {
+    GLenum format;
+    std::vector<uint8_t> data;
+  };
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t driver_hash;
+  };
+
+  struct Stored {
+    uint64_t key;
+    uint64_t size;  // of the file
+  };
+
+  /* Shared with the upload thread and the worker pool */
+  struct Shared {
+    DISABLE_MOVE_AND_COPY(Shared);
+    Shared(std::string directory, uint64_t capacity)
+        : directory(std::move(directory)), capacity(capacity)
+    {
+    }
+    ~Shared() = default;
+
+    const std::string directory;
+    const uint64_t capacity;
+    bool is_supported{false};  // set by Init
+    uint64_t driver_hash{0};   // set by Init
+
+    std::mutex mutex;
+    // The following are guarded by mutex
+    std::unordered_map<uint64_t, std::shared_ptr<const Binary>> binaries;
+    std::deque<Stored> stored;  // the files, the oldest first
+    uint64_t stored_size{0};
+    uint64_t evictions{0};
+    uint64_t loaded{0};
+    uint64_t compiled{0};
+    std::chrono::nanoseconds load_time{0};
+    std::chrono::nanoseconds compile_time{0};
+    uint64_t render_thread_links{0};
+    std::chrono::nanoseconds max_render_thread_link_time{0};
+  };
+
+  static constexpr uint32_t kMagic = 0x4e42505a;  // "ZPBN"
+
+  // Write out the stats every this many programs
+  static constexpr uint64_t kStatsPeriodPrograms = 20;
+
+  static uint64_t KeyOf(const ShaderSources &sources);
+
+  /**
+   * Call with a GL context current, on any thread. Sets `new_binary` if the
+   * program was compiled and its binary should be stored.
+   */
+  static GLuint LinkProgram(Shared *shared, uint64_t key,
+      const ShaderSources &sources, std::shared_ptr<const Binary> *new_binary);
+
+  /* @returns 0 if the driver rejects the binary */
+  static GLuint Load(const Binary &binary);
+
+  static GLuint Compile(const ShaderSources &sources);
+
+  /* Write the binary to disk and evict down to the capacity; blocking */
+  static void Store(Shared *shared, uint64_t key, const Binary &binary);
+
+  /* Delete the binary from disk and memory; call with shared->mutex locked */
+  static void Erase(Shared *shared, uint64_t key);
+
+  /* Call with shared->mutex locked */
+  static void LogStats(Shared *shared);
+
+  WorkerPool *worker_pool_;
+  GlUploadThread *upload_thread_;  // nullptr to link on the render thread
+  std::shared_ptr<Shared> shared_;
+};
+
+}  // namespace zen::mirror
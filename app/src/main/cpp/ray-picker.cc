@@ -0,0 +1,91 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "openxr-util.h"
+#include "ray-picker.h"
+
+namespace zen::mirror {
+
+void
+RayPicker::SetBounds(uint64_t id, const Aabb &bounds)
+{
+  bool inserted = bounds_.insert_or_assign(id, bounds).second;
+
+  if (inserted) {
+    needs_rebuild_ = true;
+  } else if (!needs_rebuild_) {
+    if (++refits_since_build_ > bounds_.size() * kRefitsPerRebuild) {
+      needs_rebuild_ = true;
+    } else {
+      bvh_.Refit(id, bounds);
+    }
+  }
+}
+
+void
+RayPicker::Remove(uint64_t id)
+{
+  if (bounds_.erase(id) > 0) needs_rebuild_ = true;
+
+  for (auto &hover : hovers_) {
+    if (hover.is_hit && hover.id == id) hover = Hover{};
+  }
+}
+
+void
+RayPicker::Pick(Hand hand, const XrPosef &aim_pose)
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  if (needs_rebuild_) Rebuild();
+
+  glm::vec3 origin = Math::ToGlm(aim_pose.position);
+  glm::vec3 direction =
+      Math::ToGlm(aim_pose.orientation) * glm::vec3(0, 0, -1);
+
+  Bvh::Hit hit;
+  Hover &hover = hovers_[(int)hand];
+  if (bvh_.Raycast(origin, direction, kMaxDistance, &hit)) {
+    hover.is_hit = true;
+    hover.id = hit.id;
+    hover.distance = hit.distance;
+    hover.point = Math::ToXr(origin + direction * hit.distance);
+  } else {
+    hover = Hover{};
+  }
+
+  pick_time_ += std::chrono::steady_clock::now() - begin;
+  if (++picks_ % kStatsPeriodPicks == 0) LogStats();
+}
+
+void
+RayPicker::Clear(Hand hand)
+{
+  hovers_[(int)hand] = Hover{};
+}
+
+void
+RayPicker::Rebuild()
+{
+  std::vector<Bvh::Primitive> primitives;
+  primitives.reserve(bounds_.size());
+  for (const auto &[id, bounds] : bounds_) {
+    primitives.push_back(Bvh::Primitive{id, bounds});
+  }
+
+  bvh_.Build(std::move(primitives));
+  needs_rebuild_ = false;
+  refits_since_build_ = 0;
+  rebuilds_++;
+}
+
+void
+RayPicker::LogStats()
+{
+  LOG_DEBUG("Ray picking: %.0f ns/pick over %zu objects (%zu nodes), %" PRIu64
+            " rebuilds",
+      (float)pick_time_.count() / picks_, bvh_.primitive_count(),
+      bvh_.node_count(), rebuilds_);
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "bvh.h"
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Answers controller ray queries against the bounds of the remote scene
+ * objects locally, so hover feedback does not wait for a round trip to the
+ * server. The server stays authoritative over the actual interaction.
+ *
+ * Bounds are fed as scene updates arrive. Moving a known object refits the
+ * tree; adding or removing one rebuilds it lazily on the next pick.
+ */
+class RayPicker {
+ public:
+  enum class Hand { kLeft = 0, kRight = 1, kCount = 2 };
+
+  struct Hover {
+    bool is_hit{false};
+    uint64_t id{0};
+    float distance{0};
+    XrVector3f point{};  // in the app space
+  };
+
+  DISABLE_MOVE_AND_COPY(RayPicker);
+  RayPicker() = default;
+  ~RayPicker() = default;
+
+  /* Add an object or move an existing one */
+  void SetBounds(uint64_t id, const Aabb &bounds);
+
+  void Remove(uint64_t id);
+
+  /* Cast the ray along -Z of the aim pose and update the hover of the hand */
+  void Pick(Hand hand, const XrPosef &aim_pose);
+
+  /* Forget the hover of a hand that is no longer tracked */
+  void Clear(Hand hand);
+
+  inline const Hover &hover(Hand hand) const;
+
+ private:
+  static constexpr float kMaxDistance = 10.f;  // meters
+
+  // Rebuild instead of refitting once this many refits per object have
+  // accumulated, as the tree gets looser with every refit
+  static constexpr size_t kRefitsPerRebuild = 8;
+
+  // Write out the cost per pick every this many picks
+  static constexpr uint64_t kStatsPeriodPicks = 5000;
+
+  void Rebuild();
+  void LogStats();
+
+  Bvh bvh_;
+  std::unordered_map<uint64_t, Aabb> bounds_;
+  bool needs_rebuild_{false};
+  size_t refits_since_build_{0};
+
+  std::array<Hover, (size_t)Hand::kCount> hovers_;
+
+  uint64_t picks_{0};
+  uint64_t rebuilds_{0};
+  std::chrono::nanoseconds pick_time_{0};
+};
+
+inline const RayPicker::Hover &
+RayPicker::hover(Hand hand) const
+{
+  return hovers_[(int)hand];
+}
+
+}  // namespace zen::mirror
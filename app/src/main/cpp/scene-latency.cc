@@ -0,0 +1,93 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "scene-latency.h"
+
+namespace zen::mirror {
+
+namespace {
+
+constexpr const char *kStageNames[] = {"network", "queue", "display", "total"};
+
+inline float
+ToMilliseconds(int64_t nanoseconds)
+{
+  return (float)nanoseconds / 1000000.f;
+}
+
+}  // namespace
+
+void
+SceneLatency::AddClockSyncSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3)
+{
+  clock_sync_.AddSample(t0, t1, t2, t3);
+}
+
+void
+SceneLatency::OnReceived(int64_t server_send_time, int64_t receive_time)
+{
+  if (pending_.size() >= kMaxPendingUpdates) pending_.pop_front();
+  pending_.push_back(Received{server_send_time, receive_time});
+}
+
+void
+SceneLatency::OnSceneUpdated(int64_t update_time, int64_t display_time)
+{
+  const bool is_synchronized = clock_sync_.is_synchronized();
+
+  for (auto &received : pending_) {
+    samples_[(int)Stage::kQueue].push_back(
+        update_time - received.receive_time);
+    samples_[(int)Stage::kDisplay].push_back(display_time - update_time);
+
+    if (!is_synchronized) continue;
+
+    int64_t send_time = clock_sync_.ToMirrorTime(received.server_send_time);
+    samples_[(int)Stage::kNetwork].push_back(
+        received.receive_time - send_time);
+    samples_[(int)Stage::kTotal].push_back(display_time - send_time);
+  }
+  pending_.clear();
+
+  if (samples_[(int)Stage::kQueue].size() >= kReportPeriodUpdates) Report();
+}
+
+void
+SceneLatency::Report()
+{
+  std::ostringstream message;
+  message << "Scene update latency (ms, p50/p90/p99/max):";
+
+  for (size_t i = 0; i < (size_t)Stage::kCount; i++) {
+    auto &samples = samples_[i];
+    auto &reported = reported_[i];
+    reported = {};
+    if (samples.empty()) continue;
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](float p) {
+      return samples[(size_t)(p * (samples.size() - 1))];
+    };
+    reported = {percentile(0.5f), percentile(0.9f), percentile(0.99f),
+        samples.back()};
+
+    char stage[96];
+    snprintf(stage, sizeof(stage), " %s %.1f/%.1f/%.1f/%.1f", kStageNames[i],
+        ToMilliseconds(reported.p50), ToMilliseconds(reported.p90),
+        ToMilliseconds(reported.p99), ToMilliseconds(reported.max));
+    message << stage;
+
+    samples.clear();
+  }
+
+  if (clock_sync_.is_synchronized()) {
+    char clock[64];
+    snprintf(clock, sizeof(clock), ", clock round trip %.2f",
+        ToMilliseconds(clock_sync_.round_trip()));
+    message << clock;
+  }
+
+  LOG_DEBUG("%s", message.str().c_str());
+}
+
+}  // namespace zen::mirror
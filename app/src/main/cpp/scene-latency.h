@@ -0,0 +1,81 @@
+#pragma once
+
+#include "bulk-channel.h"
+#include "clock-sync.h"
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * End-to-end latency of the updates from the server, split into stages:
+ *   network: sent by the server -> received by the mirror
+ *   queue:   received -> applied by UpdateScene
+ *   display: applied -> the predicted display time of the frame
+ *   total:   sent -> the predicted display time
+ *
+ * Times are of the mirror's monotonic clock in nanoseconds; server times are
+ * converted with the clock sync, and the stages that need them are skipped
+ * until it is synchronized. Percentiles of each stage are logged
+ * periodically. Call on the loop thread.
+ */
+class SceneLatency : public BulkChannel::ILatencySink {
+ public:
+  enum class Stage { kNetwork = 0, kQueue, kDisplay, kTotal, kCount };
+
+  /* In nanoseconds */
+  struct Percentiles {
+    int64_t p50;
+    int64_t p90;
+    int64_t p99;
+    int64_t max;
+  };
+
+  DISABLE_MOVE_AND_COPY(SceneLatency);
+  SceneLatency() = default;
+  ~SceneLatency() override = default;
+
+  void AddClockSyncSample(
+      int64_t t0, int64_t t1, int64_t t2, int64_t t3) override;
+
+  void OnReceived(int64_t server_send_time, int64_t receive_time) override;
+
+  /* The updates received so far are applied and will show at display_time */
+  void OnSceneUpdated(int64_t update_time, int64_t display_time);
+
+  inline ClockSync *clock_sync();
+
+  /* Of the last report; zero before it, or if it had no samples of `stage` */
+  inline const Percentiles &reported(Stage stage) const;
+
+ private:
+  struct Received {
+    int64_t server_send_time;
+    int64_t receive_time;
+  };
+
+  void Report();
+
+  // Write out the percentiles every this many updates received
+  static constexpr size_t kReportPeriodUpdates = 500;
+  // Drop the oldest received updates beyond this while nothing is rendered
+  static constexpr size_t kMaxPendingUpdates = 1024;
+
+  ClockSync clock_sync_;
+  std::deque<Received> pending_;
+  std::array<std::vector<int64_t>, (size_t)Stage::kCount> samples_;
+  std::array<Percentiles, (size_t)Stage::kCount> reported_{};
+};
+
+inline ClockSync *
+SceneLatency::clock_sync()
+{
+  return &clock_sync_;
+}
+
+inline const SceneLatency::Percentiles &
+SceneLatency::reported(Stage stage) const
+{
+  return reported_[(size_t)stage];
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,443 @@
+#include "pch.h"
+
+#include "logger.h"
+#include "spectator-stream.h"
+
+namespace zen::mirror {
+
+SpectatorStream::~SpectatorStream()
+{
+  if (thread_.joinable()) {
+    uint64_t count = 1;
+    write(stop_fd_, &count, sizeof(count));
+    thread_.join();
+  }
+
+  Disconnect();
+  if (listen_fd_ != -1) close(listen_fd_);
+  if (event_fd_ != -1) close(event_fd_);
+  if (stop_fd_ != -1) close(stop_fd_);
+
+  for (auto &slot : slots_) {
+    if (slot.state == SlotState::kEncoding) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack_buffer);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (slot.fence != nullptr) glDeleteSync(slot.fence);
+    if (slot.pack_buffer != 0) glDeleteBuffers(1, &slot.pack_buffer);
+    if (slot.framebuffer != 0) glDeleteFramebuffers(1, &slot.framebuffer);
+    if (slot.renderbuffer != 0) glDeleteRenderbuffers(1, &slot.renderbuffer);
+  }
+
+  if (gpu_memory_) gpu_memory_budget_->Release(*gpu_memory_);
+}
+
+bool
+SpectatorStream::Init(uint16_t port, int32_t eye_width, int32_t eye_height)
+{
+  if (rate_ <= 0 || width_ == 0 || eye_width <= 0 || eye_height <= 0) {
+    return false;
+  }
+
+  auto align = [](float size) {
+    return std::max(kAlignment,
+        (uint32_t)std::lround(size / kAlignment) * kAlignment);
+  };
+  width_ = align(width_);
+  height_ = align((float)width_ * eye_height / eye_width);
+
+  if (!encoder_->Init(width_, height_, rate_)) {
+    LOG_ERROR("Failed to initialize the spectator encoder");
+    return false;
+  }
+
+  const GLsizeiptr frame_size = (GLsizeiptr)width_ * height_ * 4;
+  for (auto &slot : slots_) {
+    glGenRenderbuffers(1, &slot.renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, slot.renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &slot.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, slot.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+        GL_RENDERBUFFER, slot.renderbuffer);
+
+    glGenBuffers(1, &slot.pack_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack_buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  // A renderbuffer and a pack buffer of a frame each
+  gpu_memory_ = gpu_memory_budget_->Track(
+      GpuMemoryCategory::kMirror, frame_size * 2 * kSlotCount);
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ == -1 || stop_fd_ == -1) {
+    LOG_ERROR("Failed to create the spectator events: %s", strerror(errno));
+    return false;
+  }
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd_ == -1) {
+    LOG_ERROR("Failed to create the spectator socket: %s", strerror(errno));
+    return false;
+  }
+
+  int reuse = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  // Local only; viewers come in through adb forward
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+
+  if (bind(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+          sizeof(address)) == -1 ||
+      listen(listen_fd_, 1) == -1) {
+    LOG_ERROR("Failed to listen on the spectator port %u: %s", port,
+        strerror(errno));
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  socklen_t address_length = sizeof(address);
+  getsockname(
+      listen_fd_, reinterpret_cast<sockaddr *>(&address), &address_length);
+  port_ = ntohs(address.sin_port);
+
+  thread_ = std::thread(&SpectatorStream::Run, this);
+
+  LOG_INFO("Spectator stream of %ux%u at %.0f Hz on port %u", width_,
+      height_, rate_, port_);
+
+  return true;
+}
+
+void
+SpectatorStream::Capture(
+    GLuint framebuffer, int32_t width, int32_t height, int64_t time)
+{
+  const auto begin = std::chrono::steady_clock::now();
+
+  Collect();
+
+  if (is_viewer_connected_.load(std::memory_order_relaxed) &&
+      time >= next_capture_time_) {
+    // Keep the average rate, but do not make up for a pause
+    const int64_t interval = (int64_t)(1e9f / rate_);
+    next_capture_time_ += interval;
+    if (next_capture_time_ <= time) next_capture_time_ = time + interval;
+
+    Slot &slot = slots_[next_slot_];
+    if (slot.state == SlotState::kFree) {
+      // Flipped so that rows come out top-down
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+      glBindFramebuffer(GL_DRAW_FRAMEBUFFER, slot.framebuffer);
+      glBlitFramebuffer(0, 0, width, height, 0, height_, width_, 0,
+          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+      glBindFramebuffer(GL_READ_FRAMEBUFFER, slot.framebuffer);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack_buffer);
+      glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+      slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      slot.state = SlotState::kReading;
+      slot.time = time;
+      next_slot_ = (next_slot_ + 1) % kSlotCount;
+      captures_++;
+    } else {
+      skipped_captures_++;
+    }
+  }
+
+  capture_calls_++;
+  capture_time_ += std::chrono::steady_clock::now() - begin;
+  if (begin - last_capture_stats_ >= kStatsPeriod) {
+    if (captures_ > 0) LogCaptureStats();
+    last_capture_stats_ = begin;
+  }
+}
+
+void
+SpectatorStream::Collect()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    collected_.swap(encoded_);
+  }
+
+  for (size_t index : collected_) {
+    Slot &slot = slots_[index];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack_buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.state = SlotState::kFree;
+  }
+  collected_.clear();
+
+  // Oldest first, so the encoder gets the frames in order
+  bool is_queued = false;
+  for (size_t i = 0; i < kSlotCount; i++) {
+    const size_t index = (next_slot_ + i) % kSlotCount;
+    Slot &slot = slots_[index];
+    if (slot.state != SlotState::kReading) continue;
+
+    GLenum result = glClientWaitSync(slot.fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) break;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    void *data = nullptr;
+    if (result != GL_WAIT_FAILED) {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pack_buffer);
+      data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+          (GLsizeiptr)width_ * height_ * 4, GL_MAP_READ_BIT);
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    if (data == nullptr) {
+      LOG_WARN("Failed to read back a spectator frame");
+      slot.state = SlotState::kFree;
+      continue;
+    }
+
+    slot.state = SlotState::kEncoding;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      frames_.push_back(
+          Frame{index, static_cast<const uint8_t *>(data), slot.time});
+    }
+    is_queued = true;
+  }
+
+  if (is_queued) {
+    uint64_t count = 1;
+    write(event_fd_, &count, sizeof(count));
+  }
+}
+
+void
+SpectatorStream::Run()
+{
+  std::array<pollfd, 4> fds{};
+  fds[0] = {stop_fd_, POLLIN, 0};
+  fds[1] = {event_fd_, POLLIN, 0};
+  fds[2] = {listen_fd_, POLLIN, 0};
+
+  while (true) {
+    fds[3] = {connection_fd_, POLLIN, 0};  // ignored while -1
+    if (poll(fds.data(), fds.size(), -1) == -1) {
+      if (errno == EINTR) continue;
+      LOG_ERROR("Spectator stream stopped: %s", strerror(errno));
+      return;
+    }
+
+    if (fds[0].revents & POLLIN) return;
+
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      read(event_fd_, &count, sizeof(count));
+
+      std::deque<Frame> frames;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames.swap(frames_);
+      }
+
+      // Only the latest frame matters to a viewer that fell behind
+      if (!frames.empty()) Encode(frames.back());
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &frame : frames) encoded_.push_back(frame.slot);
+      }
+    }
+
+    if (fds[2].revents & POLLIN) Accept();
+
+    if (is_stopped_) return;
+
+    // Viewers send nothing; readable means closed
+    if (fds[3].fd == connection_fd_ && fds[3].revents != 0) {
+      uint8_t buffer[256];
+      ssize_t size = recv(connection_fd_, buffer, sizeof(buffer), 0);
+      if (size == 0 || (size == -1 && errno != EAGAIN && errno != EINTR)) {
+        Disconnect();
+      }
+    }
+  }
+}
+
+void
+SpectatorStream::Accept()
+{
+  int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (fd == -1) return;
+
+  if (connection_fd_ != -1) {
+    LOG_WARN("Refused a spectator while another is connected");
+    close(fd);
+    return;
+  }
+  connection_fd_ = fd;
+
+  if (!encoder_->Start()) {
+    LOG_ERROR("Failed to start the spectator encoder");
+    Disconnect();
+    return;
+  }
+
+  Hello hello{kMagic, kVersion, (uint32_t)encoder_->codec(), width_, height_,
+      0};
+  if (!SendAll(&hello, sizeof(hello))) return;
+
+  is_waiting_for_key_frame_ = true;
+  is_viewer_connected_.store(true, std::memory_order_relaxed);
+  LOG_INFO("Spectator connected");
+}
+
+void
+SpectatorStream::Disconnect()
+{
+  if (connection_fd_ == -1) return;
+
+  close(connection_fd_);
+  connection_fd_ = -1;
+  is_viewer_connected_.store(false, std::memory_order_relaxed);
+  encoder_->Stop();
+  LOG_INFO("Spectator disconnected");
+}
+
+void
+SpectatorStream::Encode(const Frame &frame)
+{
+  if (connection_fd_ == -1) return;
+
+  const auto begin = std::chrono::steady_clock::now();
+
+  packets_.clear();
+  if (!encoder_->Encode(frame.data, frame.time, &packets_)) {
+    LOG_ERROR("Failed to encode a spectator frame");
+    Disconnect();
+    return;
+  }
+
+  encoded_frames_++;
+  encode_time_ += std::chrono::steady_clock::now() - begin;
+
+  for (const auto &packet : packets_) {
+    if (is_waiting_for_key_frame_ && !packet.is_key_frame) continue;
+    is_waiting_for_key_frame_ = false;
+
+    PacketHeader header{packet.time, (uint32_t)packet.data.size(),
+        packet.is_key_frame ? kKeyFrame : 0};
+    if (!SendAll(&header, sizeof(header)) ||
+        !SendAll(packet.data.data(), packet.data.size())) {
+      return;
+    }
+    sent_bytes_ += sizeof(header) + packet.data.size();
+  }
+
+  if (begin - last_encode_stats_ >= kStatsPeriod) {
+    LogEncodeStats();
+    last_encode_stats_ = begin;
+  }
+}
+
+bool
+SpectatorStream::SendAll(const void *data, size_t size)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t sent = send(connection_fd_, bytes, size, MSG_NOSIGNAL);
+    if (sent >= 0) {
+      bytes += sent;
+      size -= sent;
+      continue;
+    }
+    if (errno == EINTR) continue;
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      LOG_WARN("Failed to send to the spectator: %s", strerror(errno));
+      Disconnect();
+      return false;
+    }
+
+    // Wait for room, but never past a stop
+    std::array<pollfd, 2> fds{};
+    fds[0] = {stop_fd_, POLLIN, 0};
+    fds[1] = {connection_fd_, POLLOUT, 0};
+    int count = poll(fds.data(), fds.size(),
+        std::chrono::milliseconds(kSendTimeout).count());
+    if (count == -1 && errno == EINTR) continue;
+    if (fds[0].revents & POLLIN) {
+      is_stopped_ = true;
+      return false;
+    }
+    if (count <= 0) {
+      LOG_WARN("Dropped a spectator not taking the stream");
+      Disconnect();
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+SpectatorStream::LogCaptureStats()
+{
+  LOG_DEBUG("Spectator capture: %.1f us/frame on the render thread, %" PRIu64
+            " captured, %" PRIu64 " skipped without a free slot",
+      (float)capture_time_.count() / 1000 / capture_calls_, captures_,
+      skipped_captures_);
+}
+
+void
+SpectatorStream::LogEncodeStats()
+{
+  LOG_DEBUG("Spectator stream: %.2f ms/frame encoding, %.1f KiB/frame sent",
+      (float)encode_time_.count() / 1000000 / encoded_frames_,
+      (float)sent_bytes_ / 1024 / encoded_frames_);
+}
+
+bool
+SpectatorStream::RawEncoder::Init(
+    uint32_t width, uint32_t height, float /*rate*/)
+{
+  size_ = (size_t)width * height * 4;
+  return true;
+}
+
+bool
+SpectatorStream::RawEncoder::Start()
+{
+  return true;
+}
+
+void
+SpectatorStream::RawEncoder::Stop()
+{
+}
+
+SpectatorStream::Codec
+SpectatorStream::RawEncoder::codec() const
+{
+  return Codec::kRawRgba;
+}
+
+bool
+SpectatorStream::RawEncoder::Encode(
+    const uint8_t *rgba, int64_t time, std::vector<Packet> *packets)
+{
+  packets->push_back(
+      Packet{time, true, std::vector<uint8_t>(rgba, rgba + size_)});
+  return true;
+}
+
+}  // namespace zen::mirror
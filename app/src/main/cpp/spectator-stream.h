@@ -0,0 +1,249 @@
+#pragma once
+
+#include "common.h"
+#include "gpu-memory-budget.h"
+
+namespace zen::mirror {
+
+/**
+ * Spectator video of the left eye for casting, without the cost of the
+ * system cast re-encoding the composited output.
+ *
+ * On the render thread, Capture blits the eye buffer down and flipped
+ * upright into the next slot of a ring, starts an asynchronous read into the
+ * slot's pixel pack buffer and fences it. The slot is mapped once its fence
+ * has signaled, and the encoder thread reads the frame straight from the
+ * mapping. Nothing on the render thread waits for the GPU or the encoder; a
+ * capture is skipped when no slot is free. Nothing is captured while no
+ * viewer is connected, and the encoder only runs while one is.
+ *
+ * One viewer is served at a time on a TCP port, e.g. through adb forward. On
+ * connection, the stream sends a hello, in host byte order:
+ *   uint32 magic (kMagic)
+ *   uint32 version (kVersion)
+ *   uint32 codec (Codec)
+ *   uint32 width
+ *   uint32 height
+ *   uint32 reserved
+ * followed by packets:
+ *   int64  time of the captured frame, on the monotonic clock in nanoseconds
+ *   uint32 size
+ *   uint32 flags (kKeyFrame)
+ *   uint8  data[size]
+ * The first packet sent to a viewer is a key frame.
+ */
+class SpectatorStream {
+ public:
+  struct IEncoder;
+  class RawEncoder;
+
+  enum class Codec : uint32_t {
+    kRawRgba = 0,  // top-down rows of RGBA8 pixels
+    kH264 = 1,     // Annex B; key frames carry the parameter sets
+  };
+
+  static constexpr uint32_t kMagic = 0x4350535a;  // "ZSPC"
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kKeyFrame = 1;
+
+  struct Packet {
+    int64_t time;
+    bool is_key_frame;
+    std::vector<uint8_t> data;
+  };
+
+  DISABLE_MOVE_AND_COPY(SpectatorStream);
+  SpectatorStream(std::unique_ptr<IEncoder> encoder,
+      GpuMemoryBudget *gpu_memory_budget, uint32_t width, float rate)
+      : encoder_(std::move(encoder)),
+        gpu_memory_budget_(gpu_memory_budget),
+        width_(width),
+        rate_(rate)
+  {
+  }
+
+  /* Call with the GL context current */
+  ~SpectatorStream();
+
+  /**
+   * Listen on `port`, or on an ephemeral port if 0, and start the encoder
+   * thread. The height of the video follows the aspect of `eye_width` x
+   * `eye_height`. Call with the GL context current.
+   */
+  bool Init(uint16_t port, int32_t eye_width, int32_t eye_height);
+
+  /**
+   * Call on the render thread every frame, right after the left eye is
+   * rendered to the `width` x `height` area of `framebuffer`. Captures at
+   * most at the given rate; `time` is the monotonic display time of the
+   * frame in nanoseconds.
+   */
+  void Capture(GLuint framebuffer, int32_t width, int32_t height, int64_t time);
+
+  /* Available after Init succeeds */
+  inline uint16_t port() const;
+  inline uint32_t height() const;
+
+ private:
+  struct Hello {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t codec;
+    uint32_t width;
+    uint32_t height;
+    uint32_t reserved;
+  };
+
+  struct PacketHeader {
+    int64_t time;
+    uint32_t size;
+    uint32_t flags;
+  };
+
+  enum class SlotState {
+    kFree,
+    kReading,   // fenced; the GPU is writing the pack buffer
+    kEncoding,  // mapped and handed to the encoder thread
+  };
+
+  struct Slot {
+    GLuint renderbuffer{0};
+    GLuint framebuffer{0};
+    GLuint pack_buffer{0};
+    GLsync fence{nullptr};
+    SlotState state{SlotState::kFree};
+    int64_t time{0};
+  };
+
+  /* A mapped slot for the encoder thread */
+  struct Frame {
+    size_t slot;
+    const uint8_t *data;
+    int64_t time;
+  };
+
+  static constexpr size_t kSlotCount = 3;
+
+  // Encoders take sizes of whole macroblocks best
+  static constexpr uint32_t kAlignment = 16;
+
+  // A viewer not taking a packet within this long is dropped
+  static constexpr std::chrono::seconds kSendTimeout{1};
+
+  // Write out the stats at most this often
+  static constexpr std::chrono::seconds kStatsPeriod{10};
+
+  /* Unmap the slots the encoder is done with and hand over the finished */
+  void Collect();
+
+  /* The encoder thread */
+  void Run();
+  void Accept();
+  void Disconnect();
+  void Encode(const Frame &frame);
+
+  /* Disconnects the viewer on failure; see is_stopped_ for a stop */
+  bool SendAll(const void *data, size_t size);
+
+  void LogCaptureStats();
+  void LogEncodeStats();
+
+  std::unique_ptr<IEncoder> encoder_;
+  GpuMemoryBudget *gpu_memory_budget_;
+  std::optional<GpuMemoryBudget::Handle> gpu_memory_;  // of the slots
+  uint32_t width_;    // aligned in Init
+  const float rate_;  // captures per second
+  uint32_t height_{0};
+  uint16_t port_{0};
+
+  // Render thread
+  std::array<Slot, kSlotCount> slots_;
+  size_t next_slot_{0};
+  int64_t next_capture_time_{0};
+  std::vector<size_t> collected_;  // swapped with encoded_
+  uint64_t capture_calls_{0};
+  uint64_t captures_{0};
+  uint64_t skipped_captures_{0};
+  std::chrono::nanoseconds capture_time_{0};
+  std::chrono::steady_clock::time_point last_capture_stats_{};
+
+  // Encoder thread
+  std::thread thread_;
+  int listen_fd_{-1};
+  int connection_fd_{-1};
+  bool is_waiting_for_key_frame_{true};
+  bool is_stopped_{false};  // stop_fd_ was signaled in the middle of a send
+  std::vector<Packet> packets_;  // reused for every frame
+  uint64_t encoded_frames_{0};
+  uint64_t sent_bytes_{0};
+  std::chrono::nanoseconds encode_time_{0};
+  std::chrono::steady_clock::time_point last_encode_stats_{};
+
+  std::atomic<bool> is_viewer_connected_{false};
+  int event_fd_{-1};  // signaled when frames are queued
+  int stop_fd_{-1};   // signaled to stop the encoder thread
+  std::mutex mutex_;
+  std::deque<Frame> frames_;     // guarded by mutex_
+  std::vector<size_t> encoded_;  // slots done with; guarded by mutex_
+};
+
+inline uint16_t
+SpectatorStream::port() const
+{
+  return port_;
+}
+
+inline uint32_t
+SpectatorStream::height() const
+{
+  return height_;
+}
+
+struct SpectatorStream::IEncoder {
+  DISABLE_MOVE_AND_COPY(IEncoder);
+  IEncoder() = default;
+  virtual ~IEncoder() = default;
+
+  /* Called once before the encoder thread starts */
+  virtual bool Init(uint32_t width, uint32_t height, float rate) = 0;
+
+  /**
+   * Called on the encoder thread when a viewer connects; the first packet
+   * after should be a key frame
+   */
+  virtual bool Start() = 0;
+
+  /* Called on the encoder thread when the viewer leaves, and on destruction */
+  virtual void Stop() = 0;
+
+  virtual Codec codec() const = 0;
+
+  /**
+   * Called on the encoder thread with top-down rows of `width` RGBA8 pixels.
+   * Append the packets ready so far to `packets`, which may stay empty while
+   * the encoder holds frames back.
+   * @returns false if the encoder failed
+   */
+  virtual bool Encode(
+      const uint8_t *rgba, int64_t time, std::vector<Packet> *packets) = 0;
+};
+
+/* Uncompressed frames, for hosts without a hardware encoder */
+class SpectatorStream::RawEncoder final : public IEncoder {
+ public:
+  DISABLE_MOVE_AND_COPY(RawEncoder);
+  RawEncoder() = default;
+  ~RawEncoder() override = default;
+
+  bool Init(uint32_t width, uint32_t height, float rate) override;
+  bool Start() override;
+  void Stop() override;
+  Codec codec() const override;
+  bool Encode(const uint8_t *rgba, int64_t time,
+      std::vector<Packet> *packets) override;
+
+ private:
+  size_t size_{0};
+};
+
+}  // namespace zen::mirror
@@ -0,0 +1,153 @@
+#include "pch.h"
+
+#include "openxr-util.h"
+#include "transform-timeline.h"
+
+namespace zen::mirror {
+
+void
+TransformTimeline::Push(
+    uint64_t id, int64_t time, int64_t receive_time, const XrPosef &pose)
+{
+  auto [it, inserted] = indices_.try_emplace(id, tracks_.size());
+  if (inserted) {
+    ids_.push_back(id);
+    tracks_.emplace_back();
+    tracks_.back().evaluated = pose;
+  }
+
+  Track &track = tracks_[it->second];
+
+  if (track.count > 0) {
+    const int64_t last_time = track.history[track.count - 1].time;
+    if (time <= last_time) {
+      dropped_count_++;
+      return;
+    }
+    interval_ += ((float)(time - last_time) - interval_) * kEstimateGain;
+  }
+
+  // Variation of the transit time, which is the jitter as long as the clock
+  // offset holds still
+  const int64_t transit = receive_time - time;
+  if (last_transit_) {
+    const float variation = (float)std::abs(transit - *last_transit_);
+    jitter_ += (variation - jitter_) * kEstimateGain;
+  }
+  last_transit_ = transit;
+
+  newest_time_ = std::max(newest_time_.value_or(time), time);
+
+  if (track.count == track.history.size()) {
+    std::move(track.history.begin() + 1, track.history.end(),
+        track.history.begin());
+    track.count--;
+  }
+  track.history[track.count++] = TimedPose{time, pose};
+}
+
+void
+TransformTimeline::Remove(uint64_t id)
+{
+  auto it = indices_.find(id);
+  if (it == indices_.end()) return;
+
+  // Swap with the last one to keep the arrays packed
+  const size_t index = it->second;
+  const size_t last = tracks_.size() - 1;
+  if (index != last) {
+    tracks_[index] = tracks_[last];
+    ids_[index] = ids_[last];
+    indices_[ids_[index]] = index;
+  }
+  tracks_.pop_back();
+  ids_.pop_back();
+  indices_.erase(it);
+}
+
+void
+TransformTimeline::Evaluate(int64_t display_time)
+{
+  UpdateDelay(display_time);
+
+  const int64_t time = display_time - interpolation_delay();
+
+  for (auto &track : tracks_) {
+    if (track.count == 0) continue;
+
+    bool extrapolated = false;
+    track.evaluated = Sample(track, time, &extrapolated);
+    if (extrapolated) extrapolated_count_++;
+  }
+}
+
+const XrPosef *
+TransformTimeline::pose(uint64_t id) const
+{
+  auto it = indices_.find(id);
+  if (it == indices_.end()) return nullptr;
+
+  return &tracks_[it->second].evaluated;
+}
+
+XrPosef
+TransformTimeline::Sample(const Track &track, int64_t time, bool *extrapolated)
+{
+  const TimedPose *history = track.history.data();
+  const size_t count = track.count;
+
+  if (time <= history[0].time || count == 1) return history[0].pose;
+
+  const TimedPose *from;
+  const TimedPose *to;
+  int64_t target = time;
+
+  if (time >= history[count - 1].time) {
+    // Continue the latest motion, for kMaxExtrapolation at most
+    from = &history[count - 2];
+    to = &history[count - 1];
+    target = std::min(time, to->time + kMaxExtrapolation);
+    *extrapolated = time > to->time;
+  } else {
+    size_t i = 1;
+    while (history[i].time < time) i++;
+    from = &history[i - 1];
+    to = &history[i];
+  }
+
+  const float t =
+      (float)(target - from->time) / (float)(to->time - from->time);
+
+  glm::vec3 position = glm::mix(Math::ToGlm(from->pose.position),
+      Math::ToGlm(to->pose.position), t);
+
+  // Rotations are not extrapolated; a wrong guess of them is more visible
+  glm::quat orientation =
+      glm::slerp(Math::ToGlm(from->pose.orientation),
+          Math::ToGlm(to->pose.orientation), std::min(t, 1.f));
+
+  return Math::ToXrPosef(position, orientation);
+}
+
+void
+TransformTimeline::UpdateDelay(int64_t display_time)
+{
+  if (!newest_time_) return;
+
+  // Sawtooths between the transit time plus the lead of the display time
+  // and that plus the update interval
+  const float age = (float)(display_time - *newest_time_);
+  age_ = age_ == 0.f ? age : age_ + (age - age_) * kEstimateGain;
+
+  const float delay = age_ + interval_ / 2.f + kJitterMargin * jitter_;
+  const int64_t target = std::clamp((int64_t)delay, kMinDelay, kMaxDelay);
+
+  if (!delay_) {
+    delay_ = target;
+  } else {
+    delay_ = std::clamp(
+        target, *delay_ - kMaxDelayStep, *delay_ + kMaxDelayStep);
+  }
+}
+
+}  // namespace zen::mirror
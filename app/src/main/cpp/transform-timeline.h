@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/**
+ * Timestamped transforms of remote objects, evaluated at the predicted
+ * display time of each frame instead of whenever the frame happens to run.
+ *
+ * Evaluation lags the display time by an interpolation delay that follows
+ * the age of the newest update at display time, the update interval and the
+ * network jitter, so that there is usually a newer update to interpolate
+ * towards. Past the newest update, the motion is
+ * extrapolated for a short while and then held.
+ *
+ * Times are of the mirror's monotonic clock in nanoseconds; convert server
+ * times with ClockSync.
+ */
+class TransformTimeline {
+ public:
+  DISABLE_MOVE_AND_COPY(TransformTimeline);
+  TransformTimeline() = default;
+  ~TransformTimeline() = default;
+
+  /* Updates older than the newest one of the object are dropped */
+  void Push(uint64_t id, int64_t time, int64_t receive_time,
+      const XrPosef &pose);
+
+  void Remove(uint64_t id);
+
+  /* Evaluate every object at `display_time` minus the interpolation delay */
+  void Evaluate(int64_t display_time);
+
+  /**
+   * @returns the pose evaluated last, or nullptr if the object is unknown.
+   * Valid until the next call of a non-const member.
+   */
+  const XrPosef *pose(uint64_t id) const;
+
+  inline int64_t interpolation_delay() const;
+  inline uint64_t extrapolated_count() const;
+  inline uint64_t dropped_count() const;
+
+ private:
+  struct TimedPose {
+    int64_t time;
+    XrPosef pose;
+  };
+
+  struct Track {
+    std::array<TimedPose, 8> history;  // in ascending order of time
+    size_t count{0};
+    XrPosef evaluated;
+  };
+
+  static XrPosef Sample(const Track &track, int64_t time, bool *extrapolated);
+
+  void UpdateDelay(int64_t display_time);
+
+  static constexpr int64_t kMinDelay = 5'000'000;
+  static constexpr int64_t kMaxDelay = 250'000'000;
+  static constexpr int64_t kMaxExtrapolation = 50'000'000;
+  // Change the delay at most this much per evaluation; a faster change
+  // shows as the motion speeding up or slowing down
+  static constexpr int64_t kMaxDelayStep = 100'000;
+  // Gain of the running estimates, as in RFC 3550
+  static constexpr float kEstimateGain = 1.f / 16.f;
+  // Cover this many times the jitter with the interpolation delay
+  static constexpr float kJitterMargin = 3.f;
+
+  std::unordered_map<uint64_t, size_t> indices_;
+  std::vector<uint64_t> ids_;
+  std::vector<Track> tracks_;
+
+  std::optional<int64_t> last_transit_;
+  std::optional<int64_t> newest_time_;  // of the updates of all objects
+  float age_{0.f};     // of the newest update at display time, nanoseconds
+  float jitter_{0.f};    // in nanoseconds
+  float interval_{0.f};  // between updates of an object, in nanoseconds
+  std::optional<int64_t> delay_;
+
+  uint64_t extrapolated_count_{0};
+  uint64_t dropped_count_{0};
+};
+
+inline int64_t
+TransformTimeline::interpolation_delay() const
+{
+  return delay_.value_or(kMinDelay);
+}
+
+inline uint64_t
+TransformTimeline::extrapolated_count() const
+{
+  return extrapolated_count_;
+}
+
+inline uint64_t
+TransformTimeline::dropped_count() const
+{
+  return dropped_count_;
+}
+
+}  // namespace zen::mirror
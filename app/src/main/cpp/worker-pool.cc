@@ -0,0 +1,53 @@
+#include "pch.h"
+
+#include "worker-pool.h"
+
+namespace zen::mirror {
+
+WorkerPool::WorkerPool(size_t thread_count)
+{
+  threads_.reserve(thread_count);
+  for (size_t i = 0; i < thread_count; i++) {
+    threads_.emplace_back(&WorkerPool::Run, this);
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_all();
+
+  for (auto &thread : threads_) thread.join();
+}
+
+void
+WorkerPool::Post(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  condition_.notify_one();
+}
+
+void
+WorkerPool::Run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return is_stopping_ || !tasks_.empty(); });
+    if (is_stopping_) return;
+
+    auto task = std::move(tasks_.front());
+    tasks_.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+  }
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror {
+
+/* Fixed set of threads running posted tasks, started in order of posting */
+class WorkerPool {
+ public:
+  DISABLE_MOVE_AND_COPY(WorkerPool);
+  WorkerPool(size_t thread_count);
+
+  /* Tasks not started yet are dropped */
+  ~WorkerPool();
+
+  /* Thread safe */
+  void Post(std::function<void()> task);
+
+ private:
+  void Run();
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<std::function<void()>> tasks_;  // guarded by mutex_
+  bool is_stopping_{false};                  // guarded by mutex_
+};
+
+}  // namespace zen::mirror
@@ -0,0 +1,223 @@
+#include "pch.h"
+
+#include "bulk-channel.h"
+#include "bulk-server-stand-in.h"
+#include "lz4-block-encoder.h"
+#include "poll-loop.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr size_t kBlobSize = 4 * 1024 * 1024;
+constexpr uint64_t kBlobCount = 64;
+constexpr uint64_t kSceneBlobCount = 4;
+
+/* Vertices of a grid mesh, position, normal and uv, as a typical blob */
+std::vector<uint8_t>
+GenerateMesh()
+{
+  std::vector<float> vertices;
+  for (size_t i = 0; vertices.size() * sizeof(float) < kBlobSize; i++) {
+    const float x = (float)(i % 256) / 256;
+    const float z = (float)(i / 256) / 256;
+    const float y = 0.1f * sinf(x * 10) * cosf(z * 10);
+    vertices.insert(vertices.end(), {x, y, z, 0, 1, 0, x, z});
+  }
+
+  std::vector<uint8_t> mesh(kBlobSize);
+  memcpy(mesh.data(), vertices.data(), kBlobSize);
+  return mesh;
+}
+
+/* Blobs whose first bytes are the id, followed by the mesh */
+std::vector<uint8_t>
+GenerateBlob(uint64_t id, const std::vector<uint8_t> &mesh)
+{
+  std::vector<uint8_t> blob = mesh;
+  memcpy(blob.data(), &id, sizeof(id));
+  return blob;
+}
+
+class Sink : public BulkChannel::ISink {
+ public:
+  Sink(const std::vector<uint8_t> *mesh) : mesh_(mesh) {}
+
+  void *BeginBlob(uint64_t id, uint64_t size) override
+  {
+    EXPECT(size == kBlobSize);
+    auto &blob = blobs_[id];
+    blob.resize(size);
+    return blob.data();
+  }
+
+  void EndBlob(uint64_t id) override
+  {
+    auto &blob = blobs_[id];
+    EXPECT(memcmp(blob.data(), &id, sizeof(id)) == 0);
+    EXPECT(memcmp(blob.data() + sizeof(id), mesh_->data() + sizeof(id),
+               kBlobSize - sizeof(id)) == 0);
+    blobs_.erase(id);
+    ended++;
+  }
+
+  void AbortBlob(uint64_t /*id*/) override { aborted++; }
+
+  uint64_t ended{0};
+  uint64_t aborted{0};
+
+ private:
+  const std::vector<uint8_t> *mesh_;
+  std::unordered_map<uint64_t, std::vector<uint8_t>> blobs_;
+};
+
+/* The server's end of a link of `bits_per_second`, unlimited for 0 */
+class Link {
+ public:
+  Link(int fd, double bits_per_second)
+      : fd_(fd),
+        bits_per_second_(bits_per_second),
+        begin_(std::chrono::steady_clock::now())
+  {
+  }
+
+  void Write(const void *data, size_t size)
+  {
+    constexpr size_t kChunkSize = 64 * 1024;
+    auto bytes = static_cast<const uint8_t *>(data);
+    for (size_t offset = 0; offset < size; offset += kChunkSize) {
+      const size_t chunk_size = std::min(kChunkSize, size - offset);
+      test::WriteAll(fd_, bytes + offset, chunk_size);
+      written_ += chunk_size;
+      if (bits_per_second_ == 0) continue;
+      std::this_thread::sleep_until(
+          begin_ + std::chrono::duration<double>(
+                       (double)written_ * 8 / bits_per_second_));
+    }
+  }
+
+  uint64_t written() const { return written_; }
+
+ private:
+  int fd_;
+  double bits_per_second_;
+  std::chrono::steady_clock::time_point begin_;
+  uint64_t written_{0};
+};
+
+struct Result {
+  double seconds;  // from the first byte written until the last blob ended
+  uint64_t wire_bytes;
+};
+
+/* Stream the first `blob_count` blobs to a fresh channel, each as in
+ * `frames` */
+Result
+Stream(const std::vector<uint8_t> &mesh,
+    const std::vector<std::vector<uint8_t>> &frames, BulkChannel::Codec codec,
+    uint64_t blob_count, double bits_per_second)
+{
+  WorkerPool worker_pool(2);
+  auto loop = std::make_shared<test::PollLoop>();
+  BulkChannel channel(loop, &worker_pool, 65536, kBlobSize);
+  EXPECT(channel.Init(0));
+  auto sink = std::make_shared<Sink>(&mesh);
+  channel.set_sink(sink);
+
+  std::atomic_bool is_done{false};
+  uint64_t wire_bytes = 0;
+  std::chrono::steady_clock::time_point begin;
+
+  std::thread server([&] {
+    int fd = test::ConnectToBulkChannel(channel.port());
+    test::ReadBulkHello(fd);
+    begin = std::chrono::steady_clock::now();
+    Link link(fd, bits_per_second);
+    for (uint64_t id = 0; id < blob_count; id++) {
+      const auto &frame = frames[id];
+      test::BulkFrameHeader header{id, frame.size(), kBlobSize, 0,
+          (uint32_t)codec, (uint32_t)BulkChannel::FrameType::kBlob};
+      link.Write(&header, sizeof(header));
+      link.Write(frame.data(), frame.size());
+    }
+    wire_bytes = link.written();
+    while (!is_done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    close(fd);
+  });
+
+  while (sink->ended + sink->aborted < blob_count) {
+    loop->Poll(std::chrono::milliseconds(100));
+  }
+  const auto end = std::chrono::steady_clock::now();
+  is_done = true;
+  server.join();
+
+  EXPECT(sink->ended == blob_count);
+  return {std::chrono::duration<double>(end - begin).count(), wire_bytes};
+}
+
+/* Throughput over unthrottled loopback */
+void
+Run(const char *name, const std::vector<uint8_t> &mesh,
+    const std::vector<std::vector<uint8_t>> &frames, BulkChannel::Codec codec)
+{
+  const auto result = Stream(mesh, frames, codec, kBlobCount, 0);
+  printf("  %-14s %7.1f MiB/s of blobs, %7.1f MiB/s on the wire (%.0f%%)\n",
+      name, (double)kBlobCount * kBlobSize / 1024 / 1024 / result.seconds,
+      (double)result.wire_bytes / 1024 / 1024 / result.seconds,
+      100. * result.wire_bytes / kBlobCount / kBlobSize);
+}
+
+/* Time until every blob of a scene has ended at the sink, over a link of
+ * `megabits_per_second` */
+void
+RunThrottled(double megabits_per_second, const std::vector<uint8_t> &mesh,
+    const std::vector<std::vector<uint8_t>> &raw_frames,
+    const std::vector<std::vector<uint8_t>> &lz4_frames)
+{
+  const double bits_per_second = megabits_per_second * 1e6;
+  const auto raw = Stream(mesh, raw_frames, BulkChannel::Codec::kNone,
+      kSceneBlobCount, bits_per_second);
+  const auto lz4 = Stream(mesh, lz4_frames, BulkChannel::Codec::kLz4,
+      kSceneBlobCount, bits_per_second);
+  printf("  %5.0f Mbit/s  %7.0f ms uncompressed, %7.0f ms LZ4 (%.2fx)\n",
+      megabits_per_second, raw.seconds * 1000, lz4.seconds * 1000,
+      raw.seconds / lz4.seconds);
+}
+
+}  // namespace
+
+/**
+ * Throughput of the bulk channel over loopback, from the first byte the
+ * server writes until the last blob ends at the sink, for blobs sent as they
+ * are and compressed with LZ4. Decompression runs on the worker pool.
+ *
+ * Then the time to first render of a scene over loopback throttled to the
+ * speeds of a Wi-Fi and a USB 2 link, where compression pays off.
+ */
+int
+main()
+{
+  const auto mesh = GenerateMesh();
+
+  std::vector<std::vector<uint8_t>> raw_frames;
+  std::vector<std::vector<uint8_t>> lz4_frames;
+  for (uint64_t id = 0; id < kBlobCount; id++) {
+    raw_frames.push_back(GenerateBlob(id, mesh));
+    lz4_frames.push_back(
+        test::CompressLz4Block(raw_frames.back().data(), kBlobSize));
+  }
+
+  printf("Bulk channel over loopback, %" PRIu64 " blobs of %zu MiB:\n",
+      kBlobCount, kBlobSize / 1024 / 1024);
+  Run("uncompressed", mesh, raw_frames, BulkChannel::Codec::kNone);
+  Run("LZ4", mesh, lz4_frames, BulkChannel::Codec::kLz4);
+
+  printf("Time to first render of a scene of %" PRIu64 " blobs of %zu MiB:\n",
+      kSceneBlobCount, kBlobSize / 1024 / 1024);
+  RunThrottled(100, mesh, raw_frames, lz4_frames);
+  RunThrottled(300, mesh, raw_frames, lz4_frames);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,429 @@
+#include "pch.h"
+
+#include <filesystem>
+
+#include "bulk-channel.h"
+#include "bulk-server-stand-in.h"
+#include "clock-sync.h"
+#include "content-cache.h"
+#include "content-hash.h"
+#include "lz4-block-encoder.h"
+#include "mesh-lod-generator.h"
+#include "poll-loop.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr uint64_t kMaxBlobSize = 1024 * 1024;
+
+using Header = test::BulkFrameHeader;
+
+class Sink : public BulkChannel::ISink {
+ public:
+  void *BeginBlob(uint64_t id, uint64_t size) override
+  {
+    begun++;
+    auto &blob = blobs[id];
+    blob.resize(size);
+    return blob.data();
+  }
+
+  void EndBlob(uint64_t /*id*/) override { ended++; }
+
+  void AbortBlob(uint64_t /*id*/) override { aborted++; }
+
+  std::unordered_map<uint64_t, std::vector<uint8_t>> blobs;
+  uint64_t begun{0};
+  uint64_t ended{0};
+  uint64_t aborted{0};
+};
+
+class SceneSink : public BulkChannel::ISceneSink {
+ public:
+  void SetBounds(uint64_t /*id*/, const Aabb & /*bounds*/) override {}
+
+  void Remove(uint64_t /*id*/) override {}
+
+  void SetPose(uint64_t id, int64_t time, int64_t receive_time,
+      const XrPosef &pose) override
+  {
+    poses.push_back({id, time, receive_time, pose});
+  }
+
+  struct Pose {
+    uint64_t id;
+    int64_t time;
+    int64_t receive_time;
+    XrPosef pose;
+  };
+  std::vector<Pose> poses;
+};
+
+/* A channel listening on an ephemeral port, with a sink */
+struct Channel {
+  Channel()
+      : worker_pool(1),
+        loop(std::make_shared<test::PollLoop>()),
+        channel(std::make_shared<BulkChannel>(
+            loop, &worker_pool, 0, kMaxBlobSize)),
+        sink(std::make_shared<Sink>())
+  {
+    EXPECT(channel->Init(0));
+    channel->set_sink(sink);
+  }
+
+  /* The server's end of a connection the channel accepted and greeted */
+  int Connect()
+  {
+    int fd = test::ConnectToBulkChannel(channel->port());
+    loop->Poll(std::chrono::seconds(1));  // accepts
+    test::ReadBulkHello(fd);
+
+    return fd;
+  }
+
+  /* Whether the channel closes the connection within a second */
+  bool IsClosed(int fd)
+  {
+    for (int i = 0; i < 100; i++) {
+      loop->Poll(std::chrono::milliseconds(10));
+
+      uint8_t buffer[256];
+      ssize_t result;
+      while ((result = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+      }
+      if (result == 0) return true;
+    }
+    return false;
+  }
+
+  WorkerPool worker_pool;
+  std::shared_ptr<test::PollLoop> loop;
+  std::shared_ptr<BulkChannel> channel;
+  std::shared_ptr<Sink> sink;
+};
+
+void
+Write(int fd, const Header &header, const std::vector<uint8_t> &data = {})
+{
+  test::WriteAll(fd, &header, sizeof(header));
+  test::WriteAll(fd, data.data(), data.size());
+}
+
+/* Blobs within the limits reach the sink whole */
+void
+TestAcceptsBlobs()
+{
+  Channel channel;
+  int fd = channel.Connect();
+
+  std::vector<uint8_t> blob(64 * 1024);
+  for (size_t i = 0; i < blob.size(); i++) blob[i] = (i / 64) & 0xff;
+  auto compressed = test::CompressLz4Block(blob.data(), blob.size());
+
+  Write(fd,
+      Header{1, blob.size(), blob.size(), 0,
+          (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)BulkChannel::FrameType::kBlob},
+      blob);
+  Write(fd,
+      Header{2, compressed.size(), blob.size(), 0,
+          (uint32_t)BulkChannel::Codec::kLz4,
+          (uint32_t)BulkChannel::FrameType::kBlob},
+      compressed);
+
+  for (int i = 0; i < 100 && channel.sink->ended < 2; i++) {
+    channel.loop->Poll(std::chrono::milliseconds(10));
+  }
+  EXPECT(channel.sink->ended == 2);
+  EXPECT(channel.sink->blobs[1] == blob);
+  EXPECT(channel.sink->blobs[2] == blob);
+
+  close(fd);
+}
+
+/* The poses of kTransforms frames reach the scene sink in order */
+void
+TestFeedsTransforms()
+{
+  Channel channel;
+  auto scene_sink = std::make_shared<SceneSink>();
+  channel.channel->set_scene_sink(scene_sink);
+  int fd = channel.Connect();
+
+  struct {
+    int64_t time;
+    uint64_t id;
+    float position[3];
+    float orientation[4];
+    uint32_t reserved;
+  } records[2] = {
+      {1000, 7, {1, 2, 3}, {0, 0, 0, 1}, 0},
+      {2000, 8, {4, 5, 6}, {0, 1, 0, 0}, 0},
+  };
+  std::vector<uint8_t> data(sizeof(records));
+  memcpy(data.data(), records, sizeof(records));
+
+  const int64_t begin = ClockSync::Now();
+  Write(fd,
+      Header{0, data.size(), data.size(), 0,
+          (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)BulkChannel::FrameType::kTransforms},
+      data);
+
+  for (int i = 0; i < 100 && scene_sink->poses.empty(); i++) {
+    channel.loop->Poll(std::chrono::milliseconds(10));
+  }
+  EXPECT(scene_sink->poses.size() == 2);
+  EXPECT(scene_sink->poses[0].id == 7);
+  EXPECT(scene_sink->poses[0].time == 1000);  // of the server's clock
+  EXPECT(scene_sink->poses[0].receive_time >= begin);
+  EXPECT(scene_sink->poses[0].pose.position.z == 3);
+  EXPECT(scene_sink->poses[1].id == 8);
+  EXPECT(scene_sink->poses[1].pose.orientation.y == 1);
+
+  close(fd);
+}
+
+/**
+ * A kMesh frame comes back as coarser levels through the mesh LOD generator,
+ * whose errors go to the LOD selector and whose indices go to the server, and
+ * so does the selection
+ */
+void
+TestGeneratesMeshLevels()
+{
+  Channel channel;
+  LodSelector lod_selector(0.05f);
+  lod_selector.set_display_width(1000);
+  auto generator =
+      std::make_shared<MeshLodGenerator>(channel.loop, &channel.worker_pool);
+  EXPECT(generator->Init());
+  generator->set_lod_selector(&lod_selector);
+  generator->set_sink(channel.channel);
+  channel.channel->set_mesh_sink(generator);
+  int fd = channel.Connect();
+
+  // A wavy grid of 64 by 64 vertices over a meter
+  constexpr uint32_t kSide = 64;
+  std::vector<float> positions;
+  std::vector<uint32_t> indices;
+  for (uint32_t z = 0; z < kSide; z++) {
+    for (uint32_t x = 0; x < kSide; x++) {
+      const float u = (float)x / (kSide - 1), v = (float)z / (kSide - 1);
+      positions.insert(positions.end(), {u, 0.05f * sinf(u * 20), v});
+      if (x + 1 == kSide || z + 1 == kSide) continue;
+      const uint32_t i = z * kSide + x;
+      indices.insert(indices.end(),
+          {i, i + kSide, i + 1, i + 1, i + kSide, i + kSide + 1});
+    }
+  }
+  const uint32_t counts[2] = {kSide * kSide, (uint32_t)indices.size()};
+  std::vector<uint8_t> data(sizeof(counts) + positions.size() * sizeof(float) +
+                            indices.size() * sizeof(uint32_t));
+  memcpy(data.data(), counts, sizeof(counts));
+  memcpy(data.data() + sizeof(counts), positions.data(),
+      positions.size() * sizeof(float));
+  memcpy(data.data() + sizeof(counts) + positions.size() * sizeof(float),
+      indices.data(), indices.size() * sizeof(uint32_t));
+
+  Write(fd,
+      Header{9, data.size(), data.size(), 0,
+          (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)BulkChannel::FrameType::kMesh},
+      data);
+
+  // Objects without levels are left out of the selection; with its bounds a
+  // meter in front of the eye, it is selected once its levels are generated
+  XrView view{XR_TYPE_VIEW};
+  view.pose.orientation.w = 1;
+  view.fov = {-0.8f, 0.8f, 0.8f, -0.8f};
+  lod_selector.SetBounds(9, Aabb{glm::vec3(-0.5f, -0.05f, -1.5f),
+                                glm::vec3(0.5f, 0.05f, -0.5f)});
+  for (int i = 0; i < 100 && lod_selector.selected().empty(); i++) {
+    channel.loop->Poll(std::chrono::milliseconds(10));
+    lod_selector.Select({view}, {9});
+  }
+  EXPECT(lod_selector.selected().size() == 1);
+  const auto selection = lod_selector.selected()[0];
+
+  // Sent along with the levels given to the selector
+  auto message =
+      test::ReadBulkMessage(fd, BulkChannel::MessageType::kMeshLevels);
+  uint64_t id;
+  uint32_t level_count;
+  memcpy(&id, message.data(), sizeof(id));
+  memcpy(&level_count, message.data() + sizeof(id), sizeof(level_count));
+  EXPECT(id == 9);
+  EXPECT(level_count > 1);
+
+  size_t offset = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+  for (uint32_t level = 1; level <= level_count; level++) {
+    float error;
+    uint32_t index_count;
+    memcpy(&error, message.data() + offset, sizeof(error));
+    memcpy(&index_count, message.data() + offset + sizeof(error),
+        sizeof(index_count));
+    EXPECT(error > 0);
+    EXPECT(index_count % 3 == 0 && index_count < indices.size());
+    offset += sizeof(error) + sizeof(index_count) +
+              index_count * sizeof(uint32_t);
+  }
+  EXPECT(offset == message.size());
+  EXPECT(selection.id == 9 && selection.lod <= level_count);
+
+  channel.channel->SendLodSelection(lod_selector.selected());
+  message = test::ReadBulkMessage(fd, BulkChannel::MessageType::kLodSelection);
+  struct {
+    uint64_t id;
+    uint32_t level;
+    uint32_t reserved;
+  } record;
+  EXPECT(message.size() == sizeof(record));
+  memcpy(&record, message.data(), sizeof(record));
+  EXPECT(record.id == 9 && record.level == selection.lod);
+
+  close(fd);
+}
+
+/* Cacheable blobs fill the cache while there is no sink to take them */
+void
+TestCachesWithoutSink()
+{
+  char directory[] = "/tmp/bulk-channel-test-XXXXXX";
+  EXPECT(mkdtemp(directory) != nullptr);
+  auto cache = std::make_shared<ContentCache>(directory, 1024 * 1024);
+  EXPECT(cache->Init());
+
+  Channel channel;
+  channel.channel->set_sink({});
+  channel.channel->set_content_cache(cache);
+  int fd = channel.Connect();
+
+  std::vector<uint8_t> blobs[2] = {std::vector<uint8_t>(4096, 1),
+      std::vector<uint8_t>(64 * 1024)};
+  for (size_t i = 0; i < blobs[1].size(); i++) blobs[1][i] = (i / 64) & 0xff;
+  auto compressed = test::CompressLz4Block(blobs[1].data(), blobs[1].size());
+  const uint64_t hashes[2] = {ContentHash(blobs[0].data(), blobs[0].size()),
+      ContentHash(blobs[1].data(), blobs[1].size())};
+
+  Write(fd,
+      Header{hashes[0], blobs[0].size(), blobs[0].size(), 0,
+          (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)BulkChannel::FrameType::kCacheableBlob},
+      blobs[0]);
+  Write(fd,
+      Header{hashes[1], compressed.size(), blobs[1].size(), 0,
+          (uint32_t)BulkChannel::Codec::kLz4,
+          (uint32_t)BulkChannel::FrameType::kCacheableBlob},
+      compressed);
+
+  for (int i = 0; i < 100 && cache->Hashes().size() < 2; i++) {
+    channel.loop->Poll(std::chrono::milliseconds(10));
+  }
+  for (int i = 0; i < 2; i++) {
+    auto mapping = cache->Get(hashes[i]);
+    EXPECT(mapping != nullptr);
+    EXPECT(mapping->size() == blobs[i].size());
+    EXPECT(memcmp(mapping->data(), blobs[i].data(), blobs[i].size()) == 0);
+  }
+  EXPECT(channel.sink->begun == 0);
+
+  close(fd);
+  std::filesystem::remove_all(directory);
+}
+
+/* An uncompressed cacheable blob is cached from the sink's memory before it
+ * ends at the sink */
+void
+TestCachesBeforeEnd()
+{
+  char directory[] = "/tmp/bulk-channel-test-XXXXXX";
+  EXPECT(mkdtemp(directory) != nullptr);
+  auto cache = std::make_shared<ContentCache>(directory, 1024 * 1024);
+  EXPECT(cache->Init());
+
+  Channel channel;
+  channel.channel->set_content_cache(cache);
+  int fd = channel.Connect();
+
+  std::vector<uint8_t> blob(64 * 1024);
+  for (size_t i = 0; i < blob.size(); i++) blob[i] = (i * 7) & 0xff;
+  const uint64_t hash = ContentHash(blob.data(), blob.size());
+  Write(fd,
+      Header{hash, blob.size(), blob.size(), 0,
+          (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)BulkChannel::FrameType::kCacheableBlob},
+      blob);
+
+  for (int i = 0; i < 100 && channel.sink->ended == 0; i++) {
+    channel.loop->Poll(std::chrono::milliseconds(10));
+  }
+  EXPECT(channel.sink->ended == 1);
+  EXPECT(channel.sink->blobs[hash] == blob);
+  auto mapping = cache->Get(hash);
+  EXPECT(mapping != nullptr);
+  EXPECT(mapping->size() == blob.size());
+  EXPECT(memcmp(mapping->data(), blob.data(), blob.size()) == 0);
+
+  close(fd);
+  std::filesystem::remove_all(directory);
+}
+
+/* A blob larger than the maximum ends the connection before any sink call */
+void
+TestDisconnectsOnTooLargeBlob()
+{
+  Channel channel;
+
+  int fd = channel.Connect();
+  Write(fd, Header{1, kMaxBlobSize + 1, kMaxBlobSize + 1, 0,
+                (uint32_t)BulkChannel::Codec::kNone,
+                (uint32_t)BulkChannel::FrameType::kBlob});
+  EXPECT(channel.IsClosed(fd));
+  close(fd);
+
+  // Small on the wire, but too large after decompression
+  fd = channel.Connect();
+  Write(fd, Header{2, 16, UINT64_MAX, 0, (uint32_t)BulkChannel::Codec::kLz4,
+                (uint32_t)BulkChannel::FrameType::kCacheableBlob});
+  EXPECT(channel.IsClosed(fd));
+  close(fd);
+
+  EXPECT(channel.sink->begun == 0);
+}
+
+/* More than LZ4 may take for the size after decompression */
+void
+TestDisconnectsOnSizeOverLz4Bound()
+{
+  Channel channel;
+  int fd = channel.Connect();
+
+  const uint64_t raw_size = 1024;
+  Write(fd, Header{1, raw_size + raw_size / 255 + 17, raw_size, 0,
+                (uint32_t)BulkChannel::Codec::kLz4,
+                (uint32_t)BulkChannel::FrameType::kBlob});
+  EXPECT(channel.IsClosed(fd));
+  EXPECT(channel.sink->begun == 0);
+
+  close(fd);
+}
+
+}  // namespace
+
+int
+main()
+{
+  TestAcceptsBlobs();
+  TestFeedsTransforms();
+  TestGeneratesMeshLevels();
+  TestCachesWithoutSink();
+  TestCachesBeforeEnd();
+  TestDisconnectsOnTooLargeBlob();
+  TestDisconnectsOnSizeOverLz4Bound();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "pch.h"
+
+#include "bulk-server-stand-in.h"
+#include "test-util.h"
+
+namespace zen::mirror::test {
+
+int
+ConnectToBulkChannel(uint16_t port)
+{
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  EXPECT(fd != -1);
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  EXPECT(connect(fd, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) == 0);
+
+  return fd;
+}
+
+void
+ReadBulkHello(int fd)
+{
+  struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t codecs;
+    uint32_t reserved;
+    uint64_t compression_threshold;
+  } hello;
+  EXPECT(ReadAll(fd, &hello, sizeof(hello)));
+  EXPECT(hello.magic == BulkChannel::kMagic);
+  EXPECT(hello.version == BulkChannel::kVersion);
+  EXPECT(hello.codecs & (1u << (uint32_t)BulkChannel::Codec::kLz4));
+}
+
+std::vector<uint8_t>
+ReadBulkMessage(int fd, BulkChannel::MessageType type)
+{
+  for (;;) {
+    uint32_t header[2];
+    EXPECT(ReadAll(fd, header, sizeof(header)));
+    std::vector<uint8_t> data(header[1]);
+    EXPECT(ReadAll(fd, data.data(), data.size()));
+    if (header[0] == (uint32_t)type) return data;
+  }
+}
+
+bool
+ReadAll(int fd, void *data, size_t size)
+{
+  auto bytes = static_cast<uint8_t *>(data);
+  while (size > 0) {
+    ssize_t result = read(fd, bytes, size);
+    if (result <= 0) return false;
+    bytes += result;
+    size -= result;
+  }
+  return true;
+}
+
+void
+WriteAll(int fd, const void *data, size_t size)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  while (size > 0) {
+    ssize_t written = write(fd, bytes, size);
+    EXPECT(written > 0);
+    bytes += written;
+    size -= written;
+  }
+}
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "bulk-channel.h"
+
+namespace zen::mirror::test {
+
+/* The frame header as the server writes it */
+struct BulkFrameHeader {
+  uint64_t id;
+  uint64_t size;
+  uint64_t raw_size;
+  int64_t send_time;
+  uint32_t codec;
+  uint32_t type;
+};
+
+/* The server's end of a connection to the local `port` */
+int ConnectToBulkChannel(uint16_t port);
+
+/* Read the hello of the mirror and check that it speaks this protocol */
+void ReadBulkHello(int fd);
+
+/* The data of the next message of `type`, skipping those of other types */
+std::vector<uint8_t> ReadBulkMessage(int fd, BulkChannel::MessageType type);
+
+/* @returns false if the connection was closed first */
+bool ReadAll(int fd, void *data, size_t size);
+
+void WriteAll(int fd, const void *data, size_t size);
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,137 @@
+#include "pch.h"
+
+#include <random>
+
+#include "bvh.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int kBoxCount = 1000;
+constexpr int kRayCount = 5000;
+constexpr float kMaxDistance = 30.f;
+
+std::mt19937 random_engine(7);
+
+float
+Uniform(float min, float max)
+{
+  return std::uniform_real_distribution<float>(min, max)(random_engine);
+}
+
+Aabb
+RandomBox()
+{
+  glm::vec3 center(Uniform(-10, 10), Uniform(-10, 10), Uniform(-10, 10));
+  glm::vec3 half(Uniform(0.02f, 0.5f), Uniform(0.02f, 0.5f),
+      Uniform(0.02f, 0.5f));
+  return Aabb{center - half, center + half};
+}
+
+/* The nearest hits by testing every box; more than one on a tie */
+std::vector<Bvh::Hit>
+BruteForce(const std::vector<Bvh::Primitive> &primitives,
+    const glm::vec3 &origin, const glm::vec3 &direction)
+{
+  const glm::vec3 inverse_direction(
+      1.f / direction.x, 1.f / direction.y, 1.f / direction.z);
+
+  std::vector<Bvh::Hit> hits;
+  for (auto &primitive : primitives) {
+    float distance =
+        primitive.bounds.Intersect(origin, inverse_direction, kMaxDistance);
+    if (distance < 0) continue;
+    if (!hits.empty() && distance > hits[0].distance) continue;
+    if (!hits.empty() && distance < hits[0].distance) hits.clear();
+    hits.push_back({primitive.id, distance});
+  }
+  return hits;
+}
+
+/* Random rays, axis-aligned ones included, against the brute force */
+void
+ExpectSameHits(const Bvh &bvh, const std::vector<Bvh::Primitive> &primitives)
+{
+  int hit_count = 0;
+  for (int i = 0; i < kRayCount; i++) {
+    glm::vec3 origin(Uniform(-12, 12), Uniform(-12, 12), Uniform(-12, 12));
+    glm::vec3 direction(Uniform(-1, 1), Uniform(-1, 1), Uniform(-1, 1));
+    if (i % 10 == 0) direction = glm::vec3(0, 0, i % 20 == 0 ? 1 : -1);
+    if (glm::length(direction) < 0.01f) continue;
+    direction = glm::normalize(direction);
+
+    const auto expected = BruteForce(primitives, origin, direction);
+    Bvh::Hit hit{0, 0};
+    const bool is_hit = bvh.Raycast(origin, direction, kMaxDistance, &hit);
+
+    EXPECT(is_hit == !expected.empty());
+    if (!is_hit) continue;
+    hit_count++;
+
+    EXPECT(hit.distance == expected[0].distance);
+    EXPECT(std::any_of(expected.begin(), expected.end(),
+        [&hit](const Bvh::Hit &candidate) { return candidate.id == hit.id; }));
+  }
+
+  // Enough of the rays hit for the comparison to mean something
+  EXPECT(hit_count > kRayCount / 10);
+}
+
+void
+TestRaycast()
+{
+  std::vector<Bvh::Primitive> primitives;
+  for (int i = 0; i < kBoxCount; i++) {
+    primitives.push_back({(uint64_t)i * 3 + 1, RandomBox()});
+  }
+
+  Bvh bvh;
+  bvh.Build(primitives);
+  EXPECT(bvh.primitive_count() == primitives.size());
+  ExpectSameHits(bvh, primitives);
+
+  // Refit moves boxes without a rebuild
+  for (int i = 0; i < kBoxCount; i += 3) {
+    primitives[i].bounds = RandomBox();
+    EXPECT(bvh.Refit(primitives[i].id, primitives[i].bounds));
+  }
+  EXPECT(!bvh.Refit(2, RandomBox()));
+  ExpectSameHits(bvh, primitives);
+}
+
+void
+TestEdgeCases()
+{
+  Bvh bvh;
+  Bvh::Hit hit{0, 0};
+  EXPECT(!bvh.Raycast(glm::vec3(0), glm::vec3(0, 0, -1), kMaxDistance, &hit));
+
+  bvh.Build({
+      {1, Aabb{glm::vec3(-1), glm::vec3(1)}},
+      {2, Aabb{glm::vec3(-1, -1, -6), glm::vec3(1, 1, -4)}},
+  });
+
+  // From inside a box, it is hit right away
+  EXPECT(bvh.Raycast(glm::vec3(0), glm::vec3(0, 0, -1), kMaxDistance, &hit));
+  EXPECT(hit.id == 1 && hit.distance == 0.f);
+
+  EXPECT(bvh.Raycast(
+      glm::vec3(0, 0, -2), glm::vec3(0, 0, -1), kMaxDistance, &hit));
+  EXPECT(hit.id == 2 && hit.distance == 2.f);
+
+  // Out of reach
+  EXPECT(!bvh.Raycast(glm::vec3(0, 0, -2), glm::vec3(0, 0, -1), 1.5f, &hit));
+}
+
+}  // namespace
+
+int
+main()
+{
+  TestRaycast();
+  TestEdgeCases();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <random>
+
+#include "bulk-channel.h"
+#include "bulk-server-stand-in.h"
+#include "content-cache.h"
+#include "content-hash.h"
+#include "poll-loop.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr size_t kBlobSize = 1024 * 1024;
+constexpr size_t kBlobCount = 64;
+constexpr uint64_t kCacheCapacity = 512 * 1024 * 1024;
+
+class Sink : public BulkChannel::ISink {
+ public:
+  void *BeginBlob(uint64_t id, uint64_t size) override
+  {
+    auto &blob = blobs_[id];
+    blob.resize(size);
+    return blob.data();
+  }
+
+  void EndBlob(uint64_t id) override
+  {
+    auto &blob = blobs_[id];
+    EXPECT(ContentHash(blob.data(), blob.size()) == id);
+    blobs_.erase(id);
+    ended++;
+  }
+
+  void AbortBlob(uint64_t /*id*/) override { aborted++; }
+
+  uint64_t ended{0};
+  uint64_t aborted{0};
+
+ private:
+  std::unordered_map<uint64_t, std::vector<uint8_t>> blobs_;
+};
+
+struct Connection {
+  std::chrono::nanoseconds time;
+  uint64_t wire_bytes;
+  size_t inventory_size;
+};
+
+/**
+ * Connect a fresh mirror, with a cache over `directory`, to a server that
+ * sends the content in the inventory as cached blobs and the rest in full.
+ * @returns when the sink has every blob
+ */
+Connection
+Connect(const std::string &directory,
+    const std::vector<std::vector<uint8_t>> &blobs)
+{
+  WorkerPool worker_pool(2);
+  auto loop = std::make_shared<test::PollLoop>();
+  auto cache = std::make_shared<ContentCache>(directory, kCacheCapacity);
+  EXPECT(cache->Init());
+
+  BulkChannel channel(loop, &worker_pool, 0, kBlobSize);
+  EXPECT(channel.Init(0));
+  auto sink = std::make_shared<Sink>();
+  channel.set_sink(sink);
+  channel.set_content_cache(cache);
+
+  std::atomic_bool is_done{false};
+  Connection connection{};
+  const auto begin = std::chrono::steady_clock::now();
+
+  std::thread server([&] {
+    int fd = test::ConnectToBulkChannel(channel.port());
+    test::ReadBulkHello(fd);
+
+    uint32_t message[2];
+    EXPECT(test::ReadAll(fd, message, sizeof(message)));
+    EXPECT(message[0] == (uint32_t)BulkChannel::MessageType::kInventory);
+    std::vector<uint64_t> inventory(message[1] / sizeof(uint64_t));
+    EXPECT(test::ReadAll(fd, inventory.data(), message[1]));
+    connection.inventory_size = inventory.size();
+    std::unordered_set<uint64_t> cached(inventory.begin(), inventory.end());
+
+    for (auto &blob : blobs) {
+      const uint64_t hash = ContentHash(blob.data(), blob.size());
+      const bool is_cached = cached.count(hash) > 0;
+      test::BulkFrameHeader header{hash, is_cached ? 0 : blob.size(),
+          blob.size(), 0, (uint32_t)BulkChannel::Codec::kNone,
+          (uint32_t)(is_cached ? BulkChannel::FrameType::kCachedBlob
+                               : BulkChannel::FrameType::kCacheableBlob)};
+      test::WriteAll(fd, &header, sizeof(header));
+      if (!is_cached) test::WriteAll(fd, blob.data(), blob.size());
+      connection.wire_bytes += sizeof(header) + header.size;
+    }
+
+    while (!is_done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    close(fd);
+  });
+
+  const auto deadline = begin + std::chrono::seconds(10);
+  while (sink->ended + sink->aborted < blobs.size() &&
+         std::chrono::steady_clock::now() < deadline) {
+    loop->Poll(std::chrono::milliseconds(100));
+  }
+  connection.time = std::chrono::steady_clock::now() - begin;
+  is_done = true;
+  server.join();
+  EXPECT(sink->ended == blobs.size());
+
+  // Written on the worker pool before each blob ended at the sink
+  EXPECT(cache->Hashes().size() == blobs.size());
+
+  return connection;
+}
+
+}  // namespace
+
+/**
+ * Time to receive a scene of textures over loopback on a reconnect with an
+ * empty content cache and with one that holds the scene.
+ */
+int
+main()
+{
+  char directory_template[] = "/tmp/content-cache-benchmark-XXXXXX";
+  EXPECT(mkdtemp(directory_template) != nullptr);
+  const std::string directory = std::string(directory_template) + "/cache";
+
+  // Random like compressed texture data
+  std::mt19937_64 random(1);
+  std::vector<std::vector<uint8_t>> blobs(kBlobCount);
+  for (auto &blob : blobs) {
+    blob.resize(kBlobSize);
+    for (size_t i = 0; i < kBlobSize; i += sizeof(uint64_t)) {
+      const uint64_t value = random();
+      memcpy(blob.data() + i, &value, sizeof(value));
+    }
+  }
+
+  const auto cold = Connect(directory, blobs);
+  const auto warm = Connect(directory, blobs);
+
+  EXPECT(cold.inventory_size == 0);
+  EXPECT(warm.inventory_size == kBlobCount);
+
+  const auto print = [](const char *name, const Connection &connection) {
+    printf("  %s: %.1f ms, %.1f MiB on the wire\n", name,
+        std::chrono::duration<double, std::milli>(connection.time).count(),
+        (double)connection.wire_bytes / 1024 / 1024);
+  };
+  printf("Receiving %zu blobs of %zu MiB over loopback:\n", kBlobCount,
+      kBlobSize / 1024 / 1024);
+  print("cold cache", cold);
+  print("warm cache", warm);
+
+  std::filesystem::remove_all(directory_template);
+
+  return EXIT_SUCCESS;
+}
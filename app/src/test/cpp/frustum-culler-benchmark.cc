@@ -0,0 +1,92 @@
+#include "pch.h"
+
+#include "frustum-culler.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr float kFar = 1000.f;
+constexpr int kGridExtent = 50;  // objects every meter within this, around
+constexpr float kEyeHeight = 1.6f;
+
+/* Two eyes of a Quest 2 looking along -Z, turned by `yaw` */
+std::vector<XrView>
+LocateViews(float yaw)
+{
+  std::vector<XrView> views(2, {XR_TYPE_VIEW});
+  const XrQuaternionf orientation{0, sinf(yaw / 2), 0, cosf(yaw / 2)};
+  for (int eye = 0; eye < 2; eye++) {
+    const float x = eye == 0 ? -0.032f : 0.032f;
+    views[eye].pose.orientation = orientation;
+    views[eye].pose.position = {
+        x * cosf(yaw), kEyeHeight, -x * sinf(yaw)};
+    views[eye].fov = eye == 0 ? XrFovf{-0.9f, 0.7f, 0.8f, -0.8f}
+                              : XrFovf{-0.7f, 0.9f, 0.8f, -0.8f};
+  }
+  return views;
+}
+
+}  // namespace
+
+/**
+ * Per-frame cost of culling a scene whose objects surround the viewer, so
+ * most of them are off screen, and of a frame without any object.
+ */
+int
+main()
+{
+  constexpr uint64_t kFrames = 1000;
+
+  FrustumCuller empty_culler(kFar);
+  auto begin = std::chrono::steady_clock::now();
+  for (uint64_t frame = 0; frame < kFrames; frame++) {
+    empty_culler.Cull(LocateViews(0));
+  }
+  const auto empty_time = std::chrono::steady_clock::now() - begin;
+  EXPECT(empty_culler.visible().empty());
+
+  FrustumCuller culler(kFar);
+  std::unordered_map<uint64_t, glm::vec3> centers;
+  uint64_t id = 0;
+  for (int x = -kGridExtent; x <= kGridExtent; x++) {
+    for (int z = -kGridExtent; z <= kGridExtent; z++) {
+      glm::vec3 center((float)x, kEyeHeight, (float)z);
+      Aabb bounds;
+      bounds.min = center - glm::vec3(0.1f);
+      bounds.max = center + glm::vec3(0.1f);
+      culler.SetBounds(id, bounds);
+      centers[id++] = center;
+    }
+  }
+
+  // Looking ahead, only objects in front are kept, including the nearest
+  culler.Cull(LocateViews(0));
+  bool is_ahead_visible = false;
+  for (uint64_t visible : culler.visible()) {
+    const glm::vec3 &center = centers[visible];
+    EXPECT(center.z < 0.2f);
+    if (center.x == 0 && center.z == -1) is_ahead_visible = true;
+  }
+  EXPECT(is_ahead_visible);
+
+  std::chrono::nanoseconds time{0};
+  uint64_t visible_count = 0;
+  for (uint64_t frame = 0; frame < kFrames; frame++) {
+    const auto views = LocateViews(frame * 0.01f);  // turning around
+    begin = std::chrono::steady_clock::now();
+    culler.Cull(views);
+    time += std::chrono::steady_clock::now() - begin;
+    visible_count += culler.visible().size();
+  }
+
+  printf("Frustum culling: %.2f us/frame for %" PRIu64 " objects, "
+         "%.1f%% visible\n",
+      (double)time.count() / kFrames / 1000, id,
+      100. * visible_count / kFrames / id);
+  printf("  %.3f us/frame without objects\n",
+      (double)std::chrono::nanoseconds(empty_time).count() / kFrames / 1000);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#include "pch.h"
+
+#include "gl-upload-thread.h"
+#include "host-egl-instance.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr GLsizei kTextureSize = 256;
+
+/* Upload a texture on the thread and draw nothing until Poll hands it over */
+void
+TestUploadBecomesReady(EglInstance *egl)
+{
+  GlUploadThread upload_thread(egl);
+  EXPECT(upload_thread.Init());
+
+  GLuint texture = 0;
+  bool is_ready = false;
+  std::vector<uint32_t> pixels(kTextureSize * kTextureSize, 0xff00ff00);
+  upload_thread.Enqueue(GlUploadThread::Upload{
+      [&] {
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, kTextureSize, kTextureSize,
+            0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+      },
+      [&] { is_ready = true; },
+      pixels.size() * sizeof(uint32_t),
+  });
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!is_ready && std::chrono::steady_clock::now() < deadline) {
+    upload_thread.Poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT(is_ready);
+
+  // Shared with the render context
+  EXPECT(glIsTexture(texture) == GL_TRUE);
+  glDeleteTextures(1, &texture);
+}
+
+/* Without a current context on the thread, the context falls back to none */
+void
+TestInitFailsWithoutCurrentContext(EglInstance *egl)
+{
+  test::BreakNextSharedSurface();
+
+  GlUploadThread upload_thread(egl);
+  EXPECT(upload_thread.Init() == false);
+}
+
+}  // namespace
+
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  TestUploadBecomesReady(&egl);
+  TestInitFailsWithoutCurrentContext(&egl);
+
+  return EXIT_SUCCESS;
+}
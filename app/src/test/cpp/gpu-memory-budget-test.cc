@@ -0,0 +1,105 @@
+#include "pch.h"
+
+#include "gpu-memory-budget.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+/* The stand-in server: keeps the reports the budget sends */
+class Sink : public GpuMemoryBudget::ISink {
+ public:
+  void SendGpuMemoryUsage(const GpuMemoryUsage &usage) override
+  {
+    reports.push_back(usage);
+  }
+
+  std::vector<GpuMemoryUsage> reports;
+};
+
+/* Over the budget, the least recently rendered resources go first */
+void
+TestEvictsLeastRecentlyRendered()
+{
+  GpuMemoryBudget budget(100);
+  std::vector<int> evicted;
+
+  auto first = budget.Track(
+      GpuMemoryCategory::kRemoteTexture, 40, [&] { evicted.push_back(1); });
+  budget.Track(
+      GpuMemoryCategory::kRemoteTexture, 40, [&] { evicted.push_back(2); });
+  budget.Track(GpuMemoryCategory::kSwapchain, 10);
+  budget.EndFrame();
+  EXPECT(evicted.empty());
+  EXPECT(budget.usage().total == 90);
+
+  // The first is rendered again, leaving the second the least recent
+  budget.Touch(first);
+  budget.Track(
+      GpuMemoryCategory::kRemoteBuffer, 30, [&] { evicted.push_back(3); });
+  budget.EndFrame();
+  EXPECT(evicted == std::vector<int>{2});
+
+  auto usage = budget.usage();
+  EXPECT(usage.total == 80);
+  EXPECT(usage.evictions == 1);
+  EXPECT(usage.categories[(int)GpuMemoryCategory::kRemoteTexture] == 40);
+  EXPECT(usage.categories[(int)GpuMemoryCategory::kRemoteBuffer] == 30);
+  EXPECT(usage.categories[(int)GpuMemoryCategory::kSwapchain] == 10);
+
+  // Evicted ones are already released
+  budget.Release(first);
+  EXPECT(budget.usage().total == 40);
+}
+
+/* Resources rendered in the frame and ones without a callback stay */
+void
+TestKeepsRenderedAndUnevictable()
+{
+  GpuMemoryBudget budget(50);
+  bool is_evicted = false;
+
+  auto texture = budget.Track(
+      GpuMemoryCategory::kRemoteTexture, 40, [&] { is_evicted = true; });
+  budget.Track(GpuMemoryCategory::kDepth, 40);
+  budget.Touch(texture);
+  budget.EndFrame();
+
+  EXPECT(!is_evicted);
+  EXPECT(budget.usage().total == 80);
+  EXPECT(budget.usage().evictions == 0);
+}
+
+/* The usage reaches the sink periodically, while it is alive */
+void
+TestReportsToSink()
+{
+  GpuMemoryBudget budget(1024);
+  auto sink = std::make_shared<Sink>();
+  budget.set_sink(sink);
+  budget.Track(GpuMemoryCategory::kMirror, 256);
+
+  for (int frame = 0; frame < 1000; frame++) budget.EndFrame();
+  EXPECT(sink->reports.size() == 2);
+  EXPECT(sink->reports[0].budget == 1024);
+  EXPECT(sink->reports[0].total == 256);
+  EXPECT(sink->reports[0].categories[(int)GpuMemoryCategory::kMirror] == 256);
+
+  auto reports = sink->reports.size();
+  sink.reset();
+  for (int frame = 0; frame < 1000; frame++) budget.EndFrame();
+  EXPECT(reports == 2);
+}
+
+}  // namespace
+
+int
+main()
+{
+  TestEvictsLeastRecentlyRendered();
+  TestKeepsRenderedAndUnevictable();
+  TestReportsToSink();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "pch.h"
+
+#include "hand-joints.h"
+#include "hand-tracking-stand-in.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+/* The largest difference of components, with q and -q the same rotation */
+float
+Distance(const XrQuaternionf &a, const XrQuaternionf &b)
+{
+  const float dot = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+  const float sign = dot < 0.f ? -1.f : 1.f;
+  return std::max({std::abs(a.x - b.x * sign), std::abs(a.y - b.y * sign),
+      std::abs(a.z - b.z * sign), std::abs(a.w - b.w * sign)});
+}
+
+void
+ExpectClose(const HandJoints &expected, const HandJoints &actual)
+{
+  using namespace hand_joints_codec;
+
+  EXPECT(actual.time == expected.time);
+  EXPECT(actual.position_valid_bits == expected.position_valid_bits);
+  EXPECT(actual.orientation_valid_bits == expected.orientation_valid_bits);
+
+  for (size_t i = 0; i < kHandJointCount; i++) {
+    const XrVector3f &a = expected.positions[i];
+    const XrVector3f &b = actual.positions[i];
+    EXPECT_NEAR(a.x, b.x, kPositionUnit * 0.6f);
+    EXPECT_NEAR(a.y, b.y, kPositionUnit * 0.6f);
+    EXPECT_NEAR(a.z, b.z, kPositionUnit * 0.6f);
+
+    // Within a unit for the three sent; the fourth follows from them
+    EXPECT(Distance(expected.orientations[i], actual.orientations[i]) <
+           kOrientationUnit * 4);
+
+    EXPECT_NEAR(expected.radii[i], actual.radii[i], kRadiusUnit * 0.6f);
+  }
+}
+
+void
+TestScriptedHandsRoundTrip()
+{
+  std::array<XrHandJointLocationEXT, kHandJointCount> locations;
+  std::vector<uint8_t> encoded;
+
+  // 2 s of frames at 90 Hz, with a few joints losing tracking now and then
+  for (XrTime time = 0; time < 2'000'000'000; time += 11'111'111) {
+    encoded.clear();
+    std::array<HandJoints, 2> expected;
+    for (uint8_t hand = 0; hand < 2; hand++) {
+      const uint32_t invalid_bits = (time / 100'000'000) % 3 == 0
+                                        ? 0x00f0u << hand
+                                        : 0u;
+      test::LocateScriptedHand(hand, time, invalid_bits, locations.data());
+      ScatterHandJointLocations(locations.data(), time, &expected[hand]);
+
+      EXPECT(expected[hand].position_valid_bits ==
+             (~invalid_bits & ((1u << kHandJointCount) - 1)));
+
+      hand_joints_codec::Encode(hand, expected[hand], &encoded);
+    }
+
+    EXPECT(encoded.size() == hand_joints_codec::kEncodedSize * 2);
+
+    // Both hands one after another, as the sink gets them
+    size_t offset = 0;
+    for (uint8_t hand = 0; hand < 2; hand++) {
+      uint8_t decoded_hand = 0xff;
+      HandJoints decoded;
+      size_t consumed = hand_joints_codec::Decode(encoded.data() + offset,
+          encoded.size() - offset, &decoded_hand, &decoded);
+      EXPECT(consumed == hand_joints_codec::kEncodedSize);
+      EXPECT(decoded_hand == hand);
+      ExpectClose(expected[hand], decoded);
+      offset += consumed;
+    }
+  }
+}
+
+void
+TestMalformedIsRejected()
+{
+  std::array<XrHandJointLocationEXT, kHandJointCount> locations;
+  test::LocateScriptedHand(1, 0, 0, locations.data());
+  HandJoints joints;
+  ScatterHandJointLocations(locations.data(), 0, &joints);
+
+  std::vector<uint8_t> encoded;
+  hand_joints_codec::Encode(1, joints, &encoded);
+
+  uint8_t hand;
+  HandJoints decoded;
+
+  // Truncated
+  EXPECT(hand_joints_codec::Decode(encoded.data(),
+             hand_joints_codec::kHeaderSize - 1, &hand, &decoded) == 0);
+  EXPECT(hand_joints_codec::Decode(encoded.data(), encoded.size() - 1, &hand,
+             &decoded) == 0);
+
+  // A joint count of another joint set
+  std::vector<uint8_t> broken = encoded;
+  broken[17]++;
+  EXPECT(hand_joints_codec::Decode(
+             broken.data(), broken.size(), &hand, &decoded) == 0);
+
+  // The index of the dropped quaternion component of the first joint
+  broken = encoded;
+  broken[hand_joints_codec::kHeaderSize + 6] = 4;
+  EXPECT(hand_joints_codec::Decode(
+             broken.data(), broken.size(), &hand, &decoded) == 0);
+
+  EXPECT(hand_joints_codec::Decode(encoded.data(), encoded.size(), &hand,
+             &decoded) == encoded.size());
+}
+
+}  // namespace
+
+int
+main()
+{
+  TestScriptedHandsRoundTrip();
+  TestMalformedIsRejected();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include "pch.h"
+
+#include "hand-tracking-stand-in.h"
+
+namespace zen::mirror::test {
+
+namespace {
+
+constexpr float kPi = 3.14159265f;
+
+XrQuaternionf
+AxisAngle(XrVector3f axis, float angle)
+{
+  const float s = std::sin(angle / 2);
+  return {axis.x * s, axis.y * s, axis.z * s, std::cos(angle / 2)};
+}
+
+XrQuaternionf
+Multiply(const XrQuaternionf &a, const XrQuaternionf &b)
+{
+  return {
+      a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+      a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+      a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+      a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+  };
+}
+
+XrVector3f
+Rotate(const XrQuaternionf &q, const XrVector3f &v)
+{
+  const XrQuaternionf p{v.x, v.y, v.z, 0.f};
+  const XrQuaternionf conjugate{-q.x, -q.y, -q.z, q.w};
+  const XrQuaternionf r = Multiply(Multiply(q, p), conjugate);
+  return {r.x, r.y, r.z};
+}
+
+}  // namespace
+
+void
+LocateScriptedHand(uint8_t hand, XrTime time, uint32_t invalid_bits,
+    XrHandJointLocationEXT *locations)
+{
+  const float phase = (float)(time % 1'000'000'000) / 1e9f * 2 * kPi;
+  const float side = hand == 0 ? -1.f : 1.f;
+  const float curl = (std::sin(phase) + 1.f) * 0.6f;  // per knuckle
+
+  const XrQuaternionf wrist_orientation =
+      AxisAngle({0.f, 1.f, 0.f}, side * 0.3f + std::sin(phase) * 0.5f);
+  const XrVector3f wrist{side * 0.2f, 1.1f + std::cos(phase) * 0.05f, -0.3f};
+
+  auto locate = [&](size_t joint, const XrVector3f &local,
+                    const XrQuaternionf &orientation, float radius) {
+    XrHandJointLocationEXT &location = locations[joint];
+    const XrVector3f offset = Rotate(wrist_orientation, local);
+    location.pose.position = {
+        wrist.x + offset.x, wrist.y + offset.y, wrist.z + offset.z};
+    location.pose.orientation = Multiply(wrist_orientation, orientation);
+    location.radius = radius;
+    location.locationFlags = (invalid_bits >> joint) & 1
+                                 ? 0
+                                 : XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                                       XR_SPACE_LOCATION_ORIENTATION_VALID_BIT;
+  };
+
+  const XrQuaternionf identity{0.f, 0.f, 0.f, 1.f};
+  locate(XR_HAND_JOINT_PALM_EXT, {0.f, 0.f, -0.05f}, identity, 0.02f);
+  locate(XR_HAND_JOINT_WRIST_EXT, {0.f, 0.f, 0.f}, identity, 0.02f);
+
+  // Thumb, then the four fingers from the metacarpal to the tip
+  size_t joint = XR_HAND_JOINT_THUMB_METACARPAL_EXT;
+  for (int finger = 0; finger < 5; finger++) {
+    const int bones = finger == 0 ? 4 : 5;
+    const float spread = side * (finger - 2) * 0.02f;
+    XrVector3f position{spread, 0.f, -0.03f};
+    XrQuaternionf orientation = AxisAngle({0.f, 1.f, 0.f}, spread * 4.f);
+    for (int bone = 0; bone < bones; bone++, joint++) {
+      locate(joint, position, orientation, 0.011f - bone * 0.0012f);
+
+      orientation = Multiply(orientation, AxisAngle({1.f, 0.f, 0.f}, curl));
+      const XrVector3f step = Rotate(orientation, {0.f, 0.f, -0.03f});
+      position = {
+          position.x + step.x, position.y + step.y, position.z + step.z};
+    }
+  }
+}
+
+}  // namespace zen::mirror::test
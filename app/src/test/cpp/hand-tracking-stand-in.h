@@ -0,0 +1,15 @@
+#pragma once
+
+#include "hand-joints.h"
+
+namespace zen::mirror::test {
+
+/**
+ * Joints a runtime would locate for a scripted hand at `time`: the fingers
+ * curl and stretch and the wrist turns, once every second. Joints given in
+ * `invalid_bits` are located without valid flags.
+ */
+void LocateScriptedHand(uint8_t hand, XrTime time, uint32_t invalid_bits,
+    XrHandJointLocationEXT *locations);
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,155 @@
+#include "pch.h"
+
+#include "haptic-scheduler.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr XrPath kLeftPath = 1;
+constexpr XrPath kRightPath = 2;
+
+/* The stand-in runtime: records the haptic calls */
+struct Call {
+  XrPath hand;
+  float amplitude;  // 0 for a stop
+};
+
+std::vector<Call> runtime_calls;
+
+/* Squeeze values fed frame by frame; edges are expected only at the marks */
+void
+TestGrabEdges()
+{
+  using Edge = GrabEdges::Edge;
+  const std::vector<std::pair<float, Edge>> frames{
+      {0.5f, Edge::kNone},
+      {0.9f, Edge::kNone},  // the threshold itself is not a press
+      {0.91f, Edge::kPress},
+      {0.85f, Edge::kNone},  // between the thresholds
+      {0.95f, Edge::kNone},
+      {0.81f, Edge::kNone},
+      {0.8f, Edge::kNone},
+      {0.79f, Edge::kRelease},
+      {0.85f, Edge::kNone},
+      {0.9f, Edge::kNone},
+      {0.95f, Edge::kPress},
+  };
+
+  GrabEdges grab_edges;
+  for (auto [value, edge] : frames) {
+    EXPECT(grab_edges.Update(true, value) == edge);
+  }
+  EXPECT(grab_edges.is_grabbing());
+
+  // A controller going inactive ends the grab without an edge
+  EXPECT(grab_edges.Update(false, 0.f) == Edge::kNone);
+  EXPECT(!grab_edges.is_grabbing());
+  EXPECT(grab_edges.Update(true, 0.95f) == Edge::kPress);
+}
+
+/* A squeeze value dithering across one threshold calls the runtime once */
+void
+TestDitheringGrabCallsOnce()
+{
+  runtime_calls.clear();
+  HapticScheduler haptics(
+      XR_NULL_HANDLE, XR_NULL_HANDLE, {kLeftPath, kRightPath});
+  const HapticPattern press{{20'000'000, 0.5f, XR_FREQUENCY_UNSPECIFIED}};
+  const HapticPattern release{{10'000'000, 0.25f, XR_FREQUENCY_UNSPECIFIED}};
+
+  GrabEdges grab_edges;
+  auto frame = [&](float value) {
+    switch (grab_edges.Update(true, value)) {
+      case GrabEdges::Edge::kPress:
+        haptics.Play(HapticScheduler::Hand::kRight, press);
+        break;
+      case GrabEdges::Edge::kRelease:
+        haptics.Play(HapticScheduler::Hand::kRight, release);
+        break;
+      case GrabEdges::Edge::kNone:
+        break;
+    }
+    haptics.Update();
+  };
+
+  for (int i = 0; i < 90; i++) frame(i % 2 == 0 ? 0.88f : 0.92f);
+  EXPECT(runtime_calls.size() == 1);
+  EXPECT(runtime_calls[0].hand == kRightPath);
+  EXPECT(runtime_calls[0].amplitude == 0.5f);
+
+  for (int i = 0; i < 90; i++) frame(i % 2 == 0 ? 0.78f : 0.82f);
+  EXPECT(runtime_calls.size() == 2);
+  EXPECT(runtime_calls[1].amplitude == 0.25f);
+  EXPECT(haptics.runtime_calls() == 2);
+}
+
+/* Each pulse goes to the runtime once; a stop only cuts a vibration short */
+void
+TestPulsesCallOnce()
+{
+  runtime_calls.clear();
+  HapticScheduler haptics(
+      XR_NULL_HANDLE, XR_NULL_HANDLE, {kLeftPath, kRightPath});
+  haptics.Play(HapticScheduler::Hand::kLeft,
+      {
+          {20'000'000, 0.5f, XR_FREQUENCY_UNSPECIFIED},
+          {20'000'000, 0.f, XR_FREQUENCY_UNSPECIFIED},
+          {20'000'000, 1.f, XR_FREQUENCY_UNSPECIFIED},
+      });
+
+  const auto end =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+  while (std::chrono::steady_clock::now() < end) {
+    haptics.Update();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // The pause follows a pulse the runtime has stopped on its own
+  EXPECT(runtime_calls.size() == 2);
+  EXPECT(runtime_calls[0].amplitude == 0.5f);
+  EXPECT(runtime_calls[1].amplitude == 1.f);
+
+  haptics.Play(HapticScheduler::Hand::kLeft,
+      {{1'000'000'000, 0.5f, XR_FREQUENCY_UNSPECIFIED}});
+  haptics.Update();
+  haptics.Stop(HapticScheduler::Hand::kLeft);
+  EXPECT(runtime_calls.size() == 4);
+  EXPECT(runtime_calls[3].amplitude == 0.f);
+
+  // Nothing left to stop
+  haptics.Stop(HapticScheduler::Hand::kLeft);
+  EXPECT(runtime_calls.size() == 4);
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrApplyHapticFeedback(XrSession /*session*/,
+    const XrHapticActionInfo *haptic_action_info,
+    const XrHapticBaseHeader *haptic_feedback)
+{
+  auto vibration = reinterpret_cast<const XrHapticVibration *>(haptic_feedback);
+  runtime_calls.push_back(
+      {haptic_action_info->subactionPath, vibration->amplitude});
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrStopHapticFeedback(
+    XrSession /*session*/, const XrHapticActionInfo *haptic_action_info)
+{
+  runtime_calls.push_back({haptic_action_info->subactionPath, 0.f});
+  return XR_SUCCESS;
+}
+
+int
+main()
+{
+  TestGrabEdges();
+  TestDitheringGrabCallsOnce();
+  TestPulsesCallOnce();
+
+  return EXIT_SUCCESS;
+}
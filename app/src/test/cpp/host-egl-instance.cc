@@ -0,0 +1,92 @@
+#include "pch.h"
+
+#include "host-egl-instance.h"
+#include "logger.h"
+
+namespace zen::mirror {
+
+namespace {
+
+// clang-format off
+constexpr EGLint kConfigAttribs[] = {
+    EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+    EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+    EGL_NONE,
+};
+
+constexpr EGLint kContextAttribs[] = {
+    EGL_CONTEXT_CLIENT_VERSION, 3,
+    EGL_NONE,
+};
+
+constexpr EGLint kSurfaceAttribs[] = {
+    EGL_WIDTH,  16,
+    EGL_HEIGHT, 16,
+    EGL_NONE,
+};
+// clang-format on
+
+bool is_next_shared_surface_broken = false;
+
+}  // namespace
+
+void
+test::BreakNextSharedSurface()
+{
+  is_next_shared_surface_broken = true;
+}
+
+/* Pbuffers only, as on a display without windows such as Mesa's surfaceless */
+bool
+EglInstance::Initialize()
+{
+  display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  EGLint major_version, minor_version;
+  if (eglInitialize(display_, &major_version, &minor_version) == EGL_FALSE) {
+    LOG_ERROR("eglInitialize() failed: 0x%x", eglGetError());
+    return false;
+  }
+
+  EGLint config_count = 0;
+  if (eglChooseConfig(display_, kConfigAttribs, &config_, 1, &config_count) ==
+          EGL_FALSE ||
+      config_count == 0) {
+    LOG_ERROR("No EGLConfig for GLES 3 on pbuffers");
+    return false;
+  }
+
+  eglBindAPI(EGL_OPENGL_ES_API);
+
+  context_ =
+      eglCreateContext(display_, config_, EGL_NO_CONTEXT, kContextAttribs);
+  surface_ = eglCreatePbufferSurface(display_, config_, kSurfaceAttribs);
+  if (context_ == EGL_NO_CONTEXT || surface_ == EGL_NO_SURFACE) {
+    LOG_ERROR("Failed to create the EGL context: 0x%x", eglGetError());
+    return false;
+  }
+
+  return eglMakeCurrent(display_, surface_, surface_, context_) == EGL_TRUE;
+}
+
+bool
+EglInstance::CreateSharedContext(EGLContext *context, EGLSurface *surface)
+{
+  *context = eglCreateContext(display_, config_, context_, kContextAttribs);
+  if (*context == EGL_NO_CONTEXT) return false;
+
+  *surface = eglCreatePbufferSurface(display_, config_, kSurfaceAttribs);
+  if (*surface == EGL_NO_SURFACE) {
+    eglDestroyContext(display_, *context);
+    *context = EGL_NO_CONTEXT;
+    return false;
+  }
+
+  if (is_next_shared_surface_broken) {
+    is_next_shared_surface_broken = false;
+    eglDestroySurface(display_, *surface);
+  }
+
+  return true;
+}
+
+}  // namespace zen::mirror
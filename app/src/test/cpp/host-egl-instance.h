@@ -0,0 +1,14 @@
+#pragma once
+
+#include "egl-instance.h"
+
+namespace zen::mirror::test {
+
+/**
+ * The next CreateSharedContext succeeds but hands out a surface that is
+ * already destroyed, so making the context current fails as it does when a
+ * driver runs out of contexts
+ */
+void BreakNextSharedSurface();
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,32 @@
+#include "pch.h"
+
+#include "logger.h"
+
+namespace zen::mirror {
+
+namespace {
+
+class HostLogger : public ILogger {
+  virtual void Printv(Severity severity, const char* tag,
+      const char* /*pretty_function*/, const char* /*file*/, int /*line*/,
+      const char* format, va_list args) final
+  {
+    static constexpr const char* kSeverities[] = {
+        "D", "I", "W", "E", "F", "S"};
+
+    fprintf(stderr, "%s %s: ", kSeverities[severity], tag);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+  }
+};
+
+}  // namespace
+
+std::unique_ptr<ILogger> ILogger::instance = std::make_unique<HostLogger>();
+
+void
+InitializeLogger()
+{
+}
+
+}  // namespace zen::mirror
@@ -0,0 +1,296 @@
+#include "pch.h"
+
+#include <random>
+
+#include "egl-instance.h"
+#include "lod-selector.h"
+#include "mesh-simplifier.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int kObjectCount = 100;
+constexpr uint32_t kRings = 64;
+constexpr uint32_t kSegments = 256;  // 32k triangles per sphere
+constexpr float kRadius = 0.5f;
+constexpr uint32_t kDisplayWidth = 1440;  // per eye, as on a Quest 2
+constexpr GLsizei kTargetSize = 720;      // rendered smaller on llvmpipe
+constexpr int kRenderFrames = 3;
+
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+};
+
+/* A UV sphere around the origin */
+void
+GenerateSphere(std::vector<Vertex> *vertices, std::vector<uint32_t> *indices)
+{
+  for (uint32_t ring = 0; ring <= kRings; ring++) {
+    const float polar = (float)M_PI * ring / kRings;
+    for (uint32_t segment = 0; segment <= kSegments; segment++) {
+      const float azimuth = 2 * (float)M_PI * segment / kSegments;
+      const glm::vec3 normal(sinf(polar) * cosf(azimuth), cosf(polar),
+          sinf(polar) * sinf(azimuth));
+      vertices->push_back(Vertex{normal * kRadius, normal});
+    }
+  }
+
+  for (uint32_t ring = 0; ring < kRings; ring++) {
+    for (uint32_t segment = 0; segment < kSegments; segment++) {
+      const uint32_t i = ring * (kSegments + 1) + segment;
+      const uint32_t below = i + kSegments + 1;
+      if (ring != 0) indices->insert(indices->end(), {i, i + 1, below});
+      if (ring + 1 != kRings) {
+        indices->insert(indices->end(), {i + 1, below + 1, below});
+      }
+    }
+  }
+}
+
+/* An eye at `position` looking along -Z with a 90 degree field of view */
+std::vector<XrView>
+LocateViews(const glm::vec3 &position)
+{
+  std::vector<XrView> views(1, {XR_TYPE_VIEW});
+  views[0].pose.orientation = {0, 0, 0, 1};
+  views[0].pose.position = {position.x, position.y, position.z};
+  views[0].fov = XrFovf{-(float)M_PI / 4, (float)M_PI / 4, (float)M_PI / 4,
+      -(float)M_PI / 4};
+  return views;
+}
+
+/* Counts the objects whose level changed between selections */
+class Sink : public LodSelector::ISink {
+ public:
+  void SendLodSelection(
+      const std::vector<LodSelector::Selection> &selected) override
+  {
+    for (const auto &selection : selected) {
+      auto [it, is_new] = lods_.emplace(selection.id, selection.lod);
+      if (!is_new && it->second != selection.lod) switches++;
+      it->second = selection.lod;
+    }
+  }
+
+  uint64_t switches{0};
+
+ private:
+  std::unordered_map<uint64_t, uint32_t> lods_;
+};
+
+GLuint
+CompileProgram()
+{
+  const char *vertex = "#version 300 es\n"
+                       "layout(location = 0) in vec3 position;\n"
+                       "layout(location = 1) in vec3 normal;\n"
+                       "uniform vec3 center;\n"
+                       "out vec3 v_normal;\n"
+                       "void main() {\n"
+                       "  v_normal = normal;\n"
+                       "  vec3 p = position + center;\n"
+                       "  // 90 degrees, from 0.05 to 1000 m\n"
+                       "  gl_Position =\n"
+                       "      vec4(p.xy, -1.0001 * p.z - 0.1, -p.z);\n"
+                       "}\n";
+  const char *fragment = "#version 300 es\n"
+                         "precision mediump float;\n"
+                         "in vec3 v_normal;\n"
+                         "out vec4 color;\n"
+                         "void main() {\n"
+                         "  float light = max(dot(normalize(v_normal),\n"
+                         "      normalize(vec3(1, 1, 1))), 0.1);\n"
+                         "  color = vec4(vec3(light), 1.0);\n"
+                         "}\n";
+
+  GLuint program = glCreateProgram();
+  for (auto [type, source] : {std::make_pair(GL_VERTEX_SHADER, vertex),
+           std::make_pair(GL_FRAGMENT_SHADER, fragment)}) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    glAttachShader(program, shader);
+    glDeleteShader(shader);
+  }
+  glLinkProgram(program);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  EXPECT(status == GL_TRUE);
+  return program;
+}
+
+}  // namespace
+
+/**
+ * Triangles and GPU time per frame of a scene of dense spheres 1 to 40 m
+ * away, drawn at full detail and at the levels the selector picks from those
+ * mesh::GenerateLevels makes, on the host's GL (llvmpipe under
+ * EGL_PLATFORM=surfaceless). Also the level switches that 2 mm of head
+ * jitter and walking through the scene cause.
+ */
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  GenerateSphere(&vertices, &indices);
+
+  std::vector<glm::vec3> positions;
+  for (const auto &vertex : vertices) positions.push_back(vertex.position);
+  auto begin = std::chrono::steady_clock::now();
+  const auto levels = mesh::GenerateLevels(
+      positions.data(), positions.size(), indices, 8, 256);
+  const auto generate_time = std::chrono::steady_clock::now() - begin;
+
+  // All levels in one index buffer
+  std::vector<uint32_t> all_indices;
+  std::vector<LodSelector::Lod> lods;
+  std::vector<std::pair<GLsizei, size_t>> ranges;  // count, offset
+  for (const auto &level : levels) {
+    ranges.emplace_back(
+        level.indices.size(), all_indices.size() * sizeof(uint32_t));
+    all_indices.insert(
+        all_indices.end(), level.indices.begin(), level.indices.end());
+    lods.push_back(LodSelector::Lod{
+        level.error, (uint32_t)(level.indices.size() / 3)});
+  }
+
+  // In front of the eye, within the field of view
+  std::mt19937 random(3);
+  std::uniform_real_distribution<float> distance(1, 40);
+  std::uniform_real_distribution<float> angle(-0.6f, 0.6f);
+  LodSelector selector(0.05f);
+  selector.set_display_width(kDisplayWidth);
+  auto sink = std::make_shared<Sink>();
+  selector.set_sink(sink);
+  std::vector<glm::vec3> centers;
+  std::vector<uint64_t> visible;
+  for (uint64_t id = 0; id < kObjectCount; id++) {
+    const float d = distance(random);
+    centers.emplace_back(
+        d * tanf(angle(random)), d * tanf(angle(random)) / 2, -d);
+    Aabb bounds;
+    bounds.min = centers.back() - glm::vec3(kRadius);
+    bounds.max = centers.back() + glm::vec3(kRadius);
+    selector.SetBounds(id, bounds);
+    selector.SetLods(id, lods);
+    visible.push_back(id);
+  }
+
+  GLuint buffers[2];
+  glGenBuffers(2, buffers);
+  GLuint vertex_array;
+  glGenVertexArrays(1, &vertex_array);
+  glBindVertexArray(vertex_array);
+  glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+      vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, all_indices.size() * sizeof(uint32_t),
+      all_indices.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+      reinterpret_cast<void *>(offsetof(Vertex, normal)));
+
+  GLuint renderbuffers[2];
+  glGenRenderbuffers(2, renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, kTargetSize, kTargetSize);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+  glRenderbufferStorage(
+      GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, kTargetSize, kTargetSize);
+  GLuint framebuffer;
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+      GL_RENDERBUFFER, renderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+      GL_RENDERBUFFER, renderbuffers[1]);
+  EXPECT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+  GLuint program = CompileProgram();
+  glUseProgram(program);
+  const GLint center_location = glGetUniformLocation(program, "center");
+  glViewport(0, 0, kTargetSize, kTargetSize);
+  glEnable(GL_DEPTH_TEST);
+  glEnable(GL_CULL_FACE);
+
+  // Frames drawing each object at its level, or the full mesh if not `lod`
+  const auto render = [&](bool is_lod, uint64_t *triangles) {
+    selector.Select(LocateViews(glm::vec3(0)), visible);
+    EXPECT(selector.selected().size() == kObjectCount);
+
+    glFinish();
+    const auto begin = std::chrono::steady_clock::now();
+    *triangles = 0;
+    for (int frame = 0; frame < kRenderFrames; frame++) {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      for (const auto &selection : selector.selected()) {
+        const uint32_t lod = is_lod ? selection.lod : 0;
+        const glm::vec3 &center = centers[selection.id];
+        glUniform3f(center_location, center.x, center.y, center.z);
+        glDrawElements(GL_TRIANGLES, ranges[lod].first, GL_UNSIGNED_INT,
+            reinterpret_cast<void *>(ranges[lod].second));
+        *triangles += lods[lod].triangle_count;
+      }
+    }
+    glFinish();
+    *triangles /= kRenderFrames;
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - begin)
+               .count() /
+           kRenderFrames;
+  };
+
+  uint64_t full_triangles, lod_triangles;
+  const double full_time = render(false, &full_triangles);
+  const double lod_time = render(true, &lod_triangles);
+  EXPECT(glGetError() == GL_NO_ERROR);
+  EXPECT(lod_triangles < full_triangles);
+
+  // Still, with the head jittering by up to a millimeter along each axis
+  std::uniform_real_distribution<float> jitter(-0.001f, 0.001f);
+  sink->switches = 0;
+  for (int frame = 0; frame < 1000; frame++) {
+    selector.Select(LocateViews(glm::vec3(jitter(random), jitter(random),
+                        jitter(random))),
+        visible);
+  }
+  const uint64_t jitter_switches = sink->switches;
+  EXPECT(jitter_switches == 0);
+
+  // Walking 10 m into the scene
+  sink->switches = 0;
+  for (int frame = 0; frame < 1000; frame++) {
+    selector.Select(LocateViews(glm::vec3(0, 0, -0.01f * frame)), visible);
+  }
+  const uint64_t walk_switches = sink->switches;
+
+  glDeleteProgram(program);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(2, renderbuffers);
+  glDeleteVertexArrays(1, &vertex_array);
+  glDeleteBuffers(2, buffers);
+
+  printf("%d spheres of %zu triangles in %zu levels, generated in %.1f ms:\n",
+      kObjectCount, indices.size() / 3, levels.size(),
+      std::chrono::duration<double, std::milli>(generate_time).count());
+  printf("  full detail: %.2fM triangles, %.1f ms GPU time per frame\n",
+      full_triangles / 1e6, full_time);
+  printf("  selected:    %.2fM triangles, %.1f ms GPU time per frame\n",
+      lod_triangles / 1e6, lod_time);
+  printf("  %" PRIu64 " switches over 1000 frames of 2 mm head jitter, %" PRIu64
+         " walking 10 m\n",
+      jitter_switches, walk_switches);
+
+  return EXIT_SUCCESS;
+}
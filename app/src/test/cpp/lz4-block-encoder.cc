@@ -0,0 +1,85 @@
+#include "pch.h"
+
+#include "lz4-block-encoder.h"
+
+namespace zen::mirror::test {
+
+namespace {
+
+constexpr size_t kMinMatchLength = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 16;
+
+// The format ends with literals: the last match ends kLastLiterals bytes
+// before the end and starts kMatchLimit bytes before it at the latest
+constexpr size_t kLastLiterals = 5;
+constexpr size_t kMatchLimit = 12;
+
+void
+WriteLength(std::vector<uint8_t> *out, size_t length)
+{
+  if (length < 15) return;
+
+  length -= 15;
+  for (; length >= 255; length -= 255) out->push_back(255);
+  out->push_back(length);
+}
+
+void
+WriteSequence(std::vector<uint8_t> *out, const uint8_t *literals,
+    size_t literal_length, size_t offset, size_t match_length)
+{
+  const size_t match_code = match_length - kMinMatchLength;
+  out->push_back((std::min<size_t>(literal_length, 15) << 4) |
+                 (match_length ? std::min<size_t>(match_code, 15) : 0));
+  WriteLength(out, literal_length);
+  out->insert(out->end(), literals, literals + literal_length);
+
+  if (match_length == 0) return;  // the last sequence
+
+  out->push_back(offset & 0xff);
+  out->push_back(offset >> 8);
+  WriteLength(out, match_code);
+}
+
+}  // namespace
+
+std::vector<uint8_t>
+CompressLz4Block(const uint8_t *data, size_t size)
+{
+  std::vector<uint8_t> out;
+  out.reserve(size + size / 255 + 16);
+  std::vector<uint32_t> table(1 << kHashBits, UINT32_MAX);
+
+  size_t anchor = 0;
+  size_t i = 0;
+  while (size >= kMatchLimit && i < size - kMatchLimit) {
+    uint32_t sequence;
+    memcpy(&sequence, data + i, sizeof(sequence));
+    const uint32_t hash = (sequence * 2654435761u) >> (32 - kHashBits);
+    const size_t candidate = table[hash];
+    table[hash] = i;
+
+    if (candidate == UINT32_MAX || i - candidate > kMaxOffset ||
+        memcmp(data + candidate, data + i, kMinMatchLength) != 0) {
+      i++;
+      continue;
+    }
+
+    size_t length = kMinMatchLength;
+    while (i + length < size - kLastLiterals &&
+           data[candidate + length] == data[i + length]) {
+      length++;
+    }
+
+    WriteSequence(&out, data + anchor, i - anchor, i - candidate, length);
+    i += length;
+    anchor = i;
+  }
+
+  WriteSequence(&out, data + anchor, size - anchor, 0, 0);
+
+  return out;
+}
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror::test {
+
+/**
+ * Compress `size` bytes into one block in the LZ4 block format, as the
+ * server does, with a greedy search of the last position of each 4 bytes.
+ * Fast rather than small, and never larger than LZ4_COMPRESSBOUND.
+ */
+std::vector<uint8_t> CompressLz4Block(const uint8_t *data, size_t size);
+
+}  // namespace zen::mirror::test
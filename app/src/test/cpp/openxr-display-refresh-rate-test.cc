@@ -0,0 +1,211 @@
+#include "pch.h"
+
+#include "frame-stats.h"
+#include "openxr-display-refresh-rate.h"
+#include "openxr-performance-governor.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr float kSecond = 1e9f;
+
+/**
+ * The stand-in runtime: switches to a requested rate at the end of the frame
+ * and records the performance levels set for each domain
+ */
+struct {
+  std::vector<float> rates{60.f, 72.f, 90.f, 120.f};
+  float rate{90.f};
+  float requested_rate{0.f};  // 0 when no request is pending
+  uint32_t requests{0};
+  std::unordered_map<XrPerfSettingsDomainEXT, XrPerfSettingsLevelEXT> levels;
+} runtime;
+
+XRAPI_ATTR XrResult XRAPI_CALL
+EnumerateDisplayRefreshRates(XrSession /*session*/, uint32_t capacity,
+    uint32_t *count, float *rates)
+{
+  *count = (uint32_t)runtime.rates.size();
+  if (capacity == 0) return XR_SUCCESS;
+  if (capacity < *count) return XR_ERROR_SIZE_INSUFFICIENT;
+  std::copy(runtime.rates.begin(), runtime.rates.end(), rates);
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+GetDisplayRefreshRate(XrSession /*session*/, float *rate)
+{
+  *rate = runtime.rate;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+RequestDisplayRefreshRate(XrSession /*session*/, float rate)
+{
+  runtime.requested_rate = rate;
+  runtime.requests++;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+SetPerformanceLevel(XrSession /*session*/, XrPerfSettingsDomainEXT domain,
+    XrPerfSettingsLevelEXT level)
+{
+  runtime.levels[domain] = level;
+  return XR_SUCCESS;
+}
+
+/**
+ * Scripted frames through both controllers, fed the way the view source
+ * feeds them, with the changed events delivered the way the event source
+ * delivers them
+ */
+class Script {
+ public:
+  Script()
+  {
+    runtime = {};
+    EXPECT(refresh_rate_.Init());
+    EXPECT(governor_.Init());
+  }
+
+  /* `count` frames at the current rate, each displayed a period after the
+   * previous one, or two periods after when `missed` */
+  void Frames(uint32_t count, bool missed = false)
+  {
+    for (uint32_t i = 0; i < count; i++) {
+      const auto period = (XrDuration)(kSecond / runtime.rate);
+      time_ += missed ? period * 2 : period;
+
+      XrFrameState frame_state{XR_TYPE_FRAME_STATE};
+      frame_state.predictedDisplayTime = time_;
+      frame_state.predictedDisplayPeriod = period;
+      for (auto frame_stats :
+          {refresh_rate_.frame_stats(), governor_.frame_stats()}) {
+        frame_stats->BeginFrame(frame_state);
+        frame_stats->EndFrame();  // leaving the period unused
+      }
+
+      refresh_rate_.Update();
+      governor_.Update(time_);
+
+      if (runtime.requested_rate != 0.f) {
+        XrEventDataDisplayRefreshRateChangedFB event{
+            XR_TYPE_EVENT_DATA_DISPLAY_REFRESH_RATE_CHANGED_FB};
+        event.fromDisplayRefreshRate = runtime.rate;
+        event.toDisplayRefreshRate = runtime.requested_rate;
+        runtime.rate = runtime.requested_rate;
+        runtime.requested_rate = 0.f;
+        refresh_rate_.HandleChangedEvent(&event);
+      }
+    }
+  }
+
+  /* Missed frames for `seconds` at the current rate */
+  void MissedSeconds(float seconds)
+  {
+    Frames((uint32_t)(seconds * runtime.rate / 2.f), true);
+  }
+
+  OpenXRDisplayRefreshRate *refresh_rate() { return &refresh_rate_; }
+  OpenXRPerformanceGovernor *governor() { return &governor_; }
+
+ private:
+  OpenXRDisplayRefreshRate refresh_rate_{XR_NULL_HANDLE, XR_NULL_HANDLE};
+  OpenXRPerformanceGovernor governor_{XR_NULL_HANDLE, XR_NULL_HANDLE};
+  XrTime time_{1'000'000'000};
+};
+
+bool
+IsAt(XrPerfSettingsLevelEXT level)
+{
+  return runtime.levels[XR_PERF_SETTINGS_DOMAIN_CPU_EXT] == level &&
+         runtime.levels[XR_PERF_SETTINGS_DOMAIN_GPU_EXT] == level;
+}
+
+/* The rate steps down once per window of missed frames, and back up */
+void
+TestStepsDownAndUp()
+{
+  Script script;
+  EXPECT(runtime.requests == 0);  // 90 Hz, as configured
+  script.Frames(FrameStats::kWindowSize);
+  EXPECT(runtime.requests == 0);
+
+  script.Frames(5, true);
+  EXPECT(runtime.rate == 72.f && runtime.requests == 1);
+
+  // The frames at 90 Hz tell nothing about 72 Hz; a new window is collected
+  script.Frames(FrameStats::kWindowSize - 1, true);
+  EXPECT(runtime.rate == 72.f);
+  script.Frames(1, true);
+  EXPECT(runtime.rate == 60.f && runtime.requests == 2);
+
+  // Up again after 5 s of headroom, never beyond the configured rate
+  script.Frames((uint32_t)(60.f * 5.f) + FrameStats::kWindowSize);
+  EXPECT(runtime.rate == 72.f);
+  script.Frames((uint32_t)(72.f * 5.f) + FrameStats::kWindowSize);
+  EXPECT(runtime.rate == 90.f);
+  script.Frames((uint32_t)(90.f * 5.f) + FrameStats::kWindowSize);
+  EXPECT(runtime.rate == 90.f && runtime.requests == 4);
+}
+
+/* A rate change does not wipe the history the governor decides on */
+void
+TestGovernorKeepsItsWindow()
+{
+  Script script;
+  script.Frames(FrameStats::kWindowSize);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT));
+
+  // The governor boosts on the 2nd missed frame, the rate steps down on the
+  // 5th, while the boost goes on
+  script.Frames(5, true);
+  EXPECT(runtime.rate == 72.f);
+  EXPECT(!script.refresh_rate()->frame_stats()->is_settled());
+  EXPECT(script.governor()->frame_stats()->is_settled());
+  EXPECT(script.governor()->frame_stats()->missed_frames() == 5);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_BOOST_EXT));
+
+  // Still limited to kMaxBoostSeconds (2 s) from its beginning; a governor
+  // waiting for a new window would hold the boost for another 2.5 s
+  script.MissedSeconds(1.5f);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_BOOST_EXT));
+  script.MissedSeconds(0.5f);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT));
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrGetInstanceProcAddr(
+    XrInstance /*instance*/, const char *name, PFN_xrVoidFunction *function)
+{
+  const std::unordered_map<std::string_view, PFN_xrVoidFunction> functions{
+      {"xrEnumerateDisplayRefreshRatesFB",
+          reinterpret_cast<PFN_xrVoidFunction>(EnumerateDisplayRefreshRates)},
+      {"xrGetDisplayRefreshRateFB",
+          reinterpret_cast<PFN_xrVoidFunction>(GetDisplayRefreshRate)},
+      {"xrRequestDisplayRefreshRateFB",
+          reinterpret_cast<PFN_xrVoidFunction>(RequestDisplayRefreshRate)},
+      {"xrPerfSettingsSetPerformanceLevelEXT",
+          reinterpret_cast<PFN_xrVoidFunction>(SetPerformanceLevel)},
+  };
+
+  auto it = functions.find(name);
+  if (it == functions.end()) return XR_ERROR_FUNCTION_UNSUPPORTED;
+
+  *function = it->second;
+  return XR_SUCCESS;
+}
+
+int
+main()
+{
+  TestStepsDownAndUp();
+  TestGovernorKeepsItsWindow();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include "pch.h"
+
+#include <set>
+
+#include "openxr-bindings.h"
+#include "openxr-path-cache.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+/* The stand-in runtime: a new path per call, failing for `failing_path` */
+struct {
+  std::unordered_map<std::string, XrPath> paths;
+  std::string failing_path;
+  uint32_t calls{0};
+} runtime;
+
+/* Every path the action source adds, for every interaction profile */
+void
+AddBindingPaths(OpenXRPathCache *path_cache, std::set<std::string> *unique)
+{
+  auto add = [&](const char *path) {
+    path_cache->Add(path);
+    unique->insert(path);
+  };
+
+  for (auto path : bindings::kHandSubactionPaths) add(path);
+  for (auto &profile : bindings::kInteractionProfiles) {
+    add(profile.profile);
+    for (size_t i = 0; i < profile.binding_count; i++) {
+      add(profile.bindings[i].path);
+    }
+  }
+}
+
+/* Each distinct path is resolved once, however many profiles share it */
+void
+TestDeduplicates()
+{
+  runtime = {};
+  OpenXRPathCache path_cache(XR_NULL_HANDLE);
+  std::set<std::string> unique;
+  AddBindingPaths(&path_cache, &unique);
+
+  size_t reference_count = std::size(bindings::kHandSubactionPaths);
+  for (auto &profile : bindings::kInteractionProfiles) {
+    reference_count += 1 + profile.binding_count;
+  }
+  EXPECT(path_cache.reference_count() == reference_count);
+  EXPECT(unique.size() < reference_count);
+
+  EXPECT(path_cache.Resolve());
+  EXPECT(runtime.calls == unique.size());
+  EXPECT(path_cache.resolved_count() == unique.size());
+
+  // The same path for every reference, and for equal strings elsewhere
+  for (auto &profile : bindings::kInteractionProfiles) {
+    for (size_t i = 0; i < profile.binding_count; i++) {
+      const char *path = profile.bindings[i].path;
+      EXPECT(path_cache.Get(path) == runtime.paths.at(path));
+    }
+  }
+  const std::string copy = "/user/hand/left/input/aim/pose";
+  EXPECT(path_cache.Get(copy.c_str()) == runtime.paths.at(copy));
+  EXPECT(path_cache.Get("/user/hand/left/input/unknown") == XR_NULL_PATH);
+
+  // Nothing new, nothing resolved; a new path alone is resolved next time
+  EXPECT(path_cache.Resolve());
+  EXPECT(runtime.calls == unique.size());
+  path_cache.Add("/user/head");
+  path_cache.Add("/user/head");
+  EXPECT(path_cache.Resolve());
+  EXPECT(runtime.calls == unique.size() + 1);
+  EXPECT(path_cache.Get("/user/head") == runtime.paths.at("/user/head"));
+}
+
+/* A path the runtime rejects fails the Resolve */
+void
+TestFailure()
+{
+  runtime = {};
+  runtime.failing_path = "/user/hand/right";
+  OpenXRPathCache path_cache(XR_NULL_HANDLE);
+  std::set<std::string> unique;
+  AddBindingPaths(&path_cache, &unique);
+
+  EXPECT(!path_cache.Resolve());
+  EXPECT(path_cache.Get("/user/hand/right") == XR_NULL_PATH);
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrStringToPath(XrInstance /*instance*/, const char *path_string, XrPath *path)
+{
+  runtime.calls++;
+  if (path_string == runtime.failing_path) return XR_ERROR_VALIDATION_FAILURE;
+
+  // Each string reaches the runtime once
+  auto [it, inserted] =
+      runtime.paths.try_emplace(path_string, runtime.paths.size() + 1);
+  EXPECT(inserted);
+  *path = it->second;
+  return XR_SUCCESS;
+}
+
+int
+main()
+{
+  TestDeduplicates();
+  TestFailure();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,229 @@
+#include "pch.h"
+
+#include "frame-stats.h"
+#include "openxr-performance-governor.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr XrDuration kPeriod = 11'111'111;  // 90 Hz
+constexpr float kSecond = 1e9f;
+
+/* The stand-in runtime: records the levels set for each domain */
+struct {
+  std::unordered_map<XrPerfSettingsDomainEXT, XrPerfSettingsLevelEXT> levels;
+  uint32_t level_calls{0};
+} runtime;
+
+XRAPI_ATTR XrResult XRAPI_CALL
+SetPerformanceLevel(XrSession /*session*/, XrPerfSettingsDomainEXT domain,
+    XrPerfSettingsLevelEXT level)
+{
+  runtime.levels[domain] = level;
+  runtime.level_calls++;
+  return XR_SUCCESS;
+}
+
+/* Scripted frames and events through a governor fresh from Init */
+class Script {
+ public:
+  Script()
+  {
+    runtime = {};
+    EXPECT(governor_.Init());
+  }
+
+  /* `count` frames, each displayed a period after the previous one, or two
+   * periods after when `missed` */
+  void Frames(uint32_t count, bool missed = false)
+  {
+    for (uint32_t i = 0; i < count; i++) {
+      time_ += missed ? kPeriod * 2 : kPeriod;
+
+      XrFrameState frame_state{XR_TYPE_FRAME_STATE};
+      frame_state.predictedDisplayTime = time_;
+      frame_state.predictedDisplayPeriod = kPeriod;
+      governor_.frame_stats()->BeginFrame(frame_state);
+      governor_.frame_stats()->EndFrame();  // leaving the period unused
+
+      governor_.Update(time_);
+    }
+  }
+
+  /* Good frames for `seconds` */
+  void Seconds(float seconds)
+  {
+    Frames((uint32_t)(seconds * kSecond / kPeriod));
+  }
+
+  void Thermal(XrPerfSettingsDomainEXT domain,
+      XrPerfSettingsNotificationLevelEXT from,
+      XrPerfSettingsNotificationLevelEXT to)
+  {
+    XrEventDataPerfSettingsEXT event{XR_TYPE_EVENT_DATA_PERF_SETTINGS_EXT};
+    event.domain = domain;
+    event.subDomain = XR_PERF_SETTINGS_SUB_DOMAIN_THERMAL_EXT;
+    event.fromLevel = from;
+    event.toLevel = to;
+    governor_.HandlePerfSettingsEvent(&event);
+  }
+
+  float render_scale() { return governor_.render_scale(); }
+
+ private:
+  OpenXRPerformanceGovernor governor_{XR_NULL_HANDLE, XR_NULL_HANDLE};
+  XrTime time_{1'000'000'000};
+};
+
+bool
+IsAt(XrPerfSettingsLevelEXT level)
+{
+  return runtime.levels[XR_PERF_SETTINGS_DOMAIN_CPU_EXT] == level &&
+         runtime.levels[XR_PERF_SETTINGS_DOMAIN_GPU_EXT] == level;
+}
+
+void
+TestInit()
+{
+  Script script;
+  EXPECT(runtime.level_calls == 2);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT));
+  EXPECT(script.render_scale() == 1.f);
+}
+
+void
+TestSustainedLowWithHeadroom()
+{
+  Script script;
+  script.Frames(FrameStats::kWindowSize - 1);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT));  // not settled yet
+
+  script.Frames(1);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT));
+
+  // The runtime is only called on changes
+  const uint32_t level_calls = runtime.level_calls;
+  script.Frames(FrameStats::kWindowSize * 2);
+  EXPECT(runtime.level_calls == level_calls);
+}
+
+void
+TestBoostIsLimited()
+{
+  Script script;
+  script.Frames(FrameStats::kWindowSize);
+
+  script.Frames(2, true);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_BOOST_EXT));
+
+  // Each missed frame takes two periods
+  script.Frames((uint32_t)(1.9f * kSecond / (kPeriod * 2)), true);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_BOOST_EXT));
+
+  script.Frames((uint32_t)(0.2f * kSecond / (kPeriod * 2)), true);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT));
+
+  // Back to low once the missed frames leave the window
+  script.Frames(FrameStats::kWindowSize - 1);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT));
+  script.Frames(1);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT));
+
+  // And a new boost is allowed for new misses
+  script.Frames(2, true);
+  EXPECT(IsAt(XR_PERF_SETTINGS_LEVEL_BOOST_EXT));
+}
+
+void
+TestThermalShedsAndRestores()
+{
+  Script script;
+  script.Frames(FrameStats::kWindowSize);
+
+  script.Thermal(XR_PERF_SETTINGS_DOMAIN_GPU_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT);
+  EXPECT(script.render_scale() == 0.875f);
+
+  // No boost while warm
+  script.Frames(2, true);
+  EXPECT(runtime.levels[XR_PERF_SETTINGS_DOMAIN_GPU_EXT] ==
+         XR_PERF_SETTINGS_LEVEL_SUSTAINED_HIGH_EXT);
+
+  script.Thermal(XR_PERF_SETTINGS_DOMAIN_GPU_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_WARNING_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT);
+  EXPECT(script.render_scale() == 0.5f);
+  EXPECT(runtime.levels[XR_PERF_SETTINGS_DOMAIN_GPU_EXT] ==
+         XR_PERF_SETTINGS_LEVEL_SUSTAINED_LOW_EXT);
+
+  script.Thermal(XR_PERF_SETTINGS_DOMAIN_GPU_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT);
+  EXPECT(script.render_scale() == 0.5f);
+
+  // A step per kRenderScaleStepSeconds (10 s) after the last change
+  script.Seconds(9.8f);
+  EXPECT(script.render_scale() == 0.5f);
+  script.Seconds(0.3f);
+  EXPECT(script.render_scale() == 0.625f);
+  script.Seconds(9.8f);
+  EXPECT(script.render_scale() == 0.625f);
+  script.Seconds(0.3f);
+  EXPECT(script.render_scale() == 0.75f);
+  script.Seconds(25.f);
+  EXPECT(script.render_scale() == 1.f);
+}
+
+void
+TestUnchangedScaleKeepsHolding()
+{
+  Script script;
+  script.Frames(FrameStats::kWindowSize);
+
+  script.Thermal(XR_PERF_SETTINGS_DOMAIN_CPU_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT);
+  EXPECT(script.render_scale() == 0.5f);
+
+  // Hot and missing frames for 25 s; the scale is at its minimum already, so
+  // the attempts to shed more change nothing
+  script.Frames((uint32_t)(25.f * kSecond / (kPeriod * 2)), true);
+  EXPECT(script.render_scale() == 0.5f);
+
+  script.Thermal(XR_PERF_SETTINGS_DOMAIN_CPU_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_IMPAIRED_EXT,
+      XR_PERF_SETTINGS_NOTIF_LEVEL_NORMAL_EXT);
+
+  // The last change was 25 s ago; step up as soon as no frame is missed
+  script.Frames(FrameStats::kWindowSize + 1);
+  EXPECT(script.render_scale() == 0.625f);
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrGetInstanceProcAddr(
+    XrInstance /*instance*/, const char *name, PFN_xrVoidFunction *function)
+{
+  if (std::string_view(name) != "xrPerfSettingsSetPerformanceLevelEXT") {
+    return XR_ERROR_FUNCTION_UNSUPPORTED;
+  }
+
+  *function = reinterpret_cast<PFN_xrVoidFunction>(SetPerformanceLevel);
+  return XR_SUCCESS;
+}
+
+int
+main()
+{
+  TestInit();
+  TestSustainedLowWithHeadroom();
+  TestBoostIsLimited();
+  TestThermalShedsAndRestores();
+  TestUnchangedScaleKeepsHolding();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include "pch.h"
+
+#include "openxr-session-state.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+/* The stand-in runtime: counts the session calls, failing them on request */
+struct {
+  uint32_t begins{0};
+  uint32_t ends{0};
+  XrViewConfigurationType view_configuration_type{};
+  XrResult result{XR_SUCCESS};
+} runtime;
+
+/* Records what the state changes ask of the context */
+class Delegate : public OpenXRSessionState::IDelegate {
+ public:
+  void EnableRemoteSession() override { enables++; }
+  void DisableRemoteSession() override { disables++; }
+  void Terminate() override { terminates++; }
+
+  uint32_t enables{0};
+  uint32_t disables{0};
+  uint32_t terminates{0};
+};
+
+/* The states a runtime goes through from IDLE to running, and back */
+void
+Start(OpenXRSessionState *session_state)
+{
+  for (auto state : {XR_SESSION_STATE_IDLE, XR_SESSION_STATE_READY,
+           XR_SESSION_STATE_SYNCHRONIZED, XR_SESSION_STATE_VISIBLE,
+           XR_SESSION_STATE_FOCUSED}) {
+    session_state->Update(state, 0);
+  }
+}
+
+void
+Stop(OpenXRSessionState *session_state)
+{
+  for (auto state : {XR_SESSION_STATE_VISIBLE, XR_SESSION_STATE_SYNCHRONIZED,
+           XR_SESSION_STATE_STOPPING, XR_SESSION_STATE_IDLE}) {
+    session_state->Update(state, 0);
+  }
+}
+
+/* Stopping and resuming keeps the remote session, which an exit disables */
+void
+TestKeepsRemoteSessionAcrossStop()
+{
+  runtime = {};
+  Delegate delegate;
+  OpenXRSessionState session_state(
+      XR_NULL_HANDLE, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, &delegate);
+  EXPECT(!session_state.is_running());
+  EXPECT(!session_state.is_remote_session_enabled());
+
+  Start(&session_state);
+  EXPECT(session_state.state() == XR_SESSION_STATE_FOCUSED);
+  EXPECT(session_state.is_running());
+  EXPECT(runtime.begins == 1);
+  EXPECT(runtime.view_configuration_type ==
+         XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO);
+  EXPECT(delegate.enables == 1);
+  const auto first_begin_time = session_state.begin_time();
+
+  // STOPPING ends the session and nothing else
+  Stop(&session_state);
+  EXPECT(!session_state.is_running());
+  EXPECT(runtime.ends == 1);
+  EXPECT(session_state.is_remote_session_enabled());
+  EXPECT(delegate.disables == 0 && delegate.terminates == 0);
+
+  // READY again begins the session with the remote session as it is
+  for (int i = 0; i < 2; i++) {
+    Start(&session_state);
+    EXPECT(session_state.is_running());
+    EXPECT(session_state.begin_time() > first_begin_time);
+    Stop(&session_state);
+  }
+  EXPECT(runtime.begins == 3 && runtime.ends == 3);
+  EXPECT(delegate.enables == 1 && delegate.disables == 0);
+
+  session_state.Update(XR_SESSION_STATE_EXITING, 0);
+  EXPECT(!session_state.is_remote_session_enabled());
+  EXPECT(delegate.disables == 1 && delegate.terminates == 1);
+}
+
+/* A lost session disables the remote session once, even if it exits next */
+void
+TestLossDisablesOnce()
+{
+  runtime = {};
+  Delegate delegate;
+  OpenXRSessionState session_state(
+      XR_NULL_HANDLE, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, &delegate);
+
+  // Lost before it ever ran: nothing to disable
+  session_state.Update(XR_SESSION_STATE_LOSS_PENDING, 0);
+  EXPECT(delegate.disables == 0 && delegate.terminates == 1);
+
+  Start(&session_state);
+  session_state.Update(XR_SESSION_STATE_LOSS_PENDING, 0);
+  session_state.Update(XR_SESSION_STATE_EXITING, 0);
+  EXPECT(delegate.enables == 1 && delegate.disables == 1);
+  EXPECT(delegate.terminates == 3);
+}
+
+/* A runtime failing to begin or end the session terminates the loop */
+void
+TestTerminatesOnFailure()
+{
+  runtime = {};
+  runtime.result = XR_ERROR_RUNTIME_FAILURE;
+  Delegate delegate;
+  OpenXRSessionState session_state(
+      XR_NULL_HANDLE, XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO, &delegate);
+
+  session_state.Update(XR_SESSION_STATE_READY, 0);
+  EXPECT(delegate.terminates == 1);
+  session_state.Update(XR_SESSION_STATE_STOPPING, 0);
+  EXPECT(delegate.terminates == 2);
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrBeginSession(XrSession /*session*/, const XrSessionBeginInfo *begin_info)
+{
+  runtime.begins++;
+  runtime.view_configuration_type = begin_info->primaryViewConfigurationType;
+  return runtime.result;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrEndSession(XrSession /*session*/)
+{
+  runtime.ends++;
+  return runtime.result;
+}
+
+int
+main()
+{
+  TestKeepsRemoteSessionAcrossStop();
+  TestLossDisablesOnce();
+  TestTerminatesOnFailure();
+
+  return EXIT_SUCCESS;
+}
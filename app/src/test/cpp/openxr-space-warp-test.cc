@@ -0,0 +1,363 @@
+#include "pch.h"
+
+#include "egl-instance.h"
+#include "gpu-memory-budget.h"
+#include "openxr-space-warp.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int32_t kEyeWidth = 128;
+constexpr int32_t kEyeHeight = 64;
+constexpr int32_t kWidth = 64;  // recommended for motion vectors
+constexpr int32_t kHeight = 32;
+constexpr uint32_t kViewCount = 2;
+constexpr uint32_t kImageCount = 3;
+constexpr float kNear = 0.1f;
+constexpr float kFar = 100.f;
+
+/**
+ * The stand-in runtime: swapchains of GL textures, checking that each image
+ * is acquired, waited for and released in turn
+ */
+struct Swapchain {
+  int64_t format;
+  XrSwapchainUsageFlags usage;
+  std::vector<GLuint> textures;
+  uint32_t next{0};
+  bool is_acquired{false};
+  bool is_waited{false};
+  uint32_t acquires{0};
+  uint32_t releases{0};
+};
+
+struct {
+  std::vector<Swapchain> swapchains;  // the handle is the index + 1
+  uint32_t destroyed{0};
+} runtime;
+
+Swapchain &
+SwapchainOf(XrSwapchain handle)
+{
+  const auto index = reinterpret_cast<uintptr_t>(handle) - 1;
+  EXPECT(index < runtime.swapchains.size());
+  return runtime.swapchains[index];
+}
+
+GLuint
+CompileProgram(const char *vertex_source, const char *fragment_source)
+{
+  GLuint program = glCreateProgram();
+  for (auto [type, source] : {std::pair{GL_VERTEX_SHADER, vertex_source},
+           std::pair{GL_FRAGMENT_SHADER, fragment_source}}) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint is_compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+    EXPECT(is_compiled == GL_TRUE);
+    glAttachShader(program, shader);
+    glDeleteShader(shader);
+  }
+  glLinkProgram(program);
+  GLint is_linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+  EXPECT(is_linked == GL_TRUE);
+  return program;
+}
+
+/* The depth of each pixel of `texture`, drawn to bytes since GLES reads no
+ * depth back */
+std::vector<uint8_t>
+ReadDepth(GLuint texture)
+{
+  GLuint program = CompileProgram(
+      "#version 300 es\n"
+      "void main() {\n"
+      "  gl_Position = vec4(gl_VertexID == 1 ? 3.0 : -1.0,\n"
+      "      gl_VertexID == 2 ? 3.0 : -1.0, 0.0, 1.0);\n"
+      "}\n",
+      "#version 300 es\n"
+      "precision highp float;\n"
+      "uniform highp sampler2D depth;\n"
+      "out vec4 color;\n"
+      "void main() {\n"
+      "  color = vec4(texelFetch(depth, ivec2(gl_FragCoord.xy), 0).r);\n"
+      "}\n");
+
+  GLuint color, framebuffer;
+  glGenTextures(1, &color);
+  glBindTexture(GL_TEXTURE_2D, color);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, kWidth, kHeight);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(
+      GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+
+  glViewport(0, 0, kWidth, kHeight);
+  glUseProgram(program);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+  glReadPixels(
+      0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  std::vector<uint8_t> depth(kWidth * kHeight);
+  for (size_t i = 0; i < depth.size(); i++) depth[i] = pixels[i * 4];
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &color);
+  glDeleteProgram(program);
+  return depth;
+}
+
+/* An eye buffer with only depth, 0.25 on the left half and 0.75 on the
+ * right */
+struct EyeBuffer {
+  EyeBuffer()
+  {
+    glGenTextures(1, &depth);
+    glBindTexture(GL_TEXTURE_2D, depth);
+    glTexStorage2D(
+        GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, kEyeWidth, kEyeHeight);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(
+        GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+    EXPECT(glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+           GL_FRAMEBUFFER_COMPLETE);
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, kEyeWidth / 2, kEyeHeight);
+    glClearDepthf(0.25f);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glScissor(kEyeWidth / 2, 0, kEyeWidth / 2, kEyeHeight);
+    glClearDepthf(0.75f);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  ~EyeBuffer()
+  {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &depth);
+  }
+
+  GLuint depth;
+  GLuint framebuffer;
+};
+
+/**
+ * Frames of both views: the space warp info chained to each projection
+ * view, every image acquired once and released, and the depth scaled down
+ * from the eye buffer
+ */
+void
+TestRendersViews()
+{
+  runtime = {};
+  {
+    GpuMemoryBudget gpu_memory_budget(1024 * 1024 * 1024);
+    OpenXRSpaceWarp space_warp(
+        XR_NULL_HANDLE, XR_NULL_SYSTEM_ID, XR_NULL_HANDLE, &gpu_memory_budget);
+    EXPECT(space_warp.Init(kViewCount, kNear, kFar));
+    EXPECT(!space_warp.is_enabled());
+
+    // A motion vector and a depth swapchain per view
+    EXPECT(runtime.swapchains.size() == kViewCount * 2);
+    for (size_t i = 0; i < runtime.swapchains.size(); i++) {
+      EXPECT(runtime.swapchains[i].format ==
+             (i % 2 == 0 ? GL_RGBA16F : GL_DEPTH_COMPONENT32F));
+    }
+    EXPECT(gpu_memory_budget.usage().total ==
+           (uint64_t)kWidth * kHeight * (8 + 4) * kImageCount * kViewCount);
+
+    EyeBuffer eye_buffer;
+    for (uint32_t frame = 0; frame < kImageCount + 1; frame++) {
+      for (uint32_t view = 0; view < kViewCount; view++) {
+        XrCompositionLayerProjectionView projection_view{
+            XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
+        EXPECT(space_warp.RenderView(view, eye_buffer.framebuffer, kEyeWidth,
+            kEyeHeight, &projection_view));
+
+        auto info = static_cast<const XrCompositionLayerSpaceWarpInfoFB *>(
+            projection_view.next);
+        EXPECT(info != nullptr);
+        EXPECT(info->type == XR_TYPE_COMPOSITION_LAYER_SPACE_WARP_INFO_FB);
+        EXPECT(info->next == nullptr);
+        EXPECT(info->layerFlags == 0);
+        EXPECT(&SwapchainOf(info->motionVectorSubImage.swapchain) ==
+               &runtime.swapchains[view * 2]);
+        EXPECT(&SwapchainOf(info->depthSubImage.swapchain) ==
+               &runtime.swapchains[view * 2 + 1]);
+        for (auto &sub_image :
+            {info->motionVectorSubImage, info->depthSubImage}) {
+          EXPECT(sub_image.imageRect.offset.x == 0 &&
+                 sub_image.imageRect.offset.y == 0);
+          EXPECT(sub_image.imageRect.extent.width == kWidth &&
+                 sub_image.imageRect.extent.height == kHeight);
+          EXPECT(sub_image.imageArrayIndex == 0);
+        }
+        EXPECT(info->appSpaceDeltaPose.orientation.w == 1.f);
+        EXPECT(info->appSpaceDeltaPose.position.x == 0.f);
+        EXPECT(info->minDepth == 0.f && info->maxDepth == 1.f);
+        EXPECT(info->nearZ == kNear && info->farZ == kFar);
+
+        // Released before the frame ends
+        for (uint32_t i = view * 2; i < view * 2 + 2; i++) {
+          auto &swapchain = runtime.swapchains[i];
+          EXPECT(!swapchain.is_acquired);
+          EXPECT(swapchain.acquires == frame + 1);
+          EXPECT(swapchain.releases == frame + 1);
+        }
+
+        // The image just released holds the depth, nearest sampled
+        auto &depth_swapchain = runtime.swapchains[view * 2 + 1];
+        const uint32_t index = (depth_swapchain.next + kImageCount - 1) %
+                               kImageCount;
+        const auto depth = ReadDepth(depth_swapchain.textures[index]);
+        for (int32_t y = 0; y < kHeight; y++) {
+          for (int32_t x = 0; x < kWidth; x++) {
+            const int expected = x < kWidth / 2 ? 64 : 191;
+            EXPECT(std::abs(depth[y * kWidth + x] - expected) <= 1);
+          }
+        }
+      }
+    }
+
+    GLint framebuffer = -1;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+    EXPECT(framebuffer == 0);
+  }
+
+  EXPECT(runtime.destroyed == kViewCount * 2);
+}
+
+}  // namespace
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrGetSystemProperties(XrInstance /*instance*/, XrSystemId /*system_id*/,
+    XrSystemProperties *properties)
+{
+  auto space_warp_properties =
+      static_cast<XrSystemSpaceWarpPropertiesFB *>(properties->next);
+  EXPECT(space_warp_properties->type ==
+         XR_TYPE_SYSTEM_SPACE_WARP_PROPERTIES_FB);
+  space_warp_properties->recommendedMotionVectorImageRectWidth = kWidth;
+  space_warp_properties->recommendedMotionVectorImageRectHeight = kHeight;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrEnumerateSwapchainFormats(XrSession /*session*/, uint32_t capacity,
+    uint32_t *count, int64_t *formats)
+{
+  constexpr int64_t kFormats[] = {
+      GL_SRGB8_ALPHA8, GL_RGBA16F, GL_DEPTH_COMPONENT32F};
+  *count = (uint32_t)std::size(kFormats);
+  if (capacity == 0) return XR_SUCCESS;
+  if (capacity < *count) return XR_ERROR_SIZE_INSUFFICIENT;
+  std::copy(std::begin(kFormats), std::end(kFormats), formats);
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrCreateSwapchain(XrSession /*session*/, const XrSwapchainCreateInfo *info,
+    XrSwapchain *handle)
+{
+  EXPECT(info->width == (uint32_t)kWidth && info->height == (uint32_t)kHeight);
+  EXPECT(info->arraySize == 1 && info->mipCount == 1);
+
+  Swapchain swapchain{info->format, info->usageFlags, {}};
+  swapchain.textures.resize(kImageCount);
+  glGenTextures(kImageCount, swapchain.textures.data());
+  for (auto texture : swapchain.textures) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, info->format, kWidth, kHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  runtime.swapchains.push_back(std::move(swapchain));
+  *handle = reinterpret_cast<XrSwapchain>(runtime.swapchains.size());
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrDestroySwapchain(XrSwapchain handle)
+{
+  auto &swapchain = SwapchainOf(handle);
+  EXPECT(!swapchain.is_acquired);
+  glDeleteTextures(kImageCount, swapchain.textures.data());
+  runtime.destroyed++;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrEnumerateSwapchainImages(XrSwapchain handle, uint32_t capacity,
+    uint32_t *count, XrSwapchainImageBaseHeader *images)
+{
+  auto &swapchain = SwapchainOf(handle);
+  *count = kImageCount;
+  if (capacity == 0) return XR_SUCCESS;
+  if (capacity < *count) return XR_ERROR_SIZE_INSUFFICIENT;
+
+  auto gles_images = reinterpret_cast<XrSwapchainImageOpenGLESKHR *>(images);
+  for (uint32_t i = 0; i < kImageCount; i++) {
+    EXPECT(gles_images[i].type == XR_TYPE_SWAPCHAIN_IMAGE_OPENGL_ES_KHR);
+    gles_images[i].image = swapchain.textures[i];
+  }
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrAcquireSwapchainImage(XrSwapchain handle,
+    const XrSwapchainImageAcquireInfo * /*acquire_info*/, uint32_t *index)
+{
+  auto &swapchain = SwapchainOf(handle);
+  EXPECT(!swapchain.is_acquired);
+  swapchain.is_acquired = true;
+  swapchain.is_waited = false;
+  swapchain.acquires++;
+  *index = swapchain.next;
+  swapchain.next = (swapchain.next + 1) % kImageCount;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrWaitSwapchainImage(
+    XrSwapchain handle, const XrSwapchainImageWaitInfo * /*wait_info*/)
+{
+  auto &swapchain = SwapchainOf(handle);
+  EXPECT(swapchain.is_acquired && !swapchain.is_waited);
+  swapchain.is_waited = true;
+  return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL
+xrReleaseSwapchainImage(
+    XrSwapchain handle, const XrSwapchainImageReleaseInfo * /*release_info*/)
+{
+  auto &swapchain = SwapchainOf(handle);
+  EXPECT(swapchain.is_acquired && swapchain.is_waited);
+  swapchain.is_acquired = false;
+  swapchain.releases++;
+  return XR_SUCCESS;
+}
+
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  TestRendersViews();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#include "pch.h"
+
+#include "poll-loop.h"
+
+namespace zen::mirror::test {
+
+void
+PollLoop::AddFd(remote::FdSource *source)
+{
+  if (std::find(sources_.begin(), sources_.end(), source) != sources_.end()) {
+    return;
+  }
+  sources_.push_back(source);
+}
+
+void
+PollLoop::RemoveFd(remote::FdSource *source)
+{
+  sources_.erase(
+      std::remove(sources_.begin(), sources_.end(), source), sources_.end());
+}
+
+void
+PollLoop::Terminate()
+{
+  is_terminated_ = true;
+}
+
+void
+PollLoop::Poll(std::chrono::milliseconds timeout)
+{
+  // Sources may be added and removed by the callbacks
+  auto sources = sources_;
+  std::vector<pollfd> fds;
+  for (auto source : sources) {
+    short events = 0;
+    if (source->mask & remote::FdSource::kReadable) events |= POLLIN;
+    if (source->mask & remote::FdSource::kWritable) events |= POLLOUT;
+    fds.push_back({source->fd, events, 0});
+  }
+
+  if (poll(fds.data(), fds.size(), timeout.count()) <= 0) return;
+
+  for (size_t i = 0; i < sources.size(); i++) {
+    if (fds[i].revents == 0) continue;
+    if (std::find(sources_.begin(), sources_.end(), sources[i]) ==
+        sources_.end()) {
+      continue;
+    }
+
+    uint32_t mask = 0;
+    if (fds[i].revents & POLLIN) mask |= remote::FdSource::kReadable;
+    if (fds[i].revents & POLLOUT) mask |= remote::FdSource::kWritable;
+    if (fds[i].revents & POLLHUP) mask |= remote::FdSource::kHangup;
+    if (fds[i].revents & POLLERR) mask |= remote::FdSource::kError;
+    sources[i]->callback(sources[i]->fd, mask);
+  }
+}
+
+}  // namespace zen::mirror::test
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+
+namespace zen::mirror::test {
+
+/* The loop of the app, played by poll(2) on the thread calling Poll */
+class PollLoop : public remote::ILoop {
+ public:
+  DISABLE_MOVE_AND_COPY(PollLoop);
+  PollLoop() = default;
+  ~PollLoop() override = default;
+
+  /* Adding a source again replaces its mask */
+  void AddFd(remote::FdSource *source) override;
+
+  void RemoveFd(remote::FdSource *source) override;
+
+  void Terminate() override;
+
+  /* Wait up to `timeout` and call back the sources that are ready */
+  void Poll(std::chrono::milliseconds timeout);
+
+  inline bool is_terminated() const;
+
+ private:
+  std::vector<remote::FdSource *> sources_;
+  bool is_terminated_{false};
+};
+
+inline bool
+PollLoop::is_terminated() const
+{
+  return is_terminated_;
+}
+
+}  // namespace zen::mirror::test
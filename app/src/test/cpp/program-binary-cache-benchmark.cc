@@ -0,0 +1,177 @@
+#include "pch.h"
+
+#include <filesystem>
+
+#include "egl-instance.h"
+#include "gl-upload-thread.h"
+#include "program-binary-cache.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int kProgramCount = 40;  // a new app's first scene
+constexpr uint64_t kCapacity = 32 * 1024 * 1024;
+constexpr auto kFramePeriod = std::chrono::microseconds(11111);
+
+using Clock = std::chrono::steady_clock;
+
+double
+Milliseconds(Clock::duration duration)
+{
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+/**
+ * Lit and textured programs, distinct per `salt`, so that no run finds them
+ * in the driver's own cache
+ */
+std::vector<ShaderSources>
+GeneratePrograms(int salt)
+{
+  std::vector<ShaderSources> programs;
+  for (int i = 0; i < kProgramCount; i++) {
+    ShaderSources sources;
+    sources.vertex = "#version 300 es\n"
+                     "// " + std::to_string(salt) + "\n"
+                     "layout(location = 0) in vec4 position;\n"
+                     "layout(location = 1) in vec3 normal;\n"
+                     "uniform mat4 matrices[4];\n"
+                     "out vec3 v_normal;\n"
+                     "out vec4 v_position;\n"
+                     "void main() {\n"
+                     "  v_position = matrices[0] * position;\n"
+                     "  v_normal = mat3(matrices[1]) * normal;\n"
+                     "  gl_Position = matrices[2] * matrices[3] * v_position;\n"
+                     "}\n";
+    sources.fragment =
+        "#version 300 es\n"
+        "precision highp float;\n"
+        "in vec3 v_normal;\n"
+        "in vec4 v_position;\n"
+        "uniform sampler2D image;\n"
+        "uniform vec4 lights[8];\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "  vec3 sum = vec3(0.0);\n"
+        "  for (int k = 0; k < 8; k++) {\n"
+        "    vec3 light = normalize(lights[k].xyz - v_position.xyz);\n"
+        "    float specular = pow(max(dot(reflect(-light, v_normal),\n"
+        "        vec3(0, 0, 1)), 0.0), " + std::to_string(i + 2) + ".0);\n"
+        "    sum += max(dot(normalize(v_normal), light), 0.0) * specular *\n"
+        "        texture(image, v_position.xy * float(k + 1)).rgb;\n"
+        "  }\n"
+        "  color = vec4(sum, 1.0);\n"
+        "}\n";
+    programs.push_back(std::move(sources));
+  }
+  return programs;
+}
+
+struct Hitch {
+  double total;  // on the render thread in the first frame, ms
+  double max;    // of a single program, ms
+};
+
+/* Every program linked on the render thread in the first frame */
+Hitch
+LinkOnRenderThread(const std::string &directory,
+    const std::vector<ShaderSources> &programs)
+{
+  WorkerPool worker_pool(1);
+  ProgramBinaryCache cache(directory, kCapacity, &worker_pool, nullptr);
+  EXPECT(cache.Init());
+
+  Hitch hitch{0, 0};
+  for (auto &sources : programs) {
+    const auto begin = Clock::now();
+    GLuint program = cache.Link(sources);
+    const double time = Milliseconds(Clock::now() - begin);
+    EXPECT(program != 0);
+    glDeleteProgram(program);
+    hitch.total += time;
+    hitch.max = std::max(hitch.max, time);
+  }
+
+  // Let the worker pool store the binaries before it stops
+  for (int i = 0; i < 1000; i++) {
+    size_t count = 0;
+    for (auto &entry : std::filesystem::directory_iterator(directory)) {
+      if (entry.path().extension().empty()) count++;
+    }
+    if (count == programs.size()) break;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return hitch;
+}
+
+}  // namespace
+
+/**
+ * The render thread's stall for the programs of a new app: linked in its
+ * first frame without and with their binaries from an earlier run, and
+ * precompiled on the upload thread as soon as their sources arrive, where
+ * only the handover in the upload thread's Poll runs on the render thread.
+ */
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+  char directory_template[] = "/tmp/program-binary-cache-benchmark-XXXXXX";
+  EXPECT(mkdtemp(directory_template) != nullptr);
+  const std::string directory = std::string(directory_template) + "/binaries";
+
+  // Unlike any earlier run's, for the driver's own cache
+  const int salt = (int)Clock::now().time_since_epoch().count();
+  const auto programs = GeneratePrograms(salt);
+  const auto cold = LinkOnRenderThread(directory, programs);
+  const auto warm = LinkOnRenderThread(directory, programs);
+
+  GlUploadThread upload_thread(&egl);
+  EXPECT(upload_thread.Init());
+  WorkerPool worker_pool(1);
+  ProgramBinaryCache cache(
+      directory + "-precompiled", kCapacity, &worker_pool, &upload_thread);
+  EXPECT(cache.Init());
+
+  int ready_count = 0;
+  for (auto &sources : GeneratePrograms(salt + 1)) {
+    cache.Precompile(sources, [&](GLuint program) {
+      EXPECT(program != 0);
+      glDeleteProgram(program);
+      ready_count++;
+    });
+  }
+
+  const auto begin = Clock::now();
+  double max_poll = 0;
+  int frame_count = 0;
+  while (ready_count < kProgramCount) {
+    const auto frame_begin = Clock::now();
+    upload_thread.Poll();
+    max_poll = std::max(max_poll, Milliseconds(Clock::now() - frame_begin));
+    frame_count++;
+    std::this_thread::sleep_until(frame_begin + kFramePeriod);
+  }
+  const double precompile_time = Milliseconds(Clock::now() - begin);
+
+  printf("%d programs, %d binary formats:\n", kProgramCount, format_count);
+  printf("  linked in the first frame, cold: %.1f ms (max %.2f ms each)\n",
+      cold.total, cold.max);
+  printf("  linked in the first frame, warm: %.1f ms (max %.2f ms each)\n",
+      warm.total, warm.max);
+  printf("  precompiled: at most %.3f ms per frame on the render thread, all "
+         "ready after %d frames (%.0f ms)\n",
+      max_poll, frame_count, precompile_time);
+
+  std::filesystem::remove_all(directory_template);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,152 @@
+#include "pch.h"
+
+#include <filesystem>
+#include <future>
+#include <map>
+
+#include "egl-instance.h"
+#include "program-binary-cache.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int kProgramCount = 12;
+
+ShaderSources
+ProgramOf(int i)
+{
+  ShaderSources sources;
+  sources.vertex = "#version 300 es\n"
+                   "layout(location = 0) in vec4 position;\n"
+                   "void main() { gl_Position = position; }\n";
+  sources.fragment = "#version 300 es\n"
+                     "precision mediump float;\n"
+                     "out vec4 color;\n"
+                     "void main() { color = vec4(" +
+                     std::to_string(i) + ".0); }\n";
+  return sources;
+}
+
+/* Waits for the tasks posted so far, which one thread runs in order */
+void
+Drain(WorkerPool *worker_pool)
+{
+  std::promise<void> done;
+  worker_pool->Post([&done] { done.set_value(); });
+  done.get_future().wait();
+}
+
+/* Names of the files in `directory` to their modification times */
+std::map<std::string, std::filesystem::file_time_type>
+Listing(const std::string &directory)
+{
+  std::map<std::string, std::filesystem::file_time_type> listing;
+  for (auto &entry : std::filesystem::directory_iterator(directory)) {
+    listing[entry.path().filename()] = entry.last_write_time();
+  }
+  return listing;
+}
+
+uint64_t
+DirectorySize(const std::string &directory)
+{
+  uint64_t size = 0;
+  for (auto &entry : std::filesystem::directory_iterator(directory)) {
+    size += entry.file_size();
+  }
+  return size;
+}
+
+/* Stores past the capacity delete the oldest binaries, not the newest */
+void
+TestKeepsCapacity(const std::string &directory)
+{
+  WorkerPool worker_pool(1);
+
+  // The size of one binary, to fit a few of them
+  uint64_t binary_size;
+  {
+    ProgramBinaryCache cache(directory, UINT64_MAX, &worker_pool, nullptr);
+    EXPECT(cache.Init());
+    glDeleteProgram(cache.Link(ProgramOf(0)));
+    Drain(&worker_pool);
+    binary_size = DirectorySize(directory);
+    EXPECT(binary_size > 0);
+  }
+  std::filesystem::remove_all(directory);
+
+  const uint64_t capacity = binary_size * 4 + binary_size / 2;
+  {
+    ProgramBinaryCache cache(directory, capacity, &worker_pool, nullptr);
+    EXPECT(cache.Init());
+    for (int i = 0; i < kProgramCount; i++) {
+      glDeleteProgram(cache.Link(ProgramOf(i)));
+      Drain(&worker_pool);
+      EXPECT(DirectorySize(directory) <= capacity);
+    }
+  }
+
+  const auto listing = Listing(directory);
+  EXPECT(listing.size() == 4);
+
+  // The newest survive, and load in the next run without being stored again
+  ProgramBinaryCache cache(directory, capacity, &worker_pool, nullptr);
+  EXPECT(cache.Init());
+  for (int i = kProgramCount - 4; i < kProgramCount; i++) {
+    GLuint program = cache.Link(ProgramOf(i));
+    EXPECT(program != 0);
+    glDeleteProgram(program);
+  }
+  Drain(&worker_pool);
+  EXPECT(Listing(directory) == listing);
+}
+
+/* A smaller capacity on the next run keeps only the newest that fit */
+void
+TestShrinksOnInit(const std::string &directory)
+{
+  WorkerPool worker_pool(1);
+  {
+    ProgramBinaryCache cache(directory, UINT64_MAX, &worker_pool, nullptr);
+    EXPECT(cache.Init());
+    for (int i = 0; i < kProgramCount; i++) {
+      glDeleteProgram(cache.Link(ProgramOf(i)));
+    }
+    Drain(&worker_pool);
+  }
+
+  const uint64_t capacity = DirectorySize(directory) / 2;
+  ProgramBinaryCache cache(directory, capacity, &worker_pool, nullptr);
+  EXPECT(cache.Init());
+  EXPECT(DirectorySize(directory) <= capacity);
+}
+
+}  // namespace
+
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  if (format_count == 0) {
+    printf("No program binary formats, skipped\n");
+    return EXIT_SUCCESS;
+  }
+
+  char directory_template[] = "/tmp/program-binary-cache-test-XXXXXX";
+  EXPECT(mkdtemp(directory_template) != nullptr);
+  const std::string directory = std::string(directory_template) + "/binaries";
+
+  TestKeepsCapacity(directory);
+  std::filesystem::remove_all(directory);
+  TestShrinksOnInit(directory);
+
+  std::filesystem::remove_all(directory_template);
+
+  return EXIT_SUCCESS;
+}
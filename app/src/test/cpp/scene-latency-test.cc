@@ -0,0 +1,178 @@
+#include "pch.h"
+
+#include "bulk-channel.h"
+#include "bulk-server-stand-in.h"
+#include "clock-sync.h"
+#include "poll-loop.h"
+#include "scene-latency.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+using Header = test::BulkFrameHeader;
+using Stage = SceneLatency::Stage;
+
+constexpr int64_t kServerOffset = 5'000'000'000;  // server - mirror clock
+constexpr auto kDelay = std::chrono::milliseconds(20);  // each way
+constexpr int64_t kDisplayTime = 11'000'000;
+constexpr uint64_t kUpdateCount = 500;  // a report period
+
+constexpr int64_t
+Nanoseconds(std::chrono::nanoseconds duration)
+{
+  return duration.count();
+}
+
+/* The stand-in server's clock */
+int64_t
+ServerNow()
+{
+  return ClockSync::Now() + kServerOffset;
+}
+
+class Sink : public BulkChannel::ISink {
+ public:
+  void *BeginBlob(uint64_t /*id*/, uint64_t size) override
+  {
+    blob_.resize(size);
+    return blob_.data();
+  }
+
+  void EndBlob(uint64_t /*id*/) override {}
+
+  void AbortBlob(uint64_t /*id*/) override {}
+
+ private:
+  std::vector<uint8_t> blob_;
+};
+
+/* Counts what the channel hands to the scene latency */
+class LatencySink : public BulkChannel::ILatencySink {
+ public:
+  void AddClockSyncSample(
+      int64_t t0, int64_t t1, int64_t t2, int64_t t3) override
+  {
+    latency.AddClockSyncSample(t0, t1, t2, t3);
+  }
+
+  void OnReceived(int64_t server_send_time, int64_t receive_time) override
+  {
+    latency.OnReceived(server_send_time, receive_time);
+    received++;
+  }
+
+  SceneLatency latency;
+  uint64_t received{0};
+};
+
+/**
+ * The server's end: answers the first clock sync request, then sends a blob
+ * every millisecond, each delivered kDelay after it was sent
+ */
+void
+Serve(uint16_t port, const std::atomic_bool *is_done)
+{
+  int fd = test::ConnectToBulkChannel(port);
+  test::ReadBulkHello(fd);
+
+  auto request =
+      test::ReadBulkMessage(fd, BulkChannel::MessageType::kClockSyncRequest);
+  struct {
+    int64_t t0;
+    int64_t t1;
+    int64_t t2;
+  } response;
+  memcpy(&response.t0, request.data(), sizeof(response.t0));
+  std::this_thread::sleep_for(kDelay);
+  response.t1 = ServerNow();
+  response.t2 = ServerNow();
+  std::this_thread::sleep_for(kDelay);
+  Header header{0, sizeof(response), sizeof(response), response.t2,
+      (uint32_t)BulkChannel::Codec::kNone,
+      (uint32_t)BulkChannel::FrameType::kClockSync};
+  test::WriteAll(fd, &header, sizeof(header));
+  test::WriteAll(fd, &response, sizeof(response));
+
+  const auto begin = std::chrono::steady_clock::now();
+  for (uint64_t id = 0; id < kUpdateCount; id++) {
+    const auto send_time = begin + std::chrono::milliseconds(id);
+    std::this_thread::sleep_until(send_time + kDelay);
+    header = Header{id, sizeof(id), sizeof(id),
+        ServerNow() - Nanoseconds(kDelay), (uint32_t)BulkChannel::Codec::kNone,
+        (uint32_t)BulkChannel::FrameType::kBlob};
+    test::WriteAll(fd, &header, sizeof(header));
+    test::WriteAll(fd, &id, sizeof(id));
+  }
+
+  while (!*is_done) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  close(fd);
+}
+
+/**
+ * Over a link delaying each way by kDelay, the clock offset is estimated and
+ * the network stage is the delay; the scene is updated after every poll and
+ * displayed kDisplayTime later
+ */
+void
+TestMeasuresInjectedDelay()
+{
+  WorkerPool worker_pool(1);
+  auto loop = std::make_shared<test::PollLoop>();
+  auto channel = std::make_shared<BulkChannel>(loop, &worker_pool, 0, 1024);
+  EXPECT(channel->Init(0));
+  auto sink = std::make_shared<Sink>();
+  auto latency_sink = std::make_shared<LatencySink>();
+  channel->set_sink(sink);
+  channel->set_latency_sink(latency_sink);
+
+  std::atomic_bool is_done{false};
+  std::thread server(Serve, channel->port(), &is_done);
+
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (latency_sink->received < kUpdateCount &&
+         std::chrono::steady_clock::now() < deadline) {
+    loop->Poll(std::chrono::milliseconds(5));
+    const int64_t now = ClockSync::Now();
+    latency_sink->latency.OnSceneUpdated(now, now + kDisplayTime);
+  }
+  is_done = true;
+  server.join();
+  EXPECT(latency_sink->received == kUpdateCount);
+
+  // Symmetric delays cancel out of the offset, within scheduling noise
+  auto clock_sync = latency_sink->latency.clock_sync();
+  EXPECT(clock_sync->is_synchronized());
+  EXPECT(std::abs(clock_sync->offset() - kServerOffset) < 2'000'000);
+  EXPECT(clock_sync->round_trip() >= 2 * Nanoseconds(kDelay));
+
+  auto &network = latency_sink->latency.reported(Stage::kNetwork);
+  EXPECT(network.p50 >= Nanoseconds(kDelay) - 2'000'000);
+  EXPECT(network.p99 < Nanoseconds(kDelay) + 20'000'000);
+  EXPECT(network.p50 <= network.p90 && network.p90 <= network.p99 &&
+         network.p99 <= network.max);
+
+  auto &queue = latency_sink->latency.reported(Stage::kQueue);
+  EXPECT(queue.p50 >= 0 && queue.max < 50'000'000);
+
+  auto &display = latency_sink->latency.reported(Stage::kDisplay);
+  EXPECT(display.p50 == kDisplayTime && display.max == kDisplayTime);
+
+  // Each total is its network, queue and display stages
+  auto &total = latency_sink->latency.reported(Stage::kTotal);
+  EXPECT(total.p50 >= network.p50 + kDisplayTime);
+  EXPECT(total.max >= network.max + kDisplayTime);
+  EXPECT(total.max <= network.max + queue.max + kDisplayTime);
+}
+
+}  // namespace
+
+int
+main()
+{
+  TestMeasuresInjectedDelay();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "pch.h"
+
+#include "bulk-server-stand-in.h"
+#include "clock-sync.h"
+#include "egl-instance.h"
+#include "gpu-memory-budget.h"
+#include "spectator-stream.h"
+#include "test-util.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+/* Counts the starts and stops of the encoder thread */
+class Encoder final : public SpectatorStream::IEncoder {
+ public:
+  bool Init(uint32_t width, uint32_t height, float rate) override
+  {
+    return raw_.Init(width, height, rate);
+  }
+
+  bool Start() override
+  {
+    EXPECT(!is_started);
+    is_started = true;
+    starts++;
+    return true;
+  }
+
+  void Stop() override
+  {
+    if (is_started) stops++;
+    is_started = false;
+  }
+
+  SpectatorStream::Codec codec() const override { return raw_.codec(); }
+
+  bool Encode(const uint8_t *rgba, int64_t time,
+      std::vector<SpectatorStream::Packet> *packets) override
+  {
+    EXPECT(is_started);
+    return raw_.Encode(rgba, time, packets);
+  }
+
+  std::atomic_bool is_started{false};
+  std::atomic<int> starts{0};
+  std::atomic<int> stops{0};
+
+ private:
+  SpectatorStream::RawEncoder raw_;
+};
+
+/* Capture frames of `framebuffer` until `done` or a second passes */
+void
+CaptureUntil(SpectatorStream *stream, GLuint framebuffer,
+    const std::function<bool()> &done)
+{
+  for (int i = 0; i < 100 && !done(); i++) {
+    stream->Capture(framebuffer, 64, 64, ClockSync::Now());
+    glFinish();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+}  // namespace
+
+/* The encoder runs only while a viewer is connected */
+int
+main()
+{
+  EglInstance egl;
+  EXPECT(egl.Initialize());
+
+  GLuint renderbuffer, framebuffer;
+  glGenRenderbuffers(1, &renderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 64, 64);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(
+      GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+  glClearColor(1, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  GpuMemoryBudget budget(UINT64_MAX);
+  {
+    auto owned_encoder = std::make_unique<Encoder>();
+    Encoder *encoder = owned_encoder.get();
+    SpectatorStream stream(std::move(owned_encoder), &budget, 32, 100);
+    EXPECT(stream.Init(0, 64, 64));
+    EXPECT(encoder->starts == 0);
+
+    for (int viewer = 1; viewer <= 2; viewer++) {
+      int fd = test::ConnectToBulkChannel(stream.port());
+      uint32_t hello[6];
+      EXPECT(test::ReadAll(fd, hello, sizeof(hello)));
+      EXPECT(hello[0] == SpectatorStream::kMagic);
+      EXPECT(encoder->starts == viewer && encoder->is_started);
+
+      // A key frame of the red eye buffer
+      struct {
+        int64_t time;
+        uint32_t size;
+        uint32_t flags;
+      } header;
+      CaptureUntil(&stream, framebuffer, [fd] {
+        pollfd readable{fd, POLLIN, 0};
+        return poll(&readable, 1, 0) == 1;
+      });
+      EXPECT(test::ReadAll(fd, &header, sizeof(header)));
+      EXPECT(header.flags & SpectatorStream::kKeyFrame);
+      std::vector<uint8_t> pixels(header.size);
+      EXPECT(test::ReadAll(fd, pixels.data(), pixels.size()));
+      EXPECT(pixels.size() == 32 * 32 * 4);
+      EXPECT(pixels[0] == 255 && pixels[1] == 0);
+
+      close(fd);
+      CaptureUntil(&stream, framebuffer,
+          [&] { return encoder->stops == viewer; });
+      EXPECT(encoder->stops == viewer && !encoder->is_started);
+    }
+  }
+
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &renderbuffer);
+
+  return EXIT_SUCCESS;
+}
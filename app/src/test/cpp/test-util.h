@@ -0,0 +1,15 @@
+#pragma once
+
+#include "common.h"
+
+/* Exits the test with a failure unless `exp` holds */
+#define EXPECT(exp)                                                   \
+  {                                                                   \
+    if (!(exp)) {                                                     \
+      fprintf(stderr, "%s: Expectation failed: %s\n", FILE_AND_LINE, \
+          #exp);                                                      \
+      exit(EXIT_FAILURE);                                             \
+    }                                                                 \
+  }
+
+#define EXPECT_NEAR(a, b, tolerance) EXPECT(std::abs((a) - (b)) <= (tolerance))
@@ -0,0 +1,139 @@
+#include "pch.h"
+
+#include <random>
+
+#include "test-util.h"
+#include "transform-timeline.h"
+
+using namespace zen::mirror;
+
+namespace {
+
+constexpr int64_t kUpdatePeriod = 33'333'333;  // the server sets 30 Hz
+constexpr int64_t kDisplayPeriod = 11'111'111;  // displayed at 90 Hz
+constexpr int64_t kTransit = 20'000'000;
+constexpr int64_t kFrameLead = 30'000'000;  // a frame runs before display
+constexpr int64_t kDuration = 20'000'000'000;
+constexpr int64_t kSettle = 3'000'000'000;  // skipped while estimates settle
+
+/* An object on the unit circle, once round in 2 pi seconds */
+XrPosef
+PoseAt(int64_t time)
+{
+  const double seconds = time / 1e9;
+  XrPosef pose{};
+  pose.orientation.w = 1;
+  pose.position.x = std::cos(seconds);
+  pose.position.y = std::sin(seconds);
+  return pose;
+}
+
+/* Length of the second difference of consecutive positions, in meters */
+double
+Acceleration(const XrVector3f &a, const XrVector3f &b, const XrVector3f &c)
+{
+  const double x = a.x - 2 * b.x + c.x;
+  const double y = a.y - 2 * b.y + c.y;
+  return std::sqrt(x * x + y * y);
+}
+
+struct Smoothness {
+  double timeline;  // RMS second difference of the evaluated positions, mm
+  double latest;    // that of showing the latest update as it arrives, mm
+  int64_t delay;
+  uint64_t extrapolated_count;
+};
+
+/**
+ * Updates delayed by a transit time plus up to `jitter` of uniform random
+ * delay, in arrival order, and frames that take in what has arrived.
+ */
+Smoothness
+Run(int64_t jitter)
+{
+  std::mt19937 random(7);
+  std::uniform_int_distribution<int64_t> delay(0, jitter);
+
+  struct Update {
+    int64_t time;
+    int64_t receive_time;
+  };
+  std::vector<Update> updates;
+  for (int64_t time = 0; time < kDuration; time += kUpdatePeriod) {
+    updates.push_back({time, time + kTransit + delay(random)});
+  }
+  std::sort(updates.begin(), updates.end(),
+      [](auto &a, auto &b) { return a.receive_time < b.receive_time; });
+
+  TransformTimeline timeline;
+  std::vector<double> timeline_accelerations, latest_accelerations;
+  std::array<XrVector3f, 2> timeline_positions{}, latest_positions{};
+  XrVector3f latest{};
+  size_t next = 0;
+  int frame = 0;
+
+  for (int64_t display_time = kSettle / 3; display_time < kDuration - kSettle;
+       display_time += kDisplayPeriod) {
+    const int64_t now = display_time - kFrameLead;
+    for (; next < updates.size() && updates[next].receive_time <= now;
+         next++) {
+      const Update &update = updates[next];
+      timeline.Push(1, update.time, update.receive_time, PoseAt(update.time));
+      latest = PoseAt(update.time).position;
+    }
+    if (next == 0) continue;
+
+    timeline.Evaluate(display_time);
+    const XrVector3f position = timeline.pose(1)->position;
+
+    if (frame >= 2 && display_time > kSettle) {
+      timeline_accelerations.push_back(Acceleration(
+          timeline_positions[0], timeline_positions[1], position));
+      latest_accelerations.push_back(
+          Acceleration(latest_positions[0], latest_positions[1], latest));
+    }
+    timeline_positions = {timeline_positions[1], position};
+    latest_positions = {latest_positions[1], latest};
+    frame++;
+  }
+
+  const auto rms = [](const std::vector<double> &values) {
+    double sum = 0;
+    for (double value : values) sum += value * value;
+    return std::sqrt(sum / values.size()) * 1000;
+  };
+
+  return Smoothness{rms(timeline_accelerations), rms(latest_accelerations),
+      timeline.interpolation_delay(), timeline.extrapolated_count()};
+}
+
+}  // namespace
+
+/**
+ * Smoothness of an object moving steadily, updated at 30 Hz over a network
+ * of increasing jitter and displayed at 90 Hz. Ideally, the second
+ * difference of the positions is (1 / 90)^2 m, 0.123 mm, every frame.
+ */
+int
+main()
+{
+  constexpr double kIdeal = 1000. / 90 / 90;
+
+  for (int64_t jitter : {0, 10'000'000, 30'000'000, 60'000'000}) {
+    const auto smoothness = Run(jitter);
+    printf("Jitter %2" PRId64 " ms: %.3f mm with the timeline, %.3f mm with "
+           "the latest update, delay %.1f ms, %" PRIu64 " extrapolated\n",
+        jitter / 1'000'000, smoothness.timeline, smoothness.latest,
+        smoothness.delay / 1e6, smoothness.extrapolated_count);
+
+    // Close to the ideal, which linear interpolation between the updates
+    // cannot reach, and far smoother than the updates as they arrive
+    EXPECT(smoothness.timeline < kIdeal * 2);
+    EXPECT(smoothness.timeline * 50 < smoothness.latest);
+    // Covers the jitter without waiting much longer than needed
+    EXPECT(smoothness.delay < kTransit + kFrameLead + kUpdatePeriod +
+                                  3 * jitter + 10'000'000);
+  }
+
+  return EXIT_SUCCESS;
+}